@@ -12,7 +12,8 @@ public class ArchitectureExplorer : ModuleRules
         // Added HeadMountedDisplay so that MotionControllerComponent code in VRCharacter.cpp works
         PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore", "NavigationSystem", "HeadMountedDisplay" });
 
-        PrivateDependencyModuleNames.AddRange(new string[] {  });
+        // Added Json so that the benchmark in VRBenchmarkGameMode.cpp can write its results
+        PrivateDependencyModuleNames.AddRange(new string[] { "Json" });
 
 		// Uncomment if you are using Slate UI
 		// PrivateDependencyModuleNames.AddRange(new string[] { "Slate", "SlateCore" });
@@ -0,0 +1,449 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "ArchitectureSignificanceManager.h"
+#include "VRCharacterStats.h"
+#include "Engine/World.h"
+#include "Engine/Brush.h"
+#include "EngineUtils.h"
+#include "GameFramework/Controller.h"
+#include "GameFramework/Pawn.h"
+#include "Components/StaticMeshComponent.h"
+#include "HAL/IConsoleManager.h"
+#include "RenderCore.h"
+
+static TAutoConsoleVariable<int32> CVarSignificance(
+	TEXT("vr.Significance"),
+	1,
+	TEXT("When 0, scene actors tick, cast shadows and pick LODs as authored, see AArchitectureSignificanceManager"),
+	ECVF_Default);
+
+namespace
+{
+	// actors with this tag are always Full
+	const FName AlwaysSignificantTag(TEXT("AlwaysSignificant"));
+
+	// smoothing of the measured game thread time
+	const float GameThreadTimeSmoothing = 0.05f;
+
+	// frame time of the headset; a tick function with a shorter interval still ticks once per frame
+	const float NominalFrameTime = 1.0f / 90.0f; // seconds
+
+	// how often a tick function with Interval runs per second at most
+	float GetTickRate(float Interval)
+	{
+		return 1.0f / FMath::Max(Interval, NominalFrameTime);
+	}
+}
+
+AArchitectureSignificanceManager::AArchitectureSignificanceManager()
+{
+	// after the character set the viewpoint of this frame; the new tick intervals apply from the next one
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.TickGroup = TG_PostUpdateWork;
+}
+
+AArchitectureSignificanceManager *AArchitectureSignificanceManager::FindOrSpawn(UWorld *World)
+{
+	if (World == nullptr)
+	{
+		return nullptr;
+	}
+
+	for (TActorIterator<AArchitectureSignificanceManager> It(World); It; ++It)
+	{
+		if (!It->IsPendingKill())
+		{
+			return *It;
+		}
+	}
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	return World->SpawnActor<AArchitectureSignificanceManager>(SpawnParameters);
+}
+
+void AArchitectureSignificanceManager::BeginPlay()
+{
+	Super::BeginPlay();
+
+	auto World = GetWorld();
+	if (World == nullptr)
+	{
+		return;
+	}
+
+	for (TActorIterator<AActor> It(World); It; ++It)
+	{
+		RegisterActor(*It);
+	}
+
+	ActorSpawnedHandle = World->AddOnActorSpawnedHandler(FOnActorSpawned::FDelegate::CreateUObject(this, &AArchitectureSignificanceManager::OnActorSpawned));
+}
+
+void AArchitectureSignificanceManager::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	auto World = GetWorld();
+	if (World != nullptr)
+	{
+		World->RemoveOnActorSpawnedHandler(ActorSpawnedHandle);
+	}
+
+	RestoreAll();
+	Entries.Empty();
+	NumReducedActors = 0;
+	NumMinimalActors = 0;
+	SkippedTickRate = 0.0f;
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AArchitectureSignificanceManager::SetViewpoint(const FVector &InCameraLocation, const FVector &InCameraDirection, bool bInTeleportAiming, const FVector &InTeleportDestination)
+{
+	CameraLocation = InCameraLocation;
+	CameraDirection = InCameraDirection.GetSafeNormal();
+	bTeleportAiming = bInTeleportAiming;
+	TeleportDestination = InTeleportDestination;
+
+	if (!bHasViewpoint)
+	{
+		LastScoredCameraLocation = CameraLocation;
+		bHasViewpoint = true;
+	}
+}
+
+bool AArchitectureSignificanceManager::bShouldRegister(AActor *Actor) const
+{
+	if ((Actor == nullptr) || Actor->IsPendingKill() || Actor->ActorHasTag(AlwaysSignificantTag))
+	{
+		return false;
+	}
+
+	// the characters, their hands and the game's bookkeeping stay at full rate
+	if (Actor->IsA<APawn>() || Actor->IsA<AController>() || Actor->IsA<AInfo>() || Actor->IsA<ABrush>())
+	{
+		return false;
+	}
+	if ((Actor->GetOwner() != nullptr) && Actor->GetOwner()->IsA<APawn>())
+	{
+		return false;
+	}
+
+	return Actor->GetRootComponent() != nullptr;
+}
+
+void AArchitectureSignificanceManager::RegisterActor(AActor *Actor)
+{
+	if (!bShouldRegister(Actor))
+	{
+		return;
+	}
+
+	FArchitectureSignificanceEntry Entry;
+	Entry.Actor = Actor;
+	Entry.bMovable = Actor->IsRootComponentMovable();
+	Entry.ActorTickInterval = Actor->GetActorTickInterval();
+
+	TInlineComponentArray<UActorComponent *> Components(Actor);
+	for (auto Component : Components)
+	{
+		if (Component->PrimaryComponentTick.bCanEverTick)
+		{
+			Entry.TickingComponents.Add(Component);
+			Entry.ComponentTickIntervals.Add(Component->GetComponentTickInterval());
+		}
+
+		auto Primitive = Cast<UPrimitiveComponent>(Component);
+		if (Primitive == nullptr)
+		{
+			continue;
+		}
+		Entry.bHasPrimitives = true;
+
+		if (Primitive->CastShadow && (Primitive->Mobility == EComponentMobility::Movable))
+		{
+			Entry.ShadowCasters.Add(Primitive);
+		}
+
+		auto StaticMesh = Cast<UStaticMeshComponent>(Primitive);
+		if (StaticMesh != nullptr)
+		{
+			Entry.StaticMeshes.Add(StaticMesh);
+			Entry.StaticMeshMinLODs.Add(StaticMesh->bOverrideMinLOD ? StaticMesh->MinLOD : -1);
+		}
+	}
+
+	// nothing we could save on
+	if (!Actor->PrimaryActorTick.bCanEverTick && (Entry.TickingComponents.Num() == 0) && !Entry.bHasPrimitives)
+	{
+		return;
+	}
+
+	FVector Extent;
+	Actor->GetActorBounds(false, Entry.Center, Extent);
+	Entry.Radius = Extent.Size();
+
+	Entries.Add(MoveTemp(Entry));
+}
+
+void AArchitectureSignificanceManager::OnActorSpawned(AActor *Actor)
+{
+	RegisterActor(Actor);
+}
+
+float AArchitectureSignificanceManager::GetScore(const FArchitectureSignificanceEntry &Entry) const
+{
+	auto GetDistanceScore = [this, &Entry](const FVector &From)
+	{
+		auto Distance = FMath::Max((Entry.Center - From).Size() - Entry.Radius, 0.0f);
+		return 1.0f - FMath::Clamp((Distance - FullDistance) / FMath::Max(MinimalDistance - FullDistance, 1.0f), 0.0f, 1.0f);
+	};
+
+	auto Score = GetDistanceScore(CameraLocation);
+
+	// the angle to the edge of the bounding sphere, not to its center
+	auto ToActor = Entry.Center - CameraLocation;
+	auto Distance = ToActor.Size();
+	if (Distance > Entry.Radius)
+	{
+		auto Angle = FMath::Acos(FMath::Clamp((ToActor / Distance) | CameraDirection, -1.0f, 1.0f));
+		auto AngularRadius = FMath::Asin(Entry.Radius / Distance);
+		if (Angle - AngularRadius > FMath::DegreesToRadians(ViewConeAngle))
+		{
+			Score *= OutOfViewFactor;
+		}
+	}
+
+	// primitives get a render time when they pass the frustum and occlusion culling
+	auto Actor = Entry.Actor.Get();
+	if (Entry.bHasPrimitives && (Actor != nullptr) && !Actor->WasRecentlyRendered(RecentlyRenderedTime))
+	{
+		Score *= NotRenderedFactor;
+	}
+
+	if (bTeleportAiming)
+	{
+		Score = FMath::Max(Score, GetDistanceScore(TeleportDestination));
+	}
+
+	return Score;
+}
+
+EArchitectureSignificance AArchitectureSignificanceManager::GetLevel(const FArchitectureSignificanceEntry &Entry) const
+{
+	// Thresholds[i] is the score below which an actor drops to level i
+	const float Thresholds[3] = { 2.0f, ReducedThreshold, MinimalThreshold };
+
+	auto Level = (int32)Entry.Level;
+	while ((Level > 0) && (Entry.Score > Thresholds[Level] + Hysteresis))
+	{
+		Level--;
+	}
+	while ((Level < 2) && (Entry.Score < Thresholds[Level + 1] - Hysteresis))
+	{
+		Level++;
+	}
+
+	return (EArchitectureSignificance)Level;
+}
+
+void AArchitectureSignificanceManager::ApplyLevel(FArchitectureSignificanceEntry &Entry, EArchitectureSignificance Level)
+{
+	auto Actor = Entry.Actor.Get();
+	if ((Actor == nullptr) || (Level == Entry.Level))
+	{
+		return;
+	}
+
+	// the counts follow the level changes, instead of walking all entries every frame
+	RemoveFromStats(Entry);
+	Entry.Level = Level;
+	if (Level == EArchitectureSignificance::Reduced)
+	{
+		NumReducedActors++;
+	}
+	else if (Level == EArchitectureSignificance::Minimal)
+	{
+		NumMinimalActors++;
+	}
+
+	float MaxTickInterval = 0.0f;
+	int32 LODBias = 0;
+	if (Level == EArchitectureSignificance::Reduced)
+	{
+		MaxTickInterval = ReducedTickInterval;
+		LODBias = ReducedLODBias;
+	}
+	else if (Level == EArchitectureSignificance::Minimal)
+	{
+		MaxTickInterval = MinimalTickInterval;
+		LODBias = MinimalLODBias;
+	}
+
+	// tick functions that are switched off right now count as well, they may come back on
+	Entry.SkippedTickRate = 0.0f;
+	if (Actor->PrimaryActorTick.bCanEverTick)
+	{
+		auto Interval = FMath::Max(Entry.ActorTickInterval, MaxTickInterval);
+		Actor->SetActorTickInterval(Interval);
+		Entry.SkippedTickRate += GetTickRate(Entry.ActorTickInterval) - GetTickRate(Interval);
+	}
+	for (int32 Index = 0; Index < Entry.TickingComponents.Num(); Index++)
+	{
+		auto Component = Entry.TickingComponents[Index].Get();
+		if (Component != nullptr)
+		{
+			auto Interval = FMath::Max(Entry.ComponentTickIntervals[Index], MaxTickInterval);
+			Component->SetComponentTickInterval(Interval);
+			Entry.SkippedTickRate += GetTickRate(Entry.ComponentTickIntervals[Index]) - GetTickRate(Interval);
+		}
+	}
+	SkippedTickRate += Entry.SkippedTickRate;
+
+	auto bCastShadow = !(bDisableMinimalShadows && (Level == EArchitectureSignificance::Minimal));
+	for (auto &ShadowCaster : Entry.ShadowCasters)
+	{
+		auto Primitive = ShadowCaster.Get();
+		if ((Primitive != nullptr) && (Primitive->CastShadow != bCastShadow))
+		{
+			Primitive->SetCastShadow(bCastShadow);
+		}
+	}
+
+	for (int32 Index = 0; Index < Entry.StaticMeshes.Num(); Index++)
+	{
+		auto StaticMesh = Entry.StaticMeshes[Index].Get();
+		if (StaticMesh == nullptr)
+		{
+			continue;
+		}
+
+		auto AuthoredMinLOD = Entry.StaticMeshMinLODs[Index];
+		auto bOverride = (AuthoredMinLOD >= 0) || (LODBias > 0);
+		auto MinLOD = FMath::Max(AuthoredMinLOD, 0) + LODBias;
+		if ((StaticMesh->bOverrideMinLOD != bOverride) || (StaticMesh->MinLOD != MinLOD))
+		{
+			StaticMesh->bOverrideMinLOD = bOverride;
+			StaticMesh->MinLOD = MinLOD;
+			StaticMesh->MarkRenderStateDirty();
+		}
+	}
+}
+
+void AArchitectureSignificanceManager::RemoveFromStats(const FArchitectureSignificanceEntry &Entry)
+{
+	if (Entry.Level == EArchitectureSignificance::Reduced)
+	{
+		NumReducedActors--;
+	}
+	else if (Entry.Level == EArchitectureSignificance::Minimal)
+	{
+		NumMinimalActors--;
+	}
+	SkippedTickRate -= Entry.SkippedTickRate;
+}
+
+bool AArchitectureSignificanceManager::bUpdateEntry(FArchitectureSignificanceEntry &Entry)
+{
+	auto Actor = Entry.Actor.Get();
+	if ((Actor == nullptr) || Actor->IsPendingKill())
+	{
+		return false;
+	}
+
+	if (Entry.bMovable)
+	{
+		FVector Extent;
+		Actor->GetActorBounds(false, Entry.Center, Extent);
+		Entry.Radius = Extent.Size();
+	}
+
+	Entry.Score = GetScore(Entry);
+	ApplyLevel(Entry, GetLevel(Entry));
+	return true;
+}
+
+void AArchitectureSignificanceManager::RestoreAll()
+{
+	for (auto &Entry : Entries)
+	{
+		ApplyLevel(Entry, EArchitectureSignificance::Full);
+		Entry.Score = 1.0f;
+	}
+	bApplied = false;
+}
+
+void AArchitectureSignificanceManager::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	SCOPE_CYCLE_COUNTER(STAT_VRCharacter_Significance);
+
+	if (!bEnabled || (CVarSignificance.GetValueOnGameThread() == 0) || !bHasViewpoint)
+	{
+		if (bApplied)
+		{
+			RestoreAll();
+		}
+		UpdateStats(DeltaSeconds);
+		return;
+	}
+	bApplied = true;
+
+	// after a teleport everything around us is stale, score it all over the next few frames
+	if (FVector::DistSquared(CameraLocation, LastScoredCameraLocation) > FMath::Square(0.5f * FullDistance))
+	{
+		TeleportRescoreLeft = Entries.Num();
+	}
+	LastScoredCameraLocation = CameraLocation;
+
+	auto NumToUpdate = ActorsPerFrame;
+	if (TeleportRescoreLeft > 0)
+	{
+		NumToUpdate = FMath::Max(NumToUpdate, FMath::DivideAndRoundUp(Entries.Num(), TeleportRescoreFrames));
+		TeleportRescoreLeft = FMath::Max(TeleportRescoreLeft - NumToUpdate, 0);
+	}
+	NumToUpdate = FMath::Min(NumToUpdate, Entries.Num());
+
+	for (int32 Updated = 0; (Updated < NumToUpdate) && (Entries.Num() > 0); Updated++)
+	{
+		if (NextEntry >= Entries.Num())
+		{
+			NextEntry = 0;
+		}
+
+		if (bUpdateEntry(Entries[NextEntry]))
+		{
+			NextEntry++;
+		}
+		else
+		{
+			RemoveFromStats(Entries[NextEntry]);
+			Entries.RemoveAtSwap(NextEntry);
+		}
+	}
+
+	UpdateStats(DeltaSeconds);
+}
+
+void AArchitectureSignificanceManager::UpdateStats(float DeltaSeconds)
+{
+	// the level counts and the tick rate are kept by ApplyLevel, only the frame time is new
+	SkippedTicksPerFrame = SkippedTickRate * DeltaSeconds;
+
+	// GGameThreadTime is the busy time of the previous frame, without waiting for the renderer
+	auto GameThreadTime = FPlatformTime::ToMilliseconds(GGameThreadTime);
+	auto &Smoothed = bApplied ? ThrottledGameThreadTime : ReferenceGameThreadTime;
+	Smoothed = (Smoothed >= 0.0f) ? FMath::Lerp(Smoothed, GameThreadTime, GameThreadTimeSmoothing) : GameThreadTime;
+
+	SavedGameThreadTime = (bApplied && (ReferenceGameThreadTime >= 0.0f)) ? ReferenceGameThreadTime - ThrottledGameThreadTime : 0.0f;
+
+	SET_DWORD_STAT(STAT_VRCharacter_SignificanceReduced, NumReducedActors);
+	SET_DWORD_STAT(STAT_VRCharacter_SignificanceMinimal, NumMinimalActors);
+	SET_FLOAT_STAT(STAT_VRCharacter_SignificanceSkippedTicks, SkippedTicksPerFrame);
+	SET_FLOAT_STAT(STAT_VRCharacter_SignificanceSaved, SavedGameThreadTime);
+
+	CSV_CUSTOM_STAT(VRCharacter, SignificanceReducedActors, NumReducedActors, ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(VRCharacter, SignificanceMinimalActors, NumMinimalActors, ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(VRCharacter, SignificanceSkippedTicks, SkippedTicksPerFrame, ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(VRCharacter, SignificanceSavedMs, SavedGameThreadTime, ECsvCustomStatOp::Set);
+}
@@ -0,0 +1,84 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "BakeTeleportSurfacesCommandlet.h"
+#include "TeleportSurfaceIndex.h"
+#include "NavMesh/RecastNavMesh.h"
+#include "Engine/World.h"
+#include "Engine/Level.h"
+#include "Misc/PackageName.h"
+#include "UObject/Package.h"
+#include "UObject/UObjectGlobals.h"
+
+UBakeTeleportSurfacesCommandlet::UBakeTeleportSurfacesCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UBakeTeleportSurfacesCommandlet::Main(const FString &Params)
+{
+#if WITH_EDITOR
+	FString MapPackageName = TEXT("/Game/MainMap");
+	FParse::Value(*Params, TEXT("Map="), MapPackageName);
+
+	float CellSize = 25.0f;
+	FParse::Value(*Params, TEXT("CellSize="), CellSize);
+
+	auto MapPackage = LoadPackage(nullptr, *MapPackageName, LOAD_None);
+	auto World = (MapPackage != nullptr) ? UWorld::FindWorldInPackage(MapPackage) : nullptr;
+	if ((World == nullptr) || (World->PersistentLevel == nullptr))
+	{
+		UE_LOG(LogTemp, Error, TEXT("UBakeTeleportSurfacesCommandlet::Main() unable to load map %s"), *MapPackageName);
+		return 1;
+	}
+
+	// the navigation mesh is saved with the map, so we do not need to initialize the world to read it
+	ARecastNavMesh *NavMesh = nullptr;
+	for (auto Actor : World->PersistentLevel->Actors)
+	{
+		NavMesh = Cast<ARecastNavMesh>(Actor);
+		if (NavMesh != nullptr)
+		{
+			break;
+		}
+	}
+
+	if (NavMesh == nullptr)
+	{
+		UE_LOG(LogTemp, Error, TEXT("UBakeTeleportSurfacesCommandlet::Main() map %s has no RecastNavMesh, build paths first"), *MapPackageName);
+		return 1;
+	}
+
+	FString IndexPackageName = UTeleportSurfaceIndex::GetPackageNameForMap(MapPackageName);
+	auto IndexPackage = CreatePackage(nullptr, *IndexPackageName);
+	if (!ensure(IndexPackage != nullptr))
+	{
+		return 1;
+	}
+	IndexPackage->FullyLoad();
+
+	auto Index = NewObject<UTeleportSurfaceIndex>(IndexPackage, *FPackageName::GetShortName(IndexPackageName), RF_Public | RF_Standalone);
+	if (!Index->bBake(*NavMesh, CellSize))
+	{
+		UE_LOG(LogTemp, Error, TEXT("UBakeTeleportSurfacesCommandlet::Main() navigation mesh of map %s has no polygons"), *MapPackageName);
+		return 1;
+	}
+
+	IndexPackage->MarkPackageDirty();
+
+	FString Filename = FPackageName::LongPackageNameToFilename(IndexPackageName, FPackageName::GetAssetPackageExtension());
+	if (!UPackage::SavePackage(IndexPackage, Index, RF_Public | RF_Standalone, *Filename))
+	{
+		UE_LOG(LogTemp, Error, TEXT("UBakeTeleportSurfacesCommandlet::Main() unable to save %s"), *Filename);
+		return 1;
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("UBakeTeleportSurfacesCommandlet::Main() baked %s into %s"), *MapPackageName, *Filename);
+	return 0;
+#else
+	UE_LOG(LogTemp, Error, TEXT("UBakeTeleportSurfacesCommandlet::Main() needs an editor build"));
+	return 1;
+#endif
+}
@@ -0,0 +1,251 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "GenerateTeleportProxiesCommandlet.h"
+#include "Components/BoxComponent.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Components/StaticMeshComponent.h"
+#include "Engine/Level.h"
+#include "Engine/LevelStreaming.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/World.h"
+#include "GameFramework/WorldSettings.h"
+#include "PhysicsEngine/BodySetup.h"
+#include "StaticMeshResources.h"
+#include "Misc/PackageName.h"
+#include "UObject/Package.h"
+#include "UObject/UObjectGlobals.h"
+
+const ECollisionChannel UGenerateTeleportProxiesCommandlet::TeleportTraceChannel = ECollisionChannel::ECC_GameTraceChannel1;
+const FName UGenerateTeleportProxiesCommandlet::TeleportProxyTag(TEXT("TeleportProxy"));
+
+namespace
+{
+	// a hidden box that only the teleport arc hits, in the local space of the mesh
+	void AddProxyBox(UStaticMeshComponent &MeshComponent, const FBox &Box)
+	{
+		auto Actor = MeshComponent.GetOwner();
+		auto Proxy = NewObject<UBoxComponent>(Actor, MakeUniqueObjectName(Actor, UBoxComponent::StaticClass(), TEXT("TeleportProxy")), RF_Transactional);
+
+		Proxy->ComponentTags.Add(UGenerateTeleportProxiesCommandlet::TeleportProxyTag);
+		Proxy->SetMobility(MeshComponent.Mobility);
+		Proxy->SetupAttachment(&MeshComponent);
+		Proxy->SetRelativeLocation(Box.GetCenter());
+		Proxy->SetBoxExtent(Box.GetExtent(), false);
+
+		Proxy->SetCollisionEnabled(ECollisionEnabled::QueryOnly);
+		Proxy->SetCollisionObjectType(ECollisionChannel::ECC_WorldStatic);
+		Proxy->SetCollisionResponseToAllChannels(ECR_Ignore);
+		Proxy->SetCollisionResponseToChannel(UGenerateTeleportProxiesCommandlet::TeleportTraceChannel, ECR_Block);
+		Proxy->SetGenerateOverlapEvents(false);
+		Proxy->SetCanEverAffectNavigation(false);
+		Proxy->bHiddenInGame = true;
+
+		Actor->AddInstanceComponent(Proxy);
+	}
+}
+
+UGenerateTeleportProxiesCommandlet::UGenerateTeleportProxiesCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+bool UGenerateTeleportProxiesCommandlet::bHasTeleportProxies(const UWorld *World)
+{
+	auto WorldSettings = (World != nullptr) ? World->GetWorldSettings(false, false) : nullptr;
+	return (WorldSettings != nullptr) && WorldSettings->ActorHasTag(TeleportProxyTag);
+}
+
+bool UGenerateTeleportProxiesCommandlet::bGetProxyBox(const UStaticMeshComponent &MeshComponent, FBox &OutBox) const
+{
+	auto Mesh = MeshComponent.GetStaticMesh();
+	if ((Mesh == nullptr) || (Mesh->RenderData == nullptr) || (Mesh->RenderData->LODResources.Num() == 0))
+	{
+		return false;
+	}
+
+	const auto &LOD = Mesh->RenderData->LODResources[0];
+	const auto &Positions = LOD.VertexBuffers.PositionVertexBuffer;
+
+	TArray<uint32> Indices;
+	LOD.IndexBuffer.GetCopy(Indices);
+
+	OutBox = Mesh->GetBoundingBox();
+	auto Size = OutBox.GetSize();
+
+	// a flat mesh has its two faces in the same place
+	float BoxArea = 0.0f;
+	for (int32 Axis = 0; Axis < 3; Axis++)
+	{
+		auto FaceArea = Size[(Axis + 1) % 3] * Size[(Axis + 2) % 3];
+		BoxArea += (Size[Axis] > 2.0f * BoxTolerance) ? 2.0f * FaceArea : FaceArea;
+	}
+
+	// how much of the mesh lies on the faces of its bounds
+	float MeshArea = 0.0f;
+	float OnFaceArea = 0.0f;
+	for (int32 Index = 0; Index + 2 < Indices.Num(); Index += 3)
+	{
+		const FVector Corners[3] = { Positions.VertexPosition(Indices[Index]), Positions.VertexPosition(Indices[Index + 1]), Positions.VertexPosition(Indices[Index + 2]) };
+		auto Area = 0.5f * FVector::CrossProduct(Corners[1] - Corners[0], Corners[2] - Corners[0]).Size();
+		MeshArea += Area;
+
+		for (int32 Face = 0; Face < 6; Face++)
+		{
+			auto Axis = Face / 2;
+			auto Plane = (Face % 2 == 0) ? OutBox.Min[Axis] : OutBox.Max[Axis];
+			if ((FMath::Abs(Corners[0][Axis] - Plane) <= BoxTolerance) && (FMath::Abs(Corners[1][Axis] - Plane) <= BoxTolerance) && (FMath::Abs(Corners[2][Axis] - Plane) <= BoxTolerance))
+			{
+				OnFaceArea += Area;
+				break;
+			}
+		}
+	}
+
+	// the mesh has to be on the faces, and the faces have to be covered (an L is on its bounds, but doesn't cover them)
+	return (MeshArea > 0.0f) && (BoxArea > 0.0f) && (OnFaceArea >= BoxFit * MeshArea) && (OnFaceArea >= BoxFit * BoxArea);
+}
+
+void UGenerateTeleportProxiesCommandlet::ProcessLevel(ULevel &Level)
+{
+	for (auto Actor : Level.Actors)
+	{
+		if (Actor == nullptr)
+		{
+			continue;
+		}
+
+		// the proxies of the last run
+		TInlineComponentArray<UPrimitiveComponent *> Components(Actor);
+		for (auto Component : Components)
+		{
+			if (Component->ComponentHasTag(TeleportProxyTag))
+			{
+				Actor->Modify();
+				Actor->RemoveInstanceComponent(Component);
+				Component->DestroyComponent();
+			}
+		}
+
+		for (auto Component : Components)
+		{
+			if (Component->IsPendingKill())
+			{
+				continue;
+			}
+
+			auto CollisionEnabled = Component->GetCollisionEnabled();
+			auto bBlocksVisibility =
+				((CollisionEnabled == ECollisionEnabled::QueryOnly) || (CollisionEnabled == ECollisionEnabled::QueryAndPhysics)) &&
+				(Component->GetCollisionResponseToChannel(ECollisionChannel::ECC_Visibility) == ECR_Block);
+
+			auto Response = bBlocksVisibility ? ECR_Block : ECR_Ignore;
+			if (bBlocksVisibility)
+			{
+				auto MeshComponent = Cast<UStaticMeshComponent>(Component);
+				auto Mesh = (MeshComponent != nullptr) ? MeshComponent->GetStaticMesh() : nullptr;
+				FBox ProxyBox;
+
+				// instances share one component, they would need a box each
+				if ((Mesh == nullptr) || Component->IsA<UInstancedStaticMeshComponent>() || (Component->Mobility == EComponentMobility::Movable))
+				{
+					NumOther++;
+				}
+				else if ((Mesh->BodySetup != nullptr) && (Mesh->BodySetup->AggGeom.GetElementCount() > 0) && (Mesh->BodySetup->GetCollisionTraceFlag() != CTF_UseComplexAsSimple))
+				{
+					NumSimple++;
+				}
+				else if (bGetProxyBox(*MeshComponent, ProxyBox))
+				{
+					AddProxyBox(*MeshComponent, ProxyBox);
+					Response = ECR_Ignore;
+					NumBoxes++;
+				}
+				else
+				{
+					NumComplex++;
+				}
+			}
+
+			if (Component->GetCollisionResponseToChannel(TeleportTraceChannel) != Response)
+			{
+				Component->Modify();
+				Component->SetCollisionResponseToChannel(TeleportTraceChannel, Response);
+			}
+		}
+	}
+}
+
+int32 UGenerateTeleportProxiesCommandlet::Main(const FString &Params)
+{
+#if WITH_EDITOR
+	FString MapPackageName = TEXT("/Game/MainMap");
+	FParse::Value(*Params, TEXT("Map="), MapPackageName);
+	FParse::Value(*Params, TEXT("BoxTolerance="), BoxTolerance);
+	FParse::Value(*Params, TEXT("BoxFit="), BoxFit);
+
+	auto MapPackage = LoadPackage(nullptr, *MapPackageName, LOAD_None);
+	auto World = (MapPackage != nullptr) ? UWorld::FindWorldInPackage(MapPackage) : nullptr;
+	if ((World == nullptr) || (World->PersistentLevel == nullptr))
+	{
+		UE_LOG(LogTemp, Error, TEXT("UGenerateTeleportProxiesCommandlet::Main() unable to load map %s"), *MapPackageName);
+		return 1;
+	}
+
+	// the streaming levels are separate packages, they get their proxies saved with them
+	TArray<UWorld *> Worlds = { World };
+	for (auto StreamingLevel : World->GetStreamingLevels())
+	{
+		if (StreamingLevel == nullptr)
+		{
+			continue;
+		}
+
+		auto LevelPackageName = StreamingLevel->GetWorldAssetPackageName();
+		auto LevelPackage = LoadPackage(nullptr, *LevelPackageName, LOAD_None);
+		auto LevelWorld = (LevelPackage != nullptr) ? UWorld::FindWorldInPackage(LevelPackage) : nullptr;
+		if ((LevelWorld == nullptr) || (LevelWorld->PersistentLevel == nullptr))
+		{
+			UE_LOG(LogTemp, Error, TEXT("UGenerateTeleportProxiesCommandlet::Main() unable to load streaming level %s"), *LevelPackageName);
+			return 1;
+		}
+		Worlds.Add(LevelWorld);
+	}
+
+	for (auto LevelWorld : Worlds)
+	{
+		ProcessLevel(*LevelWorld->PersistentLevel);
+	}
+
+	// AVRCharacter looks for this to switch to the Teleport channel
+	auto WorldSettings = World->PersistentLevel->GetWorldSettings();
+	if (!ensure(WorldSettings != nullptr))
+	{
+		return 1;
+	}
+	WorldSettings->Modify();
+	WorldSettings->Tags.AddUnique(TeleportProxyTag);
+
+	for (auto LevelWorld : Worlds)
+	{
+		auto Package = LevelWorld->GetOutermost();
+		Package->MarkPackageDirty();
+
+		FString Filename = FPackageName::LongPackageNameToFilename(Package->GetName(), FPackageName::GetMapPackageExtension());
+		if (!UPackage::SavePackage(Package, LevelWorld, RF_NoFlags, *Filename))
+		{
+			UE_LOG(LogTemp, Error, TEXT("UGenerateTeleportProxiesCommandlet::Main() unable to save %s"), *Filename);
+			return 1;
+		}
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("UGenerateTeleportProxiesCommandlet::Main() %s and %d streaming levels: %d box proxies, %d meshes with simple collision, %d complex only, %d other"),
+		*MapPackageName, Worlds.Num() - 1, NumBoxes, NumSimple, NumComplex, NumOther);
+	return 0;
+#else
+	UE_LOG(LogTemp, Error, TEXT("UGenerateTeleportProxiesCommandlet::Main() needs an editor build"));
+	return 1;
+#endif
+}
@@ -0,0 +1,117 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "MovableArchitectureComponent.h"
+#include "TeleportNavigationUpdater.h"
+#include "GenerateTeleportProxiesCommandlet.h"
+#include "Components/PrimitiveComponent.h"
+#include "Components/SceneComponent.h"
+#include "GameFramework/Actor.h"
+
+UMovableArchitectureComponent::UMovableArchitectureComponent()
+{
+	// all the work happens when the actor moves
+	PrimaryComponentTick.bCanEverTick = false;
+}
+
+void UMovableArchitectureComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	auto Owner = GetOwner();
+	auto Root = (Owner != nullptr) ? Owner->GetRootComponent() : nullptr;
+	if (Root == nullptr)
+	{
+		return;
+	}
+
+	if (Root->Mobility != EComponentMobility::Movable)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("UMovableArchitectureComponent::BeginPlay() %s is not movable"), *Owner->GetName());
+	}
+
+	NavigationUpdater = ATeleportNavigationUpdater::FindOrSpawn(GetWorld());
+
+	// spawned architecture didn't go through UGenerateTeleportProxiesCommandlet, the teleport arc hits it like before
+	TInlineComponentArray<UPrimitiveComponent *> Components(Owner);
+	for (auto Component : Components)
+	{
+		if (Component->GetCollisionResponseToChannel(ECollisionChannel::ECC_Visibility) == ECR_Block)
+		{
+			Component->SetCollisionResponseToChannel(UGenerateTeleportProxiesCommandlet::TeleportTraceChannel, ECR_Block);
+		}
+	}
+
+	LastBounds = Owner->GetComponentsBoundingBox();
+	TransformUpdatedHandle = Root->TransformUpdated.AddUObject(this, &UMovableArchitectureComponent::OnTransformUpdated);
+}
+
+void UMovableArchitectureComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	auto Owner = GetOwner();
+	auto Root = (Owner != nullptr) ? Owner->GetRootComponent() : nullptr;
+	if (Root != nullptr)
+	{
+		Root->TransformUpdated.Remove(TransformUpdatedHandle);
+	}
+
+	// only the component goes away, the actor has to block the navigation mesh again
+	if ((Owner != nullptr) && !Owner->IsActorBeingDestroyed() && (EndPlayReason == EEndPlayReason::Destroyed))
+	{
+		ReleaseNavigation();
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void UMovableArchitectureComponent::HoldNavigation()
+{
+	auto Owner = GetOwner();
+	if (bNavigationHeld || (Owner == nullptr))
+	{
+		return;
+	}
+	bNavigationHeld = true;
+
+	// unregistering dirties the tiles under the actor once, after that its moves don't reach the navigation system
+	TInlineComponentArray<UPrimitiveComponent *> Components(Owner);
+	for (auto Component : Components)
+	{
+		if (Component->CanEverAffectNavigation())
+		{
+			Component->SetCanEverAffectNavigation(false);
+			HeldPrimitives.Add(Component);
+		}
+	}
+}
+
+void UMovableArchitectureComponent::ReleaseNavigation()
+{
+	if (!bNavigationHeld)
+	{
+		return;
+	}
+	bNavigationHeld = false;
+
+	// registering again adds the dirty area of the new bounds, which the dynamic generator rebuilds tile by tile
+	for (auto &Component : HeldPrimitives)
+	{
+		if (Component.IsValid())
+		{
+			Component->SetCanEverAffectNavigation(true);
+		}
+	}
+	HeldPrimitives.Reset();
+}
+
+void UMovableArchitectureComponent::OnTransformUpdated(USceneComponent *UpdatedComponent, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport)
+{
+	auto Owner = GetOwner();
+	if ((Owner == nullptr) || (NavigationUpdater == nullptr))
+	{
+		return;
+	}
+
+	auto Bounds = Owner->GetComponentsBoundingBox();
+	NavigationUpdater->NotifyArchitectureMoved(this, LastBounds, Bounds);
+	LastBounds = Bounds;
+}
@@ -0,0 +1,198 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "TeleportArcTracer.h"
+#include "VRMathCoreConversions.h"
+#include "Engine/World.h"
+#include "Components/PrimitiveComponent.h"
+
+namespace
+{
+	// shortest and longest segment we allow, independent of curvature
+	const float MinSegmentTime = 1.0f / 60.0f; // seconds
+	const float MaxSegmentTime = 0.5f; // seconds
+
+	// hard cap so a tiny MaxDeviation cannot blow up the number of sweeps
+	const int32 MaxSegments = 64;
+
+	// consecutive segments that share one overlap query
+	// a box around the whole arc spans most of a room and finds every wall in it, a box around
+	// a few segments stays tight, and the queries past the first hit are never made
+	const int32 SegmentsPerOverlap = 4;
+
+	// blocking components the broadphase expects to find around one group of segments
+	// more than this still works, it just grows the arrays once
+	const int32 ExpectedOverlaps = 32;
+
+	VRMathCore::FArcParams ToCore(const FTeleportArcParams &Params)
+	{
+		return VRMathCore::FArcParams{ VRMathCore::ToCore(Params.Start), VRMathCore::ToCore(Params.LaunchVelocity), Params.GravityZ };
+	}
+
+	// the part of gravity that bends the arc away from the given direction of travel
+	float GetGravityAcross(float GravityZ, const FVector &Velocity)
+	{
+		return VRMathCore::GetGravityAcross(GravityZ, VRMathCore::ToCore(Velocity));
+	}
+
+	// longest segment time that keeps the chord within MaxDeviation of the parabola
+	float GetSegmentTime(float GravityAcross, float MaxDeviation)
+	{
+		return VRMathCore::GetSegmentTime(GravityAcross, MaxDeviation, MinSegmentTime, MaxSegmentTime);
+	}
+}
+
+FVector FTeleportArcTracer::GetArcLocation(const FTeleportArcParams &Params, float Time)
+{
+	return VRMathCore::FromCore(VRMathCore::GetArcLocation(ToCore(Params), Time));
+}
+
+FVector FTeleportArcTracer::GetArcVelocity(const FTeleportArcParams &Params, float Time)
+{
+	return VRMathCore::FromCore(VRMathCore::GetArcVelocity(ToCore(Params), Time));
+}
+
+bool FTeleportArcTracer::bGetArcTimeAtHeight(const FTeleportArcParams &Params, float Z, float &OutTime)
+{
+	return VRMathCore::bGetArcTimeAtHeight(ToCore(Params), Z, Params.SimulationTime, OutTime);
+}
+
+int32 FTeleportArcTracer::GetMaxSegments()
+{
+	return MaxSegments;
+}
+
+void FTeleportArcTracer::Reserve()
+{
+	Segments.Reserve(MaxSegments);
+	Overlaps.Reserve(ExpectedOverlaps);
+	CandidateBounds.Reserve(ExpectedOverlaps);
+}
+
+void FTeleportArcTracer::BuildSegments(const FTeleportArcParams &Params, TArray<FTeleportArcSegment> &OutSegments)
+{
+	OutSegments.Reset();
+
+	float Time = 0.0f;
+	FVector Location = Params.Start;
+
+	while ((Time < Params.SimulationTime) && (OutSegments.Num() < MaxSegments))
+	{
+		// the arc bends most where it travels horizontally (the apex) and least where it falls steeply,
+		// so check the bend at both ends of the segment and go with the tighter one
+		float SegmentTime = GetSegmentTime(GetGravityAcross(Params.GravityZ, GetArcVelocity(Params, Time)), Params.MaxDeviation);
+		float EndBend = GetGravityAcross(Params.GravityZ, GetArcVelocity(Params, Time + SegmentTime));
+		SegmentTime = FMath::Min(SegmentTime, GetSegmentTime(EndBend, Params.MaxDeviation));
+
+		float EndTime = FMath::Min(Time + SegmentTime, Params.SimulationTime);
+		if (OutSegments.Num() == MaxSegments - 1)
+		{
+			EndTime = Params.SimulationTime;
+		}
+
+		FTeleportArcSegment Segment;
+		Segment.Start = Location;
+		Segment.End = GetArcLocation(Params, EndTime);
+		Segment.StartTime = Time;
+		Segment.EndTime = EndTime;
+		OutSegments.Add(Segment);
+
+		Time = EndTime;
+		Location = Segment.End;
+	}
+}
+
+bool FTeleportArcTracer::bTrace(UWorld *World, const FTeleportArcParams &Params, const FCollisionQueryParams &QueryParams, FHitResult &OutHit)
+{
+	NumQueries = 0;
+	NumSweeps = 0;
+	HitTime = 0.0f;
+
+	if (World == nullptr)
+	{
+		return false;
+	}
+
+	BuildSegments(Params, Segments);
+
+	if (Segments.Num() == 0)
+	{
+		return false;
+	}
+
+	// a segment can touch geometry up to our radius plus how far it strays from the real arc
+	const float Padding = Params.Radius + FMath::Max(Params.MaxDeviation, 0.0f);
+
+	const auto SweepShape = FCollisionShape::MakeSphere(Params.Radius);
+
+	// in order along the arc, and stop at the first hit just like PredictProjectilePath does
+	for (int32 GroupStart = 0; GroupStart < Segments.Num(); GroupStart += SegmentsPerOverlap)
+	{
+		const int32 GroupEnd = FMath::Min(GroupStart + SegmentsPerOverlap, Segments.Num());
+
+		FBox GroupBounds(ForceInit);
+		for (int32 Index = GroupStart; Index < GroupEnd; Index++)
+		{
+			GroupBounds += Segments[Index].Start;
+			GroupBounds += Segments[Index].End;
+		}
+		GroupBounds = GroupBounds.ExpandBy(Padding);
+
+		// coarse broadphase: one overlap query tells us which components could block this part of the arc
+		Overlaps.Reset();
+		World->OverlapMultiByChannel(Overlaps, GroupBounds.GetCenter(), FQuat::Identity, Params.TraceChannel, FCollisionShape::MakeBox(GroupBounds.GetExtent()), QueryParams);
+		NumQueries++;
+
+		CandidateBounds.Reset();
+		for (const auto &Overlap : Overlaps)
+		{
+			auto Component = Overlap.GetComponent();
+			if (Overlap.bBlockingHit && (Component != nullptr))
+			{
+				CandidateBounds.Add(Component->Bounds.GetBox());
+			}
+		}
+
+		// nothing in reach blocks our channel, so this part of the arc cannot hit anything
+		if (CandidateBounds.Num() == 0)
+		{
+			continue;
+		}
+
+		// sweep only the segments whose bounds touch a candidate
+		for (int32 Index = GroupStart; Index < GroupEnd; Index++)
+		{
+			const auto &Segment = Segments[Index];
+
+			FBox SegmentBounds(ForceInit);
+			SegmentBounds += Segment.Start;
+			SegmentBounds += Segment.End;
+			SegmentBounds = SegmentBounds.ExpandBy(Padding);
+
+			bool bMayHit = false;
+			for (const auto &Bounds : CandidateBounds)
+			{
+				if (SegmentBounds.Intersect(Bounds))
+				{
+					bMayHit = true;
+					break;
+				}
+			}
+
+			if (!bMayHit)
+			{
+				continue;
+			}
+
+			NumQueries++;
+			NumSweeps++;
+
+			if (World->SweepSingleByChannel(OutHit, Segment.Start, Segment.End, FQuat::Identity, Params.TraceChannel, SweepShape, QueryParams))
+			{
+				HitTime = FMath::Lerp(Segment.StartTime, Segment.EndTime, OutHit.Time);
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,118 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "TeleportClearanceCache.h"
+#include "Engine/World.h"
+#include "Components/PrimitiveComponent.h"
+
+namespace
+{
+	// the capsule test starts this far above the floor so it doesn't touch the floor itself
+	const float FloorOffset = 2.0f; // centimeters
+
+	// a watched component counts as moved beyond this
+	const float MovedTolerance = 0.5f; // centimeters
+
+	// when the map grows beyond this many cells, we start over
+	// about a large building's worth of places a user aimed at
+	const int32 MaxCells = 16384;
+
+	// from the center of a cell to its corner, in cells
+	const float HalfCellDiagonal = 0.5f * 1.41421356f;
+}
+
+bool FTeleportClearanceCache::bIsCellValid(const FCell &Cell, const FTeleportClearanceParams &Params, float Now)
+{
+	if (Now - Cell.Time > Params.MaxAge)
+	{
+		return false;
+	}
+
+	for (const auto &Watched : Cell.Watched)
+	{
+		auto Component = Watched.Component.Get();
+		if (Component == nullptr)
+		{
+			return false;
+		}
+
+		const auto &Transform = Component->GetComponentTransform();
+		if (!Transform.GetLocation().Equals(Watched.Transform.GetLocation(), MovedTolerance) ||
+			!Transform.GetRotation().Equals(Watched.Transform.GetRotation(), KINDA_SMALL_NUMBER))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool FTeleportClearanceCache::bHasClearance(UWorld *World, const FTeleportClearanceParams &Params, const FCollisionQueryParams &QueryParams, const FVector &Location, bool &bOutFromCache)
+{
+	NumQueries = 0;
+	bOutFromCache = false;
+
+	if (World == nullptr)
+	{
+		return true;
+	}
+
+	auto CellSize = FMath::Max(Params.CellSize, 1.0f);
+	FIntVector Key(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize), FMath::FloorToInt(Location.Z / CellSize));
+
+	auto Now = World->GetTimeSeconds();
+
+	auto Cell = Cells.Find(Key);
+	if (Cell != nullptr)
+	{
+		if (bIsCellValid(*Cell, Params, Now))
+		{
+			bOutFromCache = true;
+			return Cell->bClear;
+		}
+		NumInvalidations++;
+	}
+	else
+	{
+		if (Cells.Num() >= MaxCells)
+		{
+			Cells.Reset();
+		}
+		Cell = &Cells.Add(Key);
+	}
+
+	// test the whole cell: the capsule is wider by half the cell's diagonal and a cell taller,
+	// so it covers the capsule of any location in the cell
+	// it stands on the top of the cell, the floor may be anywhere in the cell and must not count
+	auto HalfCell = 0.5f * CellSize;
+	auto CellCenter = (FVector(Key) + FVector(0.5f)) * CellSize;
+	auto Radius = Params.Radius + HalfCellDiagonal * CellSize;
+	auto HalfHeight = FMath::Max(Params.HalfHeight + HalfCell, Radius);
+	auto Center = FVector(CellCenter.X, CellCenter.Y, CellCenter.Z + HalfCell + FloorOffset + HalfHeight);
+
+	Cell->bClear = !World->OverlapBlockingTestByChannel(Center, FQuat::Identity, Params.TraceChannel, FCollisionShape::MakeCapsule(Radius, HalfHeight), QueryParams);
+	Cell->Time = Now;
+	NumQueries++;
+
+	// remember what around us could move into (or out of) the capsule
+	Cell->Watched.Reset();
+	Overlaps.Reset();
+	auto WatchShape = FCollisionShape::MakeCapsule(Radius + Params.WatchDistance, HalfHeight + Params.WatchDistance);
+	World->OverlapMultiByChannel(Overlaps, Center, FQuat::Identity, Params.TraceChannel, WatchShape, QueryParams);
+	NumQueries++;
+
+	for (const auto &Overlap : Overlaps)
+	{
+		auto Component = Overlap.GetComponent();
+		if ((Component != nullptr) && (Component->Mobility == EComponentMobility::Movable))
+		{
+			Cell->Watched.Add({ Component, Component->GetComponentTransform() });
+		}
+	}
+
+	return Cell->bClear;
+}
+
+void FTeleportClearanceCache::Reset()
+{
+	Cells.Reset();
+}
@@ -0,0 +1,36 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "TeleportLateLatchComponent.h"
+#include "VRCharacter.h"
+
+UTeleportLateLatchComponent::UTeleportLateLatchComponent()
+{
+	// as late as the game thread gets before the frame goes to the renderer
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.TickGroup = TG_PostUpdateWork;
+}
+
+void UTeleportLateLatchComponent::RegisterComponentTickFunctions(bool bRegister)
+{
+	Super::RegisterComponentTickFunctions(bRegister);
+
+	// the arc of this frame has to be there first
+	auto Owner = GetOwner();
+	if (bRegister && (Owner != nullptr) && Owner->PrimaryActorTick.bCanEverTick)
+	{
+		PrimaryComponentTick.AddPrerequisite(Owner, Owner->PrimaryActorTick);
+	}
+}
+
+void UTeleportLateLatchComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction *ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	auto Character = Cast<AVRCharacter>(GetOwner());
+	if (Character == nullptr)
+	{
+		return;
+	}
+
+	Character->LateLatchTeleportDestination();
+}
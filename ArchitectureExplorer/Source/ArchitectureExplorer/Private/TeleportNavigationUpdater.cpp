@@ -0,0 +1,349 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "TeleportNavigationUpdater.h"
+#include "MovableArchitectureComponent.h"
+#include "TeleportSurfaceIndex.h"
+#include "VRCharacter.h"
+#include "VRCharacterStats.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/PlayerController.h"
+#include "NavigationSystem.h"
+#include "NavMesh/RecastNavMesh.h"
+
+ATeleportNavigationUpdater::ATeleportNavigationUpdater()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.TickGroup = TG_PrePhysics;
+}
+
+ATeleportNavigationUpdater *ATeleportNavigationUpdater::FindOrSpawn(UWorld *World)
+{
+	if (World == nullptr)
+	{
+		return nullptr;
+	}
+
+	for (TActorIterator<ATeleportNavigationUpdater> It(World); It; ++It)
+	{
+		if (!It->IsPendingKill())
+		{
+			return *It;
+		}
+	}
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	return World->SpawnActor<ATeleportNavigationUpdater>(SpawnParameters);
+}
+
+void ATeleportNavigationUpdater::BeginPlay()
+{
+	Super::BeginPlay();
+
+	auto NavigationSystem = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+	if (NavigationSystem != nullptr)
+	{
+		NavigationSystem->OnNavigationGenerationFinishedDelegate.AddUniqueDynamic(this, &ATeleportNavigationUpdater::OnNavigationGenerated);
+	}
+}
+
+void ATeleportNavigationUpdater::OnNavigationGenerated(ANavigationData *NavData)
+{
+	// checked again when a character asks next
+	CheckedSurfaceIndices.Reset();
+}
+
+TSharedPtr<const FTeleportSurfaceValidity, ESPMode::ThreadSafe> ATeleportNavigationUpdater::GetSurfaceValidity(const UTeleportSurfaceIndex *Index)
+{
+	if (Index == nullptr)
+	{
+		return nullptr;
+	}
+
+	for (const auto &Checked : CheckedSurfaceIndices)
+	{
+		if (Checked.Index.Get() == Index)
+		{
+			return Checked.Validity;
+		}
+	}
+
+	auto Validity = MakeShared<FTeleportSurfaceValidity, ESPMode::ThreadSafe>();
+	auto NavMesh = GetNavMesh();
+	if (NavMesh != nullptr)
+	{
+		Index->Validate(*NavMesh, Validity.Get());
+	}
+
+	// a bake of an older navigation mesh would send us to places that are not there anymore
+	if (!Validity->bValid)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("ATeleportNavigationUpdater::GetSurfaceValidity() %s is stale, run the BakeTeleportSurfaces commandlet again"), *Index->GetPathName());
+	}
+	else if (Validity->NumStaleTiles > 0)
+	{
+		UE_LOG(LogTemp, Log, TEXT("ATeleportNavigationUpdater::GetSurfaceValidity() %d navigation tiles changed since %s was baked, they use the navigation mesh"), Validity->NumStaleTiles, *Index->GetPathName());
+	}
+
+	FCheckedSurfaceIndex Checked;
+	Checked.Index = Index;
+	Checked.Validity = Validity;
+	CheckedSurfaceIndices.Add(Checked);
+
+	return Validity;
+}
+
+ARecastNavMesh *ATeleportNavigationUpdater::GetNavMesh() const
+{
+	auto NavigationSystem = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+	return (NavigationSystem != nullptr) ? Cast<ARecastNavMesh>(NavigationSystem->GetDefaultNavDataInstance()) : nullptr;
+}
+
+void ATeleportNavigationUpdater::NotifyArchitectureMoved(UMovableArchitectureComponent *Component, const FBox &OldBounds, const FBox &NewBounds)
+{
+	auto World = GetWorld();
+	if ((World == nullptr) || (Component == nullptr))
+	{
+		return;
+	}
+
+	LastMoveTime = World->GetTimeSeconds();
+
+	if (!bHolding)
+	{
+		bHolding = true;
+		HoldStartTime = LastMoveTime;
+	}
+
+	// out of the octree, the places it passes on the way dirty nothing; only where it started and ends up count
+	auto Held = HeldArchitecture.FindByPredicate([Component](const FHeldArchitecture &Architecture) { return Architecture.Component.Get() == Component; });
+	if (Held != nullptr)
+	{
+		Held->EndBounds = NewBounds;
+		return;
+	}
+
+	Component->HoldNavigation();
+
+	FHeldArchitecture NewHeld;
+	NewHeld.Component = Component;
+	NewHeld.StartBounds = OldBounds;
+	NewHeld.EndBounds = NewBounds;
+	HeldArchitecture.Add(NewHeld);
+}
+
+bool ATeleportNavigationUpdater::IsInsideMovingArchitecture(const FVector &Location) const
+{
+	if (!bHolding && !bRebuilding)
+	{
+		return false;
+	}
+
+	// the mesh keeps an agent radius away from the geometry, same as the dirty tiles
+	auto NavMesh = GetNavMesh();
+	auto Margin = (NavMesh != nullptr) ? NavMesh->AgentRadius : 0.0f;
+
+	for (const auto &Held : HeldArchitecture)
+	{
+		if (Held.EndBounds.IsValid && Held.EndBounds.ExpandBy(Margin).IsInsideOrOn(Location))
+		{
+			return true;
+		}
+	}
+
+	for (const auto &Bounds : RebuildingBounds)
+	{
+		if (Bounds.ExpandBy(Margin).IsInsideOrOn(Location))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void ATeleportNavigationUpdater::AddDirtyTiles(const FBox &Bounds)
+{
+	auto NavMesh = GetNavMesh();
+	if ((NavMesh == nullptr) || !Bounds.IsValid)
+	{
+		return;
+	}
+
+	// the mesh changes up to an agent radius around the geometry
+	auto Expanded = Bounds.ExpandBy(NavMesh->AgentRadius);
+	auto TileSize = FMath::Max(NavMesh->TileSizeUU, 1.0f);
+
+	// recast tiles are laid out in the horizontal plane
+	for (int32 Y = FMath::FloorToInt(Expanded.Min.Y / TileSize); Y <= FMath::FloorToInt(Expanded.Max.Y / TileSize); Y++)
+	{
+		for (int32 X = FMath::FloorToInt(Expanded.Min.X / TileSize); X <= FMath::FloorToInt(Expanded.Max.X / TileSize); X++)
+		{
+			DirtyTiles.Add(FIntPoint(X, Y));
+		}
+	}
+}
+
+void ATeleportNavigationUpdater::ReleaseHeld()
+{
+	auto World = GetWorld();
+
+	bHolding = false;
+
+	// back into the octree at the new place, the dynamic generator rebuilds the tiles they dirty
+	// the navigation system dirties both places itself, when the actor left the octree and now; we only count them
+	for (auto &Held : HeldArchitecture)
+	{
+		AddDirtyTiles(Held.StartBounds);
+		AddDirtyTiles(Held.EndBounds);
+
+		if (Held.EndBounds.IsValid)
+		{
+			RebuildingBounds.Add(Held.EndBounds);
+		}
+
+		if (Held.Component.IsValid())
+		{
+			Held.Component->ReleaseNavigation();
+		}
+	}
+	HeldArchitecture.Reset();
+
+	if (World == nullptr)
+	{
+		return;
+	}
+
+	bRebuilding = true;
+	RebuildStartTime = World->GetTimeSeconds();
+	LastDirtyTiles = DirtyTiles.Num();
+	PeakTileTasks = 0;
+	DirtyTiles.Reset();
+
+	SET_DWORD_STAT(STAT_VRCharacter_NavDirtyTiles, LastDirtyTiles);
+}
+
+void ATeleportNavigationUpdater::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	auto World = GetWorld();
+	if (World == nullptr)
+	{
+		return;
+	}
+	auto Now = World->GetTimeSeconds();
+
+	if (bHolding)
+	{
+		auto bSettled = Now - LastMoveTime >= SettleTime;
+		auto bHeldTooLong = Now - HoldStartTime >= MaxHoldTime;
+		if (bSettled || bHeldTooLong)
+		{
+			ReleaseHeld();
+		}
+		return;
+	}
+
+	if (!bRebuilding)
+	{
+		return;
+	}
+
+	UpdateTileJobs();
+
+	auto NavMesh = GetNavMesh();
+	auto NumTasks = (NavMesh != nullptr) ? NavMesh->GetNumRemaningBuildTasks() : 0;
+	SET_DWORD_STAT(STAT_VRCharacter_NavTileTasks, NumTasks);
+	PeakTileTasks = FMath::Max(PeakTileTasks, NumTasks);
+
+	// the navigation system may take a frame to hand the dirty areas to the generator
+	auto NavigationSystem = FNavigationSystem::GetCurrent<UNavigationSystemV1>(World);
+	auto bBuilding = (NumTasks > 0) || ((NavigationSystem != nullptr) && NavigationSystem->IsNavigationBuildInProgress());
+	if (bBuilding || (Now - RebuildStartTime < DeltaSeconds))
+	{
+		return;
+	}
+
+	bRebuilding = false;
+	LastRebuildTime = Now - RebuildStartTime;
+	RebuildingBounds.Reset();
+
+	RestoreTileJobs();
+
+	SET_FLOAT_STAT(STAT_VRCharacter_NavRebuildTime, 1000.0f * LastRebuildTime);
+	CSV_CUSTOM_STAT(VRCharacter, NavRebuildMs, 1000.0f * LastRebuildTime, ECsvCustomStatOp::Set);
+	UE_LOG(LogTemp, Log, TEXT("ATeleportNavigationUpdater::Tick() rebuilt about %d navigation tiles in %.3f s, at most %d tile tasks at once"), LastDirtyTiles, LastRebuildTime, PeakTileTasks);
+
+	// something rebuilt more than the moved architecture dirtied, most likely the whole mesh
+	if (PeakTileTasks > LastDirtyTiles)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("ATeleportNavigationUpdater::Tick() %d tile tasks for about %d dirty tiles, the navigation mesh was rebuilt beyond the moved architecture"), PeakTileTasks, LastDirtyTiles);
+	}
+}
+
+void ATeleportNavigationUpdater::UpdateTileJobs()
+{
+	auto NavMesh = GetNavMesh();
+	if (NavMesh == nullptr)
+	{
+		return;
+	}
+
+	// every finished tile is swapped in on the game thread, so fewer jobs also means less game thread work per frame
+	// the character's frame budget knows whether we are short on time, a long frame alone may as well be the GPU
+	auto NewTileJobs = IsFrameBudgetDegraded() ? 1 : MaxTileJobs;
+	if (NewTileJobs != TileJobs)
+	{
+		if (OriginalTileJobs < 0)
+		{
+			OriginalTileJobs = NavMesh->GetMaxSimultaneousTileGenerationJobsCount();
+		}
+
+		TileJobs = NewTileJobs;
+		NavMesh->SetMaxSimultaneousTileGenerationJobsCount(TileJobs);
+	}
+}
+
+void ATeleportNavigationUpdater::RestoreTileJobs()
+{
+	if (OriginalTileJobs < 0)
+	{
+		return;
+	}
+
+	auto NavMesh = GetNavMesh();
+	if (NavMesh != nullptr)
+	{
+		NavMesh->SetMaxSimultaneousTileGenerationJobsCount(OriginalTileJobs);
+	}
+
+	OriginalTileJobs = -1;
+	TileJobs = 0;
+}
+
+bool ATeleportNavigationUpdater::IsFrameBudgetDegraded() const
+{
+	auto World = GetWorld();
+	auto PlayerController = (World != nullptr) ? World->GetFirstPlayerController() : nullptr;
+	if ((PlayerController == nullptr) || !PlayerController->IsLocalController())
+	{
+		return false;
+	}
+
+	auto Character = Cast<AVRCharacter>(PlayerController->GetPawn());
+	return (Character != nullptr) && (Character->GetFrameBudget().GetLevel() != EVRDegradationLevel::Full);
+}
+
+void ATeleportNavigationUpdater::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (bHolding)
+	{
+		ReleaseHeld();
+	}
+
+	RestoreTileJobs();
+
+	Super::EndPlay(EndPlayReason);
+}
@@ -0,0 +1,122 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "TeleportSearchBatch.h"
+#include "VRCharacter.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "HAL/PlatformTime.h"
+
+ATeleportSearchBatch::ATeleportSearchBatch()
+{
+	// after the characters set their controller poses, same group as UTeleportSearchComponent
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.TickGroup = TG_DuringPhysics;
+}
+
+ATeleportSearchBatch *ATeleportSearchBatch::FindOrSpawn(UWorld *World)
+{
+	if (World == nullptr)
+	{
+		return nullptr;
+	}
+
+	for (TActorIterator<ATeleportSearchBatch> It(World); It; ++It)
+	{
+		if (!It->IsPendingKill())
+		{
+			return *It;
+		}
+	}
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	return World->SpawnActor<ATeleportSearchBatch>(SpawnParameters);
+}
+
+void ATeleportSearchBatch::RegisterCharacter(AVRCharacter *Character)
+{
+	if (!ensure(Character != nullptr) || Characters.Contains(Character))
+	{
+		return;
+	}
+
+	Characters.Add(Character);
+	AddTickPrerequisiteActor(Character);
+
+	FrameCharacters.Reserve(Characters.Num());
+	FrameJobs.Reserve(Characters.Num());
+	FrameTraceTasks.Reserve(Characters.Num());
+}
+
+void ATeleportSearchBatch::UnregisterCharacter(AVRCharacter *Character)
+{
+	if (Characters.Remove(Character) > 0)
+	{
+		RemoveTickPrerequisiteActor(Character);
+	}
+}
+
+void ATeleportSearchBatch::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	auto StartCycles = FPlatformTime::Cycles64();
+
+	LastBatchMilliseconds = 0.0f;
+
+	FrameCharacters.Reset();
+	for (auto Character : Characters)
+	{
+		if ((Character != nullptr) && !Character->IsPendingKill() && Character->bWantsTeleportSearchBatch())
+		{
+			FrameCharacters.Add(Character);
+		}
+	}
+
+	if (FrameCharacters.Num() == 0)
+	{
+		return;
+	}
+
+	FrameJobs.Reset();
+	for (auto Character : FrameCharacters)
+	{
+		auto Job = Character->GetTeleportSearchJobToTrace();
+		if (Job != nullptr)
+		{
+			FrameJobs.Add(Job);
+		}
+	}
+
+	// a job only writes to itself, and scene queries may run on any thread
+	// graph tasks come from the task graph's pool, unlike ParallelFor they don't allocate every frame
+	if (FrameJobs.Num() >= MinParallelSearches)
+	{
+		FrameTraceTasks.Reset();
+		for (int32 Index = 1; Index < FrameJobs.Num(); Index++)
+		{
+			FrameTraceTasks.Add(FTeleportSearchTraceTask::Dispatch(*FrameJobs[Index]));
+		}
+
+		// the game thread would only wait otherwise
+		FrameJobs[0]->Trace();
+
+		FTaskGraphInterface::Get().WaitUntilTasksComplete(FrameTraceTasks, ENamedThreads::GameThread);
+		FrameTraceTasks.Reset();
+	}
+	else
+	{
+		for (auto Job : FrameJobs)
+		{
+			Job->Trace();
+		}
+	}
+
+	// navigation queries and component updates, one character at a time
+	for (auto Character : FrameCharacters)
+	{
+		Character->ApplyTeleportDestinationSearch();
+	}
+
+	LastBatchMilliseconds = (float)FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+}
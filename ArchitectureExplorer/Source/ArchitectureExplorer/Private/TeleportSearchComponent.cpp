@@ -0,0 +1,110 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "TeleportSearchComponent.h"
+#include "VRCharacter.h"
+
+void FTeleportMarkerTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef &MyCompletionGraphEvent)
+{
+	if ((Target != nullptr) && !Target->IsPendingKill())
+	{
+		Target->TickMarker();
+	}
+}
+
+FString FTeleportMarkerTickFunction::DiagnosticMessage()
+{
+	return (Target != nullptr) ? Target->GetFullName() + TEXT("[TickMarker]") : TEXT("UTeleportSearchComponent[TickMarker]");
+}
+
+UTeleportSearchComponent::UTeleportSearchComponent()
+{
+	// during physics: the physics simulation and the other actors keep going while we trace
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.TickGroup = TG_DuringPhysics;
+
+	MarkerTickFunction.bCanEverTick = true;
+	MarkerTickFunction.bRunOnAnyThread = false;
+}
+
+void UTeleportSearchComponent::RegisterComponentTickFunctions(bool bRegister)
+{
+	// has to be decided before the tick function gets registered
+	PrimaryComponentTick.bRunOnAnyThread = bSearchOnWorkerThread;
+
+	Super::RegisterComponentTickFunctions(bRegister);
+
+	if (!bRegister)
+	{
+		if (MarkerTickFunction.IsTickFunctionRegistered())
+		{
+			MarkerTickFunction.UnRegisterTickFunction();
+		}
+		return;
+	}
+
+	auto Owner = GetOwner();
+
+	// the search reads the controller pose the character set up in its tick
+	if ((Owner != nullptr) && Owner->PrimaryActorTick.bCanEverTick)
+	{
+		PrimaryComponentTick.AddPrerequisite(Owner, Owner->PrimaryActorTick);
+	}
+
+	// the marker follows the search in the same group and at the same rate
+	MarkerTickFunction.TickGroup = PrimaryComponentTick.TickGroup;
+	MarkerTickFunction.EndTickGroup = PrimaryComponentTick.EndTickGroup;
+	MarkerTickFunction.TickInterval = PrimaryComponentTick.TickInterval;
+
+	if (SetupActorComponentTickFunction(&MarkerTickFunction))
+	{
+		MarkerTickFunction.Target = this;
+		MarkerTickFunction.AddPrerequisite(this, PrimaryComponentTick);
+	}
+}
+
+bool UTeleportSearchComponent::IsSearching() const
+{
+	return IsRegistered() && IsComponentTickEnabled();
+}
+
+void UTeleportSearchComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction *ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	auto Character = Cast<AVRCharacter>(GetOwner());
+	if (Character == nullptr)
+	{
+		return;
+	}
+
+	if (!PrimaryComponentTick.bRunOnAnyThread)
+	{
+		Character->SearchTeleportDestination();
+		return;
+	}
+
+	// only the job the character set up in its tick, TickMarker finishes it on the game thread
+	// (no stage scope here either, the stats belong to the game thread; the job times itself)
+	auto Job = Character->GetTeleportSearchJobToTrace();
+	if (Job != nullptr)
+	{
+		Job->Trace();
+	}
+}
+
+void UTeleportSearchComponent::TickMarker()
+{
+	// the search was switched off, the character tick does it again
+	if (!IsComponentTickEnabled())
+	{
+		return;
+	}
+
+	auto Character = Cast<AVRCharacter>(GetOwner());
+	if (Character == nullptr)
+	{
+		return;
+	}
+
+	Character->ApplyTeleportDestinationSearch();
+}
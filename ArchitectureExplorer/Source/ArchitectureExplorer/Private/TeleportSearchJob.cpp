@@ -0,0 +1,82 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "TeleportSearchJob.h"
+#include "TeleportSurfaceIndex.h"
+#include "HAL/PlatformTime.h"
+
+void FTeleportSearchJob::Reset()
+{
+	World = nullptr;
+	QueryParams = nullptr;
+	SurfaceIndex = nullptr;
+	SurfaceValidity.Reset();
+	ProjectionExtent = FVector::ZeroVector;
+
+	ControllerLocation = FVector::ZeroVector;
+	ControllerForward = FVector::ForwardVector;
+	Arc = FTeleportArcParams();
+
+	bPending = false;
+	bFromCache = false;
+	bTraced = false;
+
+	Result = FTeleportSearchResult();
+	bArcHit = false;
+	HitLocation = FVector::ZeroVector;
+	HitTime = 0.0f;
+	bResolved = false;
+	bSurfaceIndexMissed = false;
+
+	NumQueries = 0;
+	TraceMilliseconds = 0.0f;
+}
+
+void FTeleportSearchJob::Trace()
+{
+	if (!bNeedsTrace() || (World == nullptr) || (QueryParams == nullptr))
+	{
+		return;
+	}
+	bTraced = true;
+
+	auto StartCycles = FPlatformTime::Cycles64();
+
+	FHitResult HitResult;
+	bArcHit = Tracer.bTrace(World, Arc, *QueryParams, HitResult);
+	NumQueries += Tracer.GetNumQueries();
+
+	if (bArcHit)
+	{
+		HitLocation = HitResult.Location;
+		HitTime = Tracer.GetHitTime();
+
+		// what the baked index finds is on the navigation mesh; what it misses the game thread asks the navigation mesh for
+		if (SurfaceIndex != nullptr)
+		{
+			bResolved = SurfaceIndex->bFindSurface(HitLocation, ProjectionExtent, Result.Location, SurfaceValidity.Get());
+			Result.bFound = bResolved;
+			bSurfaceIndexMissed = !bResolved;
+		}
+	}
+
+	TraceMilliseconds += (float)FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+}
+
+void FTeleportFanCandidate::Trace(UWorld *World, const FCollisionQueryParams &QueryParams, FTeleportArcTracer &Tracer, uint64 DeadlineCycles)
+{
+	if ((World == nullptr) || (FPlatformTime::Cycles64() > DeadlineCycles))
+	{
+		bSkipped = true;
+		return;
+	}
+
+	FHitResult HitResult;
+	bHit = Tracer.bTrace(World, Arc, QueryParams, HitResult);
+	NumQueries = Tracer.GetNumQueries();
+
+	if (bHit)
+	{
+		HitLocation = HitResult.Location;
+		HitTime = Tracer.GetHitTime();
+	}
+}
@@ -0,0 +1,465 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "TeleportSurfaceIndex.h"
+#include "NavMesh/RecastNavMesh.h"
+#include "Misc/PackageName.h"
+#include "Misc/Crc.h"
+
+namespace
+{
+	// heights closer than this in one cell are the same floor
+	const float LayerMergeTolerance = 10.0f; // centimeters
+
+	// how many cells around the hit cell we look at when the hit is not above a surface
+	// this bounds the lookup cost no matter how big TeleportProjectionExtent is
+	const int32 MaxSearchReach = 4;
+
+	// polygon vertices are rounded to this before they go into the signature
+	const float SignatureQuantization = 1.0f; // centimeters
+
+	// true if Heights has one within LayerMergeTolerance of Height
+	bool bHasLayer(const TArray<float> &Heights, float Height)
+	{
+		return Heights.ContainsByPredicate([Height](float Layer) { return FMath::Abs(Layer - Height) <= LayerMergeTolerance; });
+	}
+
+	// add the polygons of one tile to Crc, returns false if the tile has none
+	// Polys and PolyVerts are scratch arrays
+	bool bHashTile(const ARecastNavMesh &NavMesh, int32 TileIndex, uint32 &Crc, TArray<FNavPoly> &Polys, TArray<FVector> &PolyVerts)
+	{
+		if (!NavMesh.GetPolysInTile(TileIndex, Polys))
+		{
+			return false;
+		}
+
+		// the center alone misses a polygon that changed shape around the same center, and a changed area or flag
+		for (const auto &Poly : Polys)
+		{
+			if (!NavMesh.GetPolyVerts(Poly.Ref, PolyVerts))
+			{
+				PolyVerts.Reset();
+			}
+
+			int32 NumVerts = PolyVerts.Num();
+			Crc = FCrc::MemCrc32(&NumVerts, sizeof(NumVerts), Crc);
+
+			for (const auto &Vert : PolyVerts)
+			{
+				// quantize so the signature does not depend on float noise
+				FIntVector Quantized(
+					FMath::RoundToInt(Vert.X / SignatureQuantization),
+					FMath::RoundToInt(Vert.Y / SignatureQuantization),
+					FMath::RoundToInt(Vert.Z / SignatureQuantization));
+				Crc = FCrc::MemCrc32(&Quantized, sizeof(Quantized), Crc);
+			}
+
+			uint16 Flags[2] = { 0, 0 };
+			NavMesh.GetPolyFlags(Poly.Ref, Flags[0], Flags[1]);
+			Crc = FCrc::MemCrc32(Flags, sizeof(Flags), Crc);
+		}
+
+		return true;
+	}
+
+	// checksum and bounds of every tile of NavMesh that has polygons
+	void ComputeTileSignatures(const ARecastNavMesh &NavMesh, TArray<FIntVector> &OutCoords, TArray<int32> &OutSignatures, TArray<FBox> &OutBounds)
+	{
+		OutCoords.Reset();
+		OutSignatures.Reset();
+		OutBounds.Reset();
+
+		TArray<FNavPoly> Polys;
+		TArray<FVector> PolyVerts;
+		for (int32 TileIndex = 0; TileIndex < NavMesh.GetNavMeshTilesCount(); TileIndex++)
+		{
+			int32 X, Y, Layer;
+			uint32 Crc = 0;
+			if (!NavMesh.GetNavMeshTileXY(TileIndex, X, Y, Layer) || !bHashTile(NavMesh, TileIndex, Crc, Polys, PolyVerts))
+			{
+				continue;
+			}
+
+			OutCoords.Add(FIntVector(X, Y, Layer));
+			OutSignatures.Add(static_cast<int32>(Crc));
+			OutBounds.Add(NavMesh.GetNavMeshTileBounds(TileIndex));
+		}
+	}
+}
+
+FString UTeleportSurfaceIndex::GetPackageNameForMap(const FString &MapPackageName)
+{
+	return FString::Printf(TEXT("/Game/TeleportSurfaces/%s_TeleportSurfaces"), *FPackageName::GetShortName(MapPackageName));
+}
+
+int32 UTeleportSurfaceIndex::ComputeNavSignature(const ARecastNavMesh &NavMesh)
+{
+	uint32 Crc = 0;
+
+	TArray<FNavPoly> Polys;
+	TArray<FVector> PolyVerts;
+	for (int32 TileIndex = 0; TileIndex < NavMesh.GetNavMeshTilesCount(); TileIndex++)
+	{
+		bHashTile(NavMesh, TileIndex, Crc, Polys, PolyVerts);
+	}
+
+	return static_cast<int32>(Crc);
+}
+
+void UTeleportSurfaceIndex::Validate(const ARecastNavMesh &NavMesh, FTeleportSurfaceValidity &OutValidity) const
+{
+	OutValidity = FTeleportSurfaceValidity();
+
+	// a bake from before the tile checksums
+	if (TileCoords.Num() == 0)
+	{
+		OutValidity.bValid = (ComputeNavSignature(NavMesh) == NavSignature);
+		return;
+	}
+
+	if ((TileSignatures.Num() != TileCoords.Num()) || (TileBounds.Num() != TileCoords.Num()))
+	{
+		return;
+	}
+
+	TArray<FIntVector> Coords;
+	TArray<int32> Signatures;
+	TArray<FBox> Bounds;
+	ComputeTileSignatures(NavMesh, Coords, Signatures, Bounds);
+
+	OutValidity.bValid = true;
+	OutValidity.StaleCells.Init(false, SizeX * SizeY);
+
+	TMap<FIntVector, int32> BakedTiles;
+	BakedTiles.Reserve(TileCoords.Num());
+	for (int32 Index = 0; Index < TileCoords.Num(); Index++)
+	{
+		BakedTiles.Add(TileCoords[Index], Index);
+	}
+
+	// tiles that are new or different; the old surfaces may be gone and the new ones the grid doesn't know
+	for (int32 Index = 0; Index < Coords.Num(); Index++)
+	{
+		int32 BakedIndex = INDEX_NONE;
+		if (BakedTiles.RemoveAndCopyValue(Coords[Index], BakedIndex) && (TileSignatures[BakedIndex] == Signatures[Index]))
+		{
+			continue;
+		}
+
+		if (BakedIndex != INDEX_NONE)
+		{
+			MarkStaleCells(TileBounds[BakedIndex], OutValidity);
+		}
+		MarkStaleCells(Bounds[Index], OutValidity);
+		OutValidity.NumStaleTiles++;
+	}
+
+	// tiles that are gone
+	for (const auto &BakedTile : BakedTiles)
+	{
+		MarkStaleCells(TileBounds[BakedTile.Value], OutValidity);
+		OutValidity.NumStaleTiles++;
+	}
+
+	if (OutValidity.NumStaleTiles == 0)
+	{
+		OutValidity.StaleCells.Empty();
+	}
+}
+
+void UTeleportSurfaceIndex::MarkStaleCells(const FBox &Bounds, FTeleportSurfaceValidity &OutValidity) const
+{
+	if (!Bounds.IsValid || (OutValidity.StaleCells.Num() != SizeX * SizeY))
+	{
+		return;
+	}
+
+	// a cell that the tile only touches at its edge may hold a surface of the tile too
+	int32 MinX = FMath::FloorToInt((Bounds.Min.X - Origin.X) / CellSize);
+	int32 MaxX = FMath::FloorToInt((Bounds.Max.X - Origin.X) / CellSize);
+	int32 MinY = FMath::FloorToInt((Bounds.Min.Y - Origin.Y) / CellSize);
+	int32 MaxY = FMath::FloorToInt((Bounds.Max.Y - Origin.Y) / CellSize);
+
+	for (int32 CellY = FMath::Max(MinY, 0); CellY <= FMath::Min(MaxY, SizeY - 1); CellY++)
+	{
+		for (int32 CellX = FMath::Max(MinX, 0); CellX <= FMath::Min(MaxX, SizeX - 1); CellX++)
+		{
+			OutValidity.StaleCells[CellY * SizeX + CellX] = true;
+		}
+	}
+}
+
+bool UTeleportSurfaceIndex::bProjectOntoPolygon(const TArray<FVector> &PolyVerts, const FVector &Point, float &OutZ)
+{
+	const int32 NumVerts = PolyVerts.Num();
+	if (NumVerts < 3)
+	{
+		return false;
+	}
+
+	// the polygon is convex, so Point is inside (seen from above)
+	// if it is on the same side of every edge
+	float Winding = 0.0f;
+	for (int32 Index = 0; Index < NumVerts; Index++)
+	{
+		const FVector &EdgeStart = PolyVerts[Index];
+		const FVector &EdgeEnd = PolyVerts[(Index + 1) % NumVerts];
+
+		float Side = (EdgeEnd.X - EdgeStart.X) * (Point.Y - EdgeStart.Y) - (EdgeEnd.Y - EdgeStart.Y) * (Point.X - EdgeStart.X);
+		if (FMath::IsNearlyZero(Side))
+		{
+			continue;
+		}
+		if (Winding == 0.0f)
+		{
+			Winding = FMath::Sign(Side);
+		}
+		else if (FMath::Sign(Side) != Winding)
+		{
+			return false;
+		}
+	}
+
+	// height of the polygon plane below/above Point
+	FVector PlaneNormal = FVector::CrossProduct(PolyVerts[1] - PolyVerts[0], PolyVerts[2] - PolyVerts[0]);
+	if (FMath::IsNearlyZero(PlaneNormal.Z))
+	{
+		return false;
+	}
+
+	const FVector &PlanePoint = PolyVerts[0];
+	OutZ = PlanePoint.Z - (PlaneNormal.X * (Point.X - PlanePoint.X) + PlaneNormal.Y * (Point.Y - PlanePoint.Y)) / PlaneNormal.Z;
+	return true;
+}
+
+bool UTeleportSurfaceIndex::bBake(const ARecastNavMesh &NavMesh, float InCellSize)
+{
+	CellSize = FMath::Max(InCellSize, 1.0f);
+
+	// collect all polygons first, we need their bounds to size the grid
+	TArray<TArray<FVector>> AllPolyVerts;
+	FBox NavBounds(ForceInit);
+
+	TArray<FNavPoly> Polys;
+	for (int32 TileIndex = 0; TileIndex < NavMesh.GetNavMeshTilesCount(); TileIndex++)
+	{
+		if (!NavMesh.GetPolysInTile(TileIndex, Polys))
+		{
+			continue;
+		}
+
+		for (const auto &Poly : Polys)
+		{
+			TArray<FVector> PolyVerts;
+			if (NavMesh.GetPolyVerts(Poly.Ref, PolyVerts) && (PolyVerts.Num() >= 3))
+			{
+				for (const auto &Vert : PolyVerts)
+				{
+					NavBounds += Vert;
+				}
+				AllPolyVerts.Add(MoveTemp(PolyVerts));
+			}
+		}
+	}
+
+	if (AllPolyVerts.Num() == 0)
+	{
+		return false;
+	}
+
+	Origin = FVector2D(NavBounds.Min.X, NavBounds.Min.Y);
+	SizeX = FMath::Max(FMath::CeilToInt((NavBounds.Max.X - NavBounds.Min.X) / CellSize), 1);
+	SizeY = FMath::Max(FMath::CeilToInt((NavBounds.Max.Y - NavBounds.Min.Y) / CellSize), 1);
+
+	// rasterize every polygon into the cells whose centers it covers, and into the cell corners it covers
+	TArray<TArray<float>> CellLayers;
+	CellLayers.SetNum(SizeX * SizeY);
+
+	const int32 CornersX = SizeX + 1;
+	TArray<TArray<float>> CornerLayers;
+	CornerLayers.SetNum(CornersX * (SizeY + 1));
+
+	for (const auto &PolyVerts : AllPolyVerts)
+	{
+		FBox PolyBounds(PolyVerts);
+		int32 MinX = FMath::Clamp(FMath::FloorToInt((PolyBounds.Min.X - Origin.X) / CellSize), 0, SizeX - 1);
+		int32 MaxX = FMath::Clamp(FMath::FloorToInt((PolyBounds.Max.X - Origin.X) / CellSize), 0, SizeX - 1);
+		int32 MinY = FMath::Clamp(FMath::FloorToInt((PolyBounds.Min.Y - Origin.Y) / CellSize), 0, SizeY - 1);
+		int32 MaxY = FMath::Clamp(FMath::FloorToInt((PolyBounds.Max.Y - Origin.Y) / CellSize), 0, SizeY - 1);
+
+		for (int32 CellY = MinY; CellY <= MaxY; CellY++)
+		{
+			for (int32 CellX = MinX; CellX <= MaxX; CellX++)
+			{
+				FVector CellCenter(Origin.X + (CellX + 0.5f) * CellSize, Origin.Y + (CellY + 0.5f) * CellSize, 0.0f);
+
+				float Height;
+				if (!bProjectOntoPolygon(PolyVerts, CellCenter, Height))
+				{
+					continue;
+				}
+
+				auto &Layers = CellLayers[CellY * SizeX + CellX];
+				if (!bHasLayer(Layers, Height))
+				{
+					Layers.Add(Height);
+				}
+			}
+		}
+
+		// corner (X, Y) is the minimum corner of cell (X, Y), so the corners of the cells above are one further
+		for (int32 CornerY = MinY; CornerY <= MaxY + 1; CornerY++)
+		{
+			for (int32 CornerX = MinX; CornerX <= MaxX + 1; CornerX++)
+			{
+				FVector Corner(Origin.X + CornerX * CellSize, Origin.Y + CornerY * CellSize, 0.0f);
+
+				float Height;
+				if (!bProjectOntoPolygon(PolyVerts, Corner, Height))
+				{
+					continue;
+				}
+
+				auto &Layers = CornerLayers[CornerY * CornersX + CornerX];
+				if (!bHasLayer(Layers, Height))
+				{
+					Layers.Add(Height);
+				}
+			}
+		}
+	}
+
+	// flatten into the compact layout
+	CellLayerStart.Reset(CellLayers.Num() + 1);
+	LayerHeights.Reset();
+	LayerFullyCovered.Reset();
+
+	for (int32 CellY = 0; CellY < SizeY; CellY++)
+	{
+		for (int32 CellX = 0; CellX < SizeX; CellX++)
+		{
+			CellLayerStart.Add(LayerHeights.Num());
+
+			for (auto Height : CellLayers[CellY * SizeX + CellX])
+			{
+				// a wall or a hole in the floor inside the cell leaves at least one corner uncovered
+				// (a hole between the corners slips through, the cell size bounds how big it can be)
+				bool bFullyCovered =
+					bHasLayer(CornerLayers[CellY * CornersX + CellX], Height) &&
+					bHasLayer(CornerLayers[CellY * CornersX + CellX + 1], Height) &&
+					bHasLayer(CornerLayers[(CellY + 1) * CornersX + CellX], Height) &&
+					bHasLayer(CornerLayers[(CellY + 1) * CornersX + CellX + 1], Height);
+
+				LayerHeights.Add(Height);
+				LayerFullyCovered.Add(bFullyCovered ? 1 : 0);
+			}
+		}
+	}
+	CellLayerStart.Add(LayerHeights.Num());
+
+	NavSignature = ComputeNavSignature(NavMesh);
+	ComputeTileSignatures(NavMesh, TileCoords, TileSignatures, TileBounds);
+
+	return true;
+}
+
+int32 UTeleportSurfaceIndex::GetCellLayers(int32 CellX, int32 CellY, const float *&OutHeights, int32 &OutFirstLayer) const
+{
+	if ((CellX < 0) || (CellX >= SizeX) || (CellY < 0) || (CellY >= SizeY))
+	{
+		return 0;
+	}
+
+	int32 CellIndex = CellY * SizeX + CellX;
+	OutFirstLayer = CellLayerStart[CellIndex];
+	OutHeights = LayerHeights.GetData() + OutFirstLayer;
+
+	return CellLayerStart[CellIndex + 1] - OutFirstLayer;
+}
+
+FVector UTeleportSurfaceIndex::GetCellCenter(int32 CellX, int32 CellY, float Z) const
+{
+	return FVector(Origin.X + (CellX + 0.5f) * CellSize, Origin.Y + (CellY + 0.5f) * CellSize, Z);
+}
+
+bool UTeleportSurfaceIndex::bFindSurface(const FVector &Location, const FVector &Extent, FVector &OutLocation, const FTeleportSurfaceValidity *Validity) const
+{
+	// an index baked before the corner coverage existed has none, rebake it
+	if ((SizeX <= 0) || (SizeY <= 0) || (CellLayerStart.Num() != SizeX * SizeY + 1) || (LayerFullyCovered.Num() != LayerHeights.Num()))
+	{
+		return false;
+	}
+
+	if ((Validity != nullptr) && !Validity->bValid)
+	{
+		return false;
+	}
+
+	int32 HitX = FMath::FloorToInt((Location.X - Origin.X) / CellSize);
+	int32 HitY = FMath::FloorToInt((Location.Y - Origin.Y) / CellSize);
+
+	// the navigation mesh changed under the hit since the bake, it has to answer itself
+	auto bIsStale = [this, Validity](int32 CellX, int32 CellY) { return (Validity != nullptr) && Validity->bIsCellStale(CellY * SizeX + CellX); };
+	if ((HitX >= 0) && (HitX < SizeX) && (HitY >= 0) && (HitY < SizeY) && bIsStale(HitX, HitY))
+	{
+		return false;
+	}
+
+	// the common case: we hit a floor straight on
+	// the hit itself is only known to be on the floor if the floor covers the whole cell, otherwise the center is
+	const float *Heights = nullptr;
+	int32 FirstLayer = 0;
+	int32 NumLayers = GetCellLayers(HitX, HitY, Heights, FirstLayer);
+	for (int32 Layer = 0; Layer < NumLayers; Layer++)
+	{
+		if (FMath::Abs(Location.Z - Heights[Layer]) <= Extent.Z)
+		{
+			OutLocation = LayerFullyCovered[FirstLayer + Layer] ? FVector(Location.X, Location.Y, Heights[Layer]) : GetCellCenter(HitX, HitY, Heights[Layer]);
+			return true;
+		}
+	}
+
+	// otherwise (walls, furniture) take the closest cell center within the extent,
+	// like ProjectPointToNavigation does with the closest point
+	int32 ReachX = FMath::Min(FMath::CeilToInt(Extent.X / CellSize), MaxSearchReach);
+	int32 ReachY = FMath::Min(FMath::CeilToInt(Extent.Y / CellSize), MaxSearchReach);
+
+	bool bFound = false;
+	float BestDistanceSquared = TNumericLimits<float>::Max();
+
+	for (int32 CellY = HitY - ReachY; CellY <= HitY + ReachY; CellY++)
+	{
+		for (int32 CellX = HitX - ReachX; CellX <= HitX + ReachX; CellX++)
+		{
+			NumLayers = GetCellLayers(CellX, CellY, Heights, FirstLayer);
+			if ((NumLayers == 0) || bIsStale(CellX, CellY))
+			{
+				continue;
+			}
+
+			auto Center = GetCellCenter(CellX, CellY, 0.0f);
+			if ((FMath::Abs(Center.X - Location.X) > Extent.X) || (FMath::Abs(Center.Y - Location.Y) > Extent.Y))
+			{
+				continue;
+			}
+
+			for (int32 Layer = 0; Layer < NumLayers; Layer++)
+			{
+				if (FMath::Abs(Location.Z - Heights[Layer]) > Extent.Z)
+				{
+					continue;
+				}
+
+				Center.Z = Heights[Layer];
+				float DistanceSquared = FVector::DistSquared(Center, Location);
+				if (DistanceSquared < BestDistanceSquared)
+				{
+					BestDistanceSquared = DistanceSquared;
+					OutLocation = Center;
+					bFound = true;
+				}
+			}
+		}
+	}
+
+	return bFound;
+}
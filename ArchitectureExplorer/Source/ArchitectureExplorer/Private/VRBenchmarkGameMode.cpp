@@ -0,0 +1,429 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "VRBenchmarkGameMode.h"
+#include "VRCharacter.h"
+#include "VRCharacterStats.h"
+#include "MotionControllerComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "HAL/PlatformMisc.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonWriter.h"
+#include "Serialization/JsonSerializer.h"
+
+namespace
+{
+	enum class EVRBenchmarkScenario : uint8
+	{
+		// swing the controller left/right and up/down so the arc lands all over the room
+		SweepArcs,
+		// point level all around us, the arc mostly ends on walls
+		AimAtWalls,
+		// pitch from the feet to above the horizon so the hit crosses the navigation mesh edge
+		AimAcrossNavMeshEdge,
+		// aim at the floor in a few directions and teleport there
+		TeleportSequence,
+	};
+
+	struct FVRBenchmarkScenario
+	{
+		const TCHAR *Name;
+		EVRBenchmarkScenario Kind;
+		// aiming must not allocate once warmed up; teleporting fades the camera, sets timers and may prefetch levels
+		bool bNoAllocations;
+	};
+
+	// SweepArcs runs the async search, AimAtWalls and AimAcrossNavMeshEdge mostly end up in the fan
+	const FVRBenchmarkScenario Scenarios[] =
+	{
+		{ TEXT("SweepArcs"), EVRBenchmarkScenario::SweepArcs, true },
+		{ TEXT("AimAtWalls"), EVRBenchmarkScenario::AimAtWalls, true },
+		{ TEXT("AimAcrossNavMeshEdge"), EVRBenchmarkScenario::AimAcrossNavMeshEdge, true },
+		{ TEXT("TeleportSequence"), EVRBenchmarkScenario::TeleportSequence, false },
+	};
+
+	// roughly where a right hand is relative to the VR root
+	const FVector ControllerLocation(30.0f, 20.0f, 0.0f);
+
+	// launch velocities of the arc tracer check: steep down to steep up, all around us, slow and fast
+	const float ArcCheckPitches[] = { -60.0f, -30.0f, -10.0f, 0.0f, 15.0f, 30.0f, 45.0f };
+	const float ArcCheckSpeeds[] = { 400.0f, 600.0f, 1000.0f }; // centimeters per second
+	const int32 ArcCheckYaws = 8;
+
+	// controller rotation for a scenario at Alpha (0 to 1 through the scenario)
+	FRotator GetScenarioAim(EVRBenchmarkScenario Kind, float Alpha)
+	{
+		switch (Kind)
+		{
+		case EVRBenchmarkScenario::SweepArcs:
+			return FRotator(-10.0f + 25.0f * FMath::Sin(2.0f * PI * 3.0f * Alpha), 90.0f * FMath::Sin(2.0f * PI * 2.0f * Alpha), 0.0f);
+
+		case EVRBenchmarkScenario::AimAtWalls:
+			return FRotator(5.0f, 360.0f * Alpha, 0.0f);
+
+		case EVRBenchmarkScenario::AimAcrossNavMeshEdge:
+		{
+			// ping-pong between -60 and 45 degrees
+			float PingPong = 1.0f - FMath::Abs(2.0f * FMath::Fractional(2.0f * Alpha) - 1.0f);
+			return FRotator(FMath::Lerp(-60.0f, 45.0f, PingPong), 0.0f, 0.0f);
+		}
+
+		case EVRBenchmarkScenario::TeleportSequence:
+		default:
+			// four directions, a quarter of the scenario each
+			return FRotator(-20.0f, 90.0f * FMath::FloorToFloat(4.0f * Alpha), 0.0f);
+		}
+	}
+
+	TSharedRef<FJsonObject> MakeSummary(const FVRStatHistory &History)
+	{
+		TSharedRef<FJsonObject> Summary = MakeShared<FJsonObject>();
+
+		float Min = 0.0f, Average = 0.0f, P99 = 0.0f;
+		History.bGetSummary(Min, Average, P99);
+
+		Summary->SetNumberField(TEXT("min"), Min);
+		Summary->SetNumberField(TEXT("avg"), Average);
+		Summary->SetNumberField(TEXT("p99"), P99);
+		return Summary;
+	}
+
+	// child object of a JSON object, or null if there is none
+	TSharedPtr<FJsonObject> FindObjectField(const FJsonObject &Parent, const FString &Name)
+	{
+		const TSharedPtr<FJsonObject> *Child = nullptr;
+		return Parent.TryGetObjectField(Name, Child) ? *Child : nullptr;
+	}
+}
+
+AVRBenchmarkGameMode::AVRBenchmarkGameMode()
+{
+	// we move the controller before the character ticks (see Tick)
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.TickGroup = TG_PrePhysics;
+
+	BenchmarkPawnClass = TSoftClassPtr<AVRCharacter>(FSoftObjectPath(TEXT("/Game/Blueprints/BP_VRCharacter.BP_VRCharacter_C")));
+}
+
+void AVRBenchmarkGameMode::InitGame(const FString &MapName, const FString &Options, FString &ErrorMessage)
+{
+	auto PawnClass = BenchmarkPawnClass.LoadSynchronous();
+	if (PawnClass != nullptr)
+	{
+		DefaultPawnClass = PawnClass;
+	}
+	else
+	{
+		UE_LOG(LogTemp, Warning, TEXT("AVRBenchmarkGameMode::InitGame() unable to load %s, benchmarking the plain AVRCharacter"), *BenchmarkPawnClass.ToString());
+		DefaultPawnClass = AVRCharacter::StaticClass();
+	}
+
+	Super::InitGame(MapName, Options, ErrorMessage);
+
+	OutputFilename = FPaths::ProjectSavedDir() / TEXT("Benchmarks") / TEXT("VRCharacter.json");
+	FParse::Value(FCommandLine::Get(), TEXT("VRBenchmarkOutput="), OutputFilename);
+	FParse::Value(FCommandLine::Get(), TEXT("VRBenchmarkBaseline="), BaselineFilename);
+	FParse::Value(FCommandLine::Get(), TEXT("VRBenchmarkThreshold="), RegressionThreshold);
+
+	// as early as possible, everything allocated before is freed through the counter just the same
+	if (bCheckAllocations)
+	{
+		FVRAllocationCounter::Install();
+	}
+
+	Results = MakeShared<FJsonObject>();
+	Results->SetStringField(TEXT("map"), MapName);
+	Results->SetNumberField(TEXT("framesPerScenario"), FramesPerScenario);
+	Results->SetObjectField(TEXT("scenarios"), MakeShared<FJsonObject>());
+}
+
+AVRCharacter *AVRBenchmarkGameMode::GetBenchmarkCharacter() const
+{
+	auto World = GetWorld();
+	auto PlayerController = (World != nullptr) ? World->GetFirstPlayerController() : nullptr;
+
+	return (PlayerController != nullptr) ? Cast<AVRCharacter>(PlayerController->GetPawn()) : nullptr;
+}
+
+void AVRBenchmarkGameMode::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	if (ScenarioIndex >= (int32)ARRAY_COUNT(Scenarios))
+	{
+		return;
+	}
+
+	auto Character = GetBenchmarkCharacter();
+	if (Character == nullptr)
+	{
+		// not spawned yet
+		return;
+	}
+
+	// make sure the pose we set this frame is the one the character works with
+	Character->AddTickPrerequisiteActor(this);
+
+	// we want to see what the stages cost, not how well the frame budget hides it
+	Character->SetFrameBudgetEnabled(false);
+
+	// measurement starts after the warm-up
+	if (ScenarioFrame == WarmupFrames)
+	{
+		Character->GetCharacterStats().Reset();
+		ScenarioStartAllocations = FVRAllocationCounter::GetNumAllocations();
+	}
+
+	if (ScenarioFrame == WarmupFrames + FramesPerScenario)
+	{
+		RecordScenario(*Character);
+
+		ScenarioIndex++;
+		ScenarioFrame = 0;
+
+		if (ScenarioIndex >= (int32)ARRAY_COUNT(Scenarios))
+		{
+			FTeleportArcTracerComparison ArcComparison;
+			auto NumArcMismatches = CheckArcTracer(*Character, ArcComparison);
+			Results->SetNumberField(TEXT("arcTracerMismatches"), NumArcMismatches);
+
+			// totals over all checked arcs, to see what the tracer saves over PredictProjectilePath
+			TSharedRef<FJsonObject> ArcCost = MakeShared<FJsonObject>();
+			ArcCost->SetNumberField(TEXT("tracerQueries"), ArcComparison.TracerQueries);
+			ArcCost->SetNumberField(TEXT("predictQueries"), ArcComparison.PredictQueries);
+			ArcCost->SetNumberField(TEXT("tracerMs"), ArcComparison.TracerMilliseconds);
+			ArcCost->SetNumberField(TEXT("predictMs"), ArcComparison.PredictMilliseconds);
+			Results->SetObjectField(TEXT("arcTracerCost"), ArcCost);
+			NumFailedChecks += (NumArcMismatches > 0) ? 1 : 0;
+
+			FinishBenchmark();
+			return;
+		}
+	}
+
+	DriveScenario(*Character);
+	ScenarioFrame++;
+}
+
+void AVRBenchmarkGameMode::DriveScenario(AVRCharacter &Character)
+{
+	auto RightController = Character.GetRightMotionController();
+	if (!ensure(RightController != nullptr))
+	{
+		return;
+	}
+
+	const auto &Scenario = Scenarios[ScenarioIndex];
+	float Alpha = (float)ScenarioFrame / FMath::Max(WarmupFrames + FramesPerScenario, 1);
+
+	// without a tracked device the motion controller keeps whatever relative transform we give it
+	RightController->SetRelativeLocationAndRotation(ControllerLocation, GetScenarioAim(Scenario.Kind, Alpha));
+
+	if ((Scenario.Kind == EVRBenchmarkScenario::TeleportSequence) && (TeleportIntervalFrames > 0) && (ScenarioFrame % TeleportIntervalFrames == TeleportIntervalFrames - 1))
+	{
+		Character.PressTeleport();
+	}
+}
+
+void AVRBenchmarkGameMode::RecordScenario(AVRCharacter &Character)
+{
+	const auto &Stats = Character.GetCharacterStats();
+
+	TSharedRef<FJsonObject> Stages = MakeShared<FJsonObject>();
+	for (int32 Stage = 0; Stage < (int32)EVRCharacterStage::Count; Stage++)
+	{
+		Stages->SetObjectField(FVRCharacterStats::GetStageName((EVRCharacterStage)Stage), MakeSummary(Stats.GetStageHistory((EVRCharacterStage)Stage)));
+	}
+
+	TSharedRef<FJsonObject> ScenarioResult = MakeShared<FJsonObject>();
+	ScenarioResult->SetObjectField(TEXT("stagesMs"), Stages);
+	ScenarioResult->SetObjectField(TEXT("physicsQueries"), MakeSummary(Stats.GetPhysicsQueryHistory()));
+	ScenarioResult->SetObjectField(TEXT("navQueries"), MakeSummary(Stats.GetNavQueryHistory()));
+
+	// allocations inside the character stages over all measured ticks
+	// the aiming scenarios must not allocate at all, the others may not allocate more than the baseline
+	if (FVRAllocationCounter::IsInstalled())
+	{
+		auto NumAllocations = FVRAllocationCounter::GetNumAllocations() - ScenarioStartAllocations;
+		ScenarioResult->SetNumberField(TEXT("heapAllocations"), NumAllocations);
+
+		UE_LOG(LogTemp, Display, TEXT("AVRBenchmarkGameMode::RecordScenario() %s allocated %llu times in %d character ticks"), Scenarios[ScenarioIndex].Name, NumAllocations, FramesPerScenario);
+
+		if (Scenarios[ScenarioIndex].bNoAllocations && (NumAllocations > 0))
+		{
+			UE_LOG(LogTemp, Error, TEXT("AVRBenchmarkGameMode::RecordScenario() %s must not allocate in a steady-state tick"), Scenarios[ScenarioIndex].Name);
+			NumFailedChecks++;
+		}
+	}
+
+	Results->GetObjectField(TEXT("scenarios"))->SetObjectField(Scenarios[ScenarioIndex].Name, ScenarioResult);
+
+	Character.DumpStats(*GLog);
+}
+
+int32 AVRBenchmarkGameMode::CheckArcTracer(AVRCharacter &Character, FTeleportArcTracerComparison &OutTotal)
+{
+	OutTotal = FTeleportArcTracerComparison();
+
+	auto RightController = Character.GetRightMotionController();
+	if (!ensure(RightController != nullptr))
+	{
+		return 1;
+	}
+
+	// from the hand, into whatever is around the last scenario's end point
+	auto Start = RightController->GetComponentLocation();
+
+	int32 NumArcs = 0;
+	int32 NumMismatches = 0;
+	for (auto Speed : ArcCheckSpeeds)
+	{
+		for (auto Pitch : ArcCheckPitches)
+		{
+			for (int32 Yaw = 0; Yaw < ArcCheckYaws; Yaw++)
+			{
+				auto LaunchVelocity = Speed * FRotator(Pitch, 360.0f * Yaw / ArcCheckYaws, 0.0f).Vector();
+				FTeleportArcTracerComparison Comparison;
+				NumMismatches += Character.bValidateTeleportArcTracer(Start, LaunchVelocity, ArcTracerTolerance, &Comparison) ? 0 : 1;
+				NumArcs++;
+
+				OutTotal.TracerQueries += Comparison.TracerQueries;
+				OutTotal.PredictQueries += Comparison.PredictQueries;
+				OutTotal.TracerMilliseconds += Comparison.TracerMilliseconds;
+				OutTotal.PredictMilliseconds += Comparison.PredictMilliseconds;
+			}
+		}
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("AVRBenchmarkGameMode::CheckArcTracer() %d arcs: arc tracer %d queries %.3f ms, PredictProjectilePath %d queries %.3f ms"),
+		NumArcs, OutTotal.TracerQueries, OutTotal.TracerMilliseconds, OutTotal.PredictQueries, OutTotal.PredictMilliseconds);
+
+	if (NumMismatches > 0)
+	{
+		UE_LOG(LogTemp, Error, TEXT("AVRBenchmarkGameMode::CheckArcTracer() arc tracer and PredictProjectilePath disagree on %d of %d arcs"), NumMismatches, NumArcs);
+	}
+	return NumMismatches;
+}
+
+void AVRBenchmarkGameMode::FinishBenchmark()
+{
+	FString Json;
+	auto Writer = TJsonWriterFactory<>::Create(&Json);
+	FJsonSerializer::Serialize(Results.ToSharedRef(), Writer);
+
+	if (FFileHelper::SaveStringToFile(Json, *OutputFilename))
+	{
+		UE_LOG(LogTemp, Display, TEXT("AVRBenchmarkGameMode::FinishBenchmark() results written to %s"), *OutputFilename);
+	}
+	else
+	{
+		UE_LOG(LogTemp, Error, TEXT("AVRBenchmarkGameMode::FinishBenchmark() unable to write %s"), *OutputFilename);
+	}
+
+	int32 NumRegressions = 0;
+
+	if (!BaselineFilename.IsEmpty())
+	{
+		FString BaselineJson;
+		TSharedPtr<FJsonObject> Baseline;
+
+		if (FFileHelper::LoadFileToString(BaselineJson, *BaselineFilename) &&
+			FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(BaselineJson), Baseline) && Baseline.IsValid())
+		{
+			NumRegressions = CompareWithBaseline(*Baseline);
+		}
+		else
+		{
+			UE_LOG(LogTemp, Error, TEXT("AVRBenchmarkGameMode::FinishBenchmark() unable to read baseline %s"), *BaselineFilename);
+			NumRegressions = 1;
+		}
+	}
+
+	if (NumRegressions > 0)
+	{
+		UE_LOG(LogTemp, Error, TEXT("AVRBenchmarkGameMode::FinishBenchmark() %d regression(s) against %s"), NumRegressions, *BaselineFilename);
+	}
+
+	if (NumFailedChecks > 0)
+	{
+		UE_LOG(LogTemp, Error, TEXT("AVRBenchmarkGameMode::FinishBenchmark() %d check(s) failed"), NumFailedChecks);
+	}
+
+	if ((NumRegressions > 0) || (NumFailedChecks > 0))
+	{
+		// a forced exit with the critical error flag set gives the build agent a non-zero exit code
+		GIsCriticalError = true;
+		FPlatformMisc::RequestExit(true);
+		return;
+	}
+
+	FPlatformMisc::RequestExit(false);
+}
+
+int32 AVRBenchmarkGameMode::CompareWithBaseline(const FJsonObject &Baseline) const
+{
+	int32 NumRegressions = 0;
+
+	// the baseline may come from an older build with fewer scenarios or stages; only compare what both have
+	auto Compare = [this, &NumRegressions](const FString &Label, const TSharedPtr<FJsonObject> &Current, const TSharedPtr<FJsonObject> &Base, float MinDifference)
+	{
+		double CurrentAverage, BaseAverage;
+		if (!Current.IsValid() || !Base.IsValid() || !Current->TryGetNumberField(TEXT("avg"), CurrentAverage) || !Base->TryGetNumberField(TEXT("avg"), BaseAverage))
+		{
+			return;
+		}
+
+		if ((CurrentAverage > BaseAverage * (1.0 + RegressionThreshold)) && (CurrentAverage - BaseAverage > MinDifference))
+		{
+			UE_LOG(LogTemp, Error, TEXT("AVRBenchmarkGameMode::CompareWithBaseline() %s regressed: %.4f, baseline %.4f"), *Label, CurrentAverage, BaseAverage);
+			NumRegressions++;
+		}
+	};
+
+	auto BaseScenarios = FindObjectField(Baseline, TEXT("scenarios"));
+	if (!BaseScenarios.IsValid())
+	{
+		return 0;
+	}
+
+	for (const auto &ScenarioEntry : Results->GetObjectField(TEXT("scenarios"))->Values)
+	{
+		auto BaseScenario = FindObjectField(*BaseScenarios, ScenarioEntry.Key);
+		auto CurrentScenario = ScenarioEntry.Value->AsObject();
+		if (!BaseScenario.IsValid() || !CurrentScenario.IsValid())
+		{
+			continue;
+		}
+
+		auto CurrentStages = FindObjectField(*CurrentScenario, TEXT("stagesMs"));
+		auto BaseStages = FindObjectField(*BaseScenario, TEXT("stagesMs"));
+		if (CurrentStages.IsValid() && BaseStages.IsValid())
+		{
+			for (const auto &StageEntry : CurrentStages->Values)
+			{
+				Compare(ScenarioEntry.Key + TEXT(".") + StageEntry.Key, StageEntry.Value->AsObject(), FindObjectField(*BaseStages, StageEntry.Key), MinRegressionMilliseconds);
+			}
+		}
+
+		// query counts are deterministic, any increase beyond the threshold is real
+		for (const TCHAR *Counter : { TEXT("physicsQueries"), TEXT("navQueries") })
+		{
+			Compare(ScenarioEntry.Key + TEXT(".") + Counter, FindObjectField(*CurrentScenario, Counter), FindObjectField(*BaseScenario, Counter), 0.0f);
+		}
+
+		// so are the allocations of a fixed-rate run, and none of them is noise
+		double CurrentAllocations, BaseAllocations;
+		if (CurrentScenario->TryGetNumberField(TEXT("heapAllocations"), CurrentAllocations) && BaseScenario->TryGetNumberField(TEXT("heapAllocations"), BaseAllocations) &&
+			(CurrentAllocations > BaseAllocations))
+		{
+			UE_LOG(LogTemp, Error, TEXT("AVRBenchmarkGameMode::CompareWithBaseline() %s.heapAllocations regressed: %.0f, baseline %.0f"), *ScenarioEntry.Key, CurrentAllocations, BaseAllocations);
+			NumRegressions++;
+		}
+	}
+
+	return NumRegressions;
+}
@@ -8,6 +8,21 @@
 #include "Components/StaticMeshComponent.h"
 #include "TimerManager.h"
 #include "GameFramework/PlayerController.h"
+#include "Camera/PlayerCameraManager.h"
+#include "Components/SplineMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "Materials/MaterialInterface.h"
+#include "UObject/ConstructorHelpers.h"
+#include "TeleportSearchComponent.h"
+#include "TeleportLateLatchComponent.h"
+#include "TeleportSearchBatch.h"
+#include "VRMathCoreConversions.h"
+
+namespace
+{
+	// number of meshes available to draw the teleport arc
+	const int32 TeleportArcPoolSize = 20;
+}
 
 // Sets default values
 AVRCharacter::AVRCharacter()
@@ -21,6 +36,9 @@ AVRCharacter::AVRCharacter()
 		DestinationMarker->SetupAttachment(GetRootComponent());
 	}
 
+	TeleportSearchComponent = CreateDefaultSubobject<UTeleportSearchComponent>(TEXT("TeleportSearchComponent"));
+	TeleportLateLatchComponent = CreateDefaultSubobject<UTeleportLateLatchComponent>(TEXT("TeleportLateLatchComponent"));
+
 	PostProcessComponent = CreateDefaultSubobject<UPostProcessComponent>(TEXT("PostProcessComponent"));
 	if (ensure(PostProcessComponent != nullptr))
 	{
@@ -54,6 +72,35 @@ AVRCharacter::AVRCharacter()
 			RightMotionControllerComponent->SetupAttachment(VRRoot);
 			RightMotionControllerComponent->SetTrackingSource(EControllerHand::Right);
 			//RightMotionControllerComponent->SetShowDeviceModel(true);
+
+			// the arc is drawn out of the box, the blueprint may still pick another mesh or material
+			static ConstructorHelpers::FObjectFinder<UStaticMesh> ArcMeshFinder(TEXT("/Engine/BasicShapes/Cylinder"));
+			if (ArcMeshFinder.Succeeded())
+			{
+				TeleportArcMesh = ArcMeshFinder.Object;
+			}
+
+			static ConstructorHelpers::FObjectFinder<UMaterialInterface> ArcMaterialFinder(TEXT("/Game/Materials/M_SplineArcMat"));
+			if (ArcMaterialFinder.Succeeded())
+			{
+				TeleportArcMaterial = ArcMaterialFinder.Object;
+			}
+
+			// all meshes of the teleport arc are created here once and reused every frame
+			TeleportArcMeshPool.Reserve(TeleportArcPoolSize);
+			for (int32 Index = 0; Index < TeleportArcPoolSize; Index++)
+			{
+				auto ArcMesh = CreateDefaultSubobject<USplineMeshComponent>(*FString::Printf(TEXT("TeleportArcMesh%d"), Index));
+				if (ensure(ArcMesh != nullptr))
+				{
+					ArcMesh->SetupAttachment(RightMotionControllerComponent);
+					ArcMesh->SetMobility(EComponentMobility::Movable);
+					ArcMesh->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+					ArcMesh->SetCastShadow(false);
+					ArcMesh->SetVisibility(false);
+					TeleportArcMeshPool.Add(ArcMesh);
+				}
+			}
 		}
 
 	}
@@ -71,6 +118,47 @@ void AVRCharacter::BeginPlay()
 
 	SetupBlinkerPostprocessingEffect();
 
+	SetupPlaySpaceReconciliation();
+
+	SetupTeleportScratch();
+
+	SetupTeleportSurfaceIndex();
+
+	SetupNavigationUpdates();
+
+	SetupSignificance();
+
+	SetupTeleportArc();
+
+	SetupPoseRecording();
+
+	SetTeleportSearchMode(TeleportSearchMode);
+
+}
+
+void AVRCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (TeleportSearchBatch != nullptr)
+	{
+		TeleportSearchBatch->UnregisterCharacter(this);
+		TeleportSearchBatch = nullptr;
+	}
+
+	StopPoseRecording();
+	ReleaseTeleportPrefetch();
+
+	// a trace in flight writes to our async search job
+	ResetAsyncTeleportSearch();
+
+	// the fade out holds the screen black until we fade in, which won't happen anymore
+	auto PlayerController = Cast<APlayerController>(GetController());
+	if (bIsTeleportInProgress() && (PlayerController != nullptr) && (PlayerController->PlayerCameraManager != nullptr))
+	{
+		PlayerController->PlayerCameraManager->StopCameraFade();
+	}
+	TeleportState = ETeleportState::None;
+
+	Super::EndPlay(EndPlayReason);
 }
 
 // Called every frame
@@ -78,16 +166,104 @@ void AVRCharacter::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
 
+	if (GetNetMode() != NM_Standalone)
+	{
+		CountPoseUpdates();
+
+		if (HasAuthority())
+		{
+			UpdatePoseNetUpdateFrequency();
+		}
+
+		// somebody else's character only shows the pose and teleports they send us
+		if (bUpdateRemoteState())
+		{
+			ApplyReplicatedPose(DeltaTime);
+			return;
+		}
+	}
+
+	CharacterStats.BeginFrame();
+
+	// decide what we can afford this frame
+	FrameBudget.BeginFrame(FrameBudgetSettings, CharacterStats);
+
+	// poses of this frame come from the recording, or go into it
+	if (PoseReplay.IsPlaying())
+	{
+		ApplyPoseReplayFrame();
+	}
+	else if (PoseRecorder.IsRecording())
+	{
+		RecordPoseFrame(DeltaTime);
+	}
+
+	// a teleport in progress moves on no matter how busy the frame is
+	UpdateTeleport();
+
 	// adjust our position based on how much we walked in our space
-	MovePawnToVRCamera();
+	if (FrameBudget.bShouldRun(EVRCharacterStage::MovePawnToVRCamera))
+	{
+		VRCHARACTER_SCOPED_STAGE(CharacterStats, MovePawnToVRCamera);
+		MovePawnToVRCamera();
+	}
 
 	// update teleportation marker
-	MoveDestinationMarkerByLineTrace();
+	// usually the teleport search component (or batch) does this later in the frame
+	bTeleportSearchThisFrame = FrameBudget.bShouldRun(EVRCharacterStage::MoveDestinationMarkerByLineTrace);
+
+	auto bSearchInBatch = (TeleportSearchMode == ETeleportSearchMode::Batch) && (TeleportSearchBatch != nullptr);
+	auto bSearchLater = bSearchInBatch || bUsesTeleportSearchComponent();
+	if (bSearchLater)
+	{
+		bTeleportInProgressThisFrame = bIsTeleportInProgress();
+		if (bSearchInBatch)
+		{
+			TeleportSearchBatchFrame = GFrameCounter;
+		}
+
+		// a worker thread only traces, the rest of the search job is set up here on the game thread
+		if (bSearchInBatch || TeleportSearchComponent->IsSearchingOnWorkerThread())
+		{
+			PrepareTeleportSearchJob();
+		}
+	}
+	else if (bTeleportSearchThisFrame)
+	{
+		VRCHARACTER_SCOPED_STAGE(CharacterStats, MoveDestinationMarkerByLineTrace);
+		MoveDestinationMarkerByLineTrace();
+	}
+	else
+	{
+		SkipTeleportSearch();
+	}
 
 	// as we move faster, make the radius of blinker smaller to reduce motionsickness
-	UpdateBlinkerRadius();
+	if (FrameBudget.bShouldRun(EVRCharacterStage::UpdateBlinkerRadius))
+	{
+		VRCHARACTER_SCOPED_STAGE(CharacterStats, UpdateBlinkerRadius);
+		UpdateBlinkerRadius();
+	}
 	// center the blinker in direction of motion to reduce motionsickness
-	UpdateBlinkerCenter();
+	if (FrameBudget.bShouldRun(EVRCharacterStage::UpdateBlinkerCenter))
+	{
+		VRCHARACTER_SCOPED_STAGE(CharacterStats, UpdateBlinkerCenter);
+		UpdateBlinkerCenter();
+	}
+
+	UpdateSignificanceViewpoint();
+
+	// the others see our head and hands, and the marker as it was last frame if the search runs later
+	if (GetNetMode() != NM_Standalone)
+	{
+		SendPose();
+	}
+
+	// otherwise the teleport search component (or batch) ends the frame once the marker is placed
+	if (!bSearchLater)
+	{
+		CharacterStats.EndFrame();
+	}
 
 }
 
@@ -101,8 +277,34 @@ void AVRCharacter::SetupPlayerInputComponent(UInputComponent* PlayerInputCompone
 	PlayerInputComponent->BindAction(TEXT("Teleport"), EInputEvent::IE_Pressed, this, &AVRCharacter::OnTeleport);
 }
 
+void AVRCharacter::DumpStats(FOutputDevice &Ar) const
+{
+	CharacterStats.Dump(Ar, FString::Printf(TEXT("%s over the last frames:"), *GetName()));
+
+	Ar.Logf(TEXT("  degradation level %s, stage cost when run:"), FVRFrameBudget::GetLevelName(FrameBudget.GetLevel()));
+	for (int32 Stage = 0; Stage < (int32)EVRCharacterStage::Count; Stage++)
+	{
+		Ar.Logf(TEXT("    %-32s %8.3f ms"), FVRCharacterStats::GetStageName((EVRCharacterStage)Stage), FrameBudget.GetStageCost((EVRCharacterStage)Stage));
+	}
+
+	float Min = 0.0f, Average = 0.0f, P99 = 0.0f;
+	if (TeleportBlackTimeHistory.bGetSummary(Min, Average, P99))
+	{
+		Ar.Logf(TEXT("  teleport black screen min %8.3f  avg %8.3f  p99 %8.3f ms, %d timeouts"), Min, Average, P99, TeleportBlackTimeouts);
+	}
+
+	if (TeleportFanMilliseconds.bGetSummary(Min, Average, P99))
+	{
+		Ar.Logf(TEXT("  teleport fan min %8.3f  avg %8.3f  p99 %8.3f ms (budget %.3f ms), %d searches, %d hits, %d over budget"),
+			Min, Average, P99, TeleportFanBudget, TeleportFanSearches, TeleportFanHits, TeleportFanOverBudget);
+	}
+}
+
 void AVRCharacter::OnMoveForward(float throttle)
 {
+	PendingPoseFrameInput.ForwardAxis = throttle;
+	if (bIgnoreLiveInput()) { return; }
+
 	if (!ensure(Camera != nullptr)) { return; }
 
 	//UE_LOG(LogTemp, Warning, TEXT("AVRCharacter::OnMoveForward() called"));
@@ -113,6 +315,9 @@ void AVRCharacter::OnMoveForward(float throttle)
 
 void AVRCharacter::OnMoveRight(float throttle)
 {
+	PendingPoseFrameInput.RightAxis = throttle;
+	if (bIgnoreLiveInput()) { return; }
+
 	if (!ensure(Camera != nullptr)) { return; }
 
 	//UE_LOG(LogTemp, Warning, TEXT("AVRCharacter::OnMoveRight() called"));
@@ -124,6 +329,11 @@ void AVRCharacter::OnMoveRight(float throttle)
 // Teleport button was pressed
 void AVRCharacter::OnTeleport()
 {
+	PendingPoseFrameInput.bTeleportPressed = true;
+	if (bIgnoreLiveInput())
+	{
+		return;
+	}
 
 	if (!ensure(DestinationMarker != nullptr))
 	{
@@ -137,7 +347,7 @@ void AVRCharacter::OnTeleport()
 	}
 
 	// also ignore teleport request if the last teleport is still in progress
-	if (GetWorldTimerManager().IsTimerActive(TeleportFadeTimerHandle))
+	if (bIsTeleportInProgress())
 	{
 		return;
 	}
@@ -166,16 +376,82 @@ void AVRCharacter::MovePawnToVRCamera()
 		return;
 	}
 
-	auto CameraLocation = Camera->GetComponentLocation();
+	// how far camera has moved away from actor this frame, horizontally
+	auto Delta = VRMathCore::FromCore(VRMathCore::GetPlaySpaceDelta(VRMathCore::ToCore(Camera->GetComponentLocation()), VRMathCore::ToCore(GetActorLocation())));
 
-	// how far camera has moved away from actor this frame
-	auto Delta = CameraLocation - GetActorLocation();
-	// clear the vertical direction
-	Delta.Z = 0.f;
+	if (!bBatchPlaySpaceReconciliation)
+	{
+		// move ourselves to camera's location
+		AddActorWorldOffset(Delta);
 
-	// move ourselves to camera's location
-	AddActorWorldOffset(Delta);
+		// move VRRoot in opposite direction to keep the camera stationary
+		VRRoot->AddWorldOffset(-Delta);
+		return;
+	}
+
+	// the delta is measured from the actor every frame, so whatever we skip now is still there next frame
+	if (VRMathCore::bIsInDeadZone(VRMathCore::ToCore(Delta), PlaySpaceDeadZone))
+	{
+		CountPlaySpaceUpdatesSaved(NumCapsuleComponents + NumVRRootComponents);
+		return;
+	}
+
+	auto Parent = VRRoot->GetAttachParent();
+	if (!ensure(Parent != nullptr))
+	{
+		return;
+	}
 
 	// move VRRoot in opposite direction to keep the camera stationary
-	VRRoot->AddWorldOffset(-Delta);
+	// only its relative location changes here, the capsule move below brings its world transform along;
+	// a translation does not change how the capsule rotates and scales, so its transform is good for this already
+	VRRoot->RelativeLocation += Parent->GetComponentTransform().InverseTransformVector(-Delta);
+
+	// move ourselves to camera's location, which updates the children of the capsule once
+	// (no FScopedMovementUpdate for this, its scope stack allocates again whenever it grows back after a pop)
+	AddActorWorldOffset(Delta);
+
+	CountPlaySpaceUpdatesSaved(NumVRRootComponents);
+}
+
+void AVRCharacter::SetupPlaySpaceReconciliation()
+{
+	TArray<USceneComponent *> Children;
+
+	NumCapsuleComponents = 0;
+	if (GetRootComponent() != nullptr)
+	{
+		GetRootComponent()->GetChildrenComponents(true, Children);
+		NumCapsuleComponents = 1 + Children.Num();
+	}
+
+	NumVRRootComponents = 0;
+	if (VRRoot != nullptr)
+	{
+		VRRoot->GetChildrenComponents(true, Children);
+		NumVRRootComponents = 1 + Children.Num();
+	}
+
+	// the marker is placed in world space by every teleport search, it doesn't need to follow the capsule in between
+	if (bBatchPlaySpaceReconciliation && (DestinationMarker != nullptr))
+	{
+		DestinationMarker->SetAbsolute(true, false, false);
+	}
+}
+
+void AVRCharacter::CountPlaySpaceUpdatesSaved(int32 NumSaved)
+{
+	INC_DWORD_STAT_BY(STAT_VRCharacter_TransformUpdatesSaved, NumSaved);
+
+	PlaySpaceUpdatesSaved += NumSaved;
+
+	auto Now = GetWorld()->GetTimeSeconds();
+	if (Now - PlaySpaceUpdatesSavedTime >= 1.0f)
+	{
+		PlaySpaceUpdatesSavedPerSecond = FMath::RoundToInt(PlaySpaceUpdatesSaved / (Now - PlaySpaceUpdatesSavedTime));
+		CSV_CUSTOM_STAT(VRCharacter, TransformUpdatesSavedPerSecond, PlaySpaceUpdatesSavedPerSecond, ECsvCustomStatOp::Set);
+
+		PlaySpaceUpdatesSaved = 0;
+		PlaySpaceUpdatesSavedTime = Now;
+	}
 }
@@ -0,0 +1,338 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "VRCharacterStats.h"
+#include "VRCharacter.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/OutputDevice.h"
+#include "EngineUtils.h"
+
+DEFINE_STAT(STAT_VRCharacter_MovePawnToVRCamera);
+DEFINE_STAT(STAT_VRCharacter_MoveDestinationMarkerByLineTrace);
+DEFINE_STAT(STAT_VRCharacter_UpdateBlinkerRadius);
+DEFINE_STAT(STAT_VRCharacter_UpdateBlinkerCenter);
+DEFINE_STAT(STAT_VRCharacter_TeleportFan);
+DEFINE_STAT(STAT_VRCharacter_PhysicsQueries);
+DEFINE_STAT(STAT_VRCharacter_NavQueries);
+DEFINE_STAT(STAT_VRCharacter_TransformUpdatesSaved);
+DEFINE_STAT(STAT_VRCharacter_BlinkerParameterPushes);
+DEFINE_STAT(STAT_VRCharacter_DegradationLevel);
+DEFINE_STAT(STAT_VRCharacter_SkippedStages);
+DEFINE_STAT(STAT_VRCharacter_PrefetchLevels);
+DEFINE_STAT(STAT_VRCharacter_PrefetchLevelsReady);
+DEFINE_STAT(STAT_VRCharacter_PrefetchCompletion);
+DEFINE_STAT(STAT_VRCharacter_PrefetchTexturesPending);
+DEFINE_STAT(STAT_VRCharacter_TeleportBlackTime);
+DEFINE_STAT(STAT_VRCharacter_NavDirtyTiles);
+DEFINE_STAT(STAT_VRCharacter_NavTileTasks);
+DEFINE_STAT(STAT_VRCharacter_NavRebuildTime);
+DEFINE_STAT(STAT_VRCharacter_PoseBytesSent);
+DEFINE_STAT(STAT_VRCharacter_LateLatchCorrection);
+DEFINE_STAT(STAT_VRCharacter_Significance);
+DEFINE_STAT(STAT_VRCharacter_SignificanceReduced);
+DEFINE_STAT(STAT_VRCharacter_SignificanceMinimal);
+DEFINE_STAT(STAT_VRCharacter_SignificanceSkippedTicks);
+DEFINE_STAT(STAT_VRCharacter_SignificanceSaved);
+
+CSV_DEFINE_CATEGORY_MODULE(ARCHITECTUREEXPLORER_API, VRCharacter, true);
+
+namespace
+{
+	// about 6.5 seconds at 90 Hz
+	const int32 HistorySize = 600;
+
+	const TCHAR *StageNames[] =
+	{
+		TEXT("MovePawnToVRCamera"),
+		TEXT("MoveDestinationMarkerByLineTrace"),
+		TEXT("UpdateBlinkerRadius"),
+		TEXT("UpdateBlinkerCenter"),
+	};
+	static_assert(ARRAY_COUNT(StageNames) == (int32)EVRCharacterStage::Count, "every stage needs a name");
+
+	void DumpHistory(FOutputDevice &Ar, const TCHAR *Name, const FVRStatHistory &History, const TCHAR *Unit)
+	{
+		float Min, Average, P99;
+		if (History.bGetSummary(Min, Average, P99))
+		{
+			Ar.Logf(TEXT("  %-34s min %8.3f  avg %8.3f  p99 %8.3f %s"), Name, Min, Average, P99, Unit);
+		}
+		else
+		{
+			Ar.Logf(TEXT("  %-34s no samples"), Name);
+		}
+	}
+
+	FAutoConsoleCommandWithWorld DumpCharacterStatsCommand(
+		TEXT("vr.DumpCharacterStats"),
+		TEXT("Log min/avg/p99 of every VR character tick stage and query count over the last frames"),
+		FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld *World)
+		{
+			if (World == nullptr)
+			{
+				return;
+			}
+
+			for (TActorIterator<AVRCharacter> It(World); It; ++It)
+			{
+				It->DumpStats(*GLog);
+			}
+		}));
+}
+
+FVRStatHistory::FVRStatHistory()
+{
+	Samples.SetNumZeroed(HistorySize);
+}
+
+void FVRStatHistory::Add(float Value)
+{
+	Samples[NextSample] = Value;
+	NextSample = (NextSample + 1) % Samples.Num();
+	NumSamples = FMath::Min(NumSamples + 1, Samples.Num());
+}
+
+void FVRStatHistory::Reset()
+{
+	NextSample = 0;
+	NumSamples = 0;
+}
+
+bool FVRStatHistory::bGetSummary(float &OutMin, float &OutAverage, float &OutP99) const
+{
+	if (NumSamples == 0)
+	{
+		return false;
+	}
+
+	// only the filled part of the ring buffer counts; order does not matter once sorted
+	TArray<float> Sorted(Samples.GetData(), NumSamples);
+	Sorted.Sort();
+
+	float Sum = 0.0f;
+	for (float Sample : Sorted)
+	{
+		Sum += Sample;
+	}
+
+	OutMin = Sorted[0];
+	OutAverage = Sum / NumSamples;
+	OutP99 = Sorted[FMath::Min(FMath::FloorToInt(0.99f * NumSamples), NumSamples - 1)];
+
+	return true;
+}
+
+FVRAllocationCounter *FVRAllocationCounter::Instance = nullptr;
+int32 FVRAllocationCounter::StageDepth = 0;
+
+void FVRAllocationCounter::Install()
+{
+	if ((Instance != nullptr) || !ensure(GMalloc != nullptr))
+	{
+		return;
+	}
+
+	// never deleted, blocks allocated through us are freed through us until exit
+	Instance = new FVRAllocationCounter(GMalloc);
+	GMalloc = Instance;
+}
+
+uint64 FVRAllocationCounter::GetNumAllocations()
+{
+	return (Instance != nullptr) ? Instance->NumAllocations : 0;
+}
+
+void FVRAllocationCounter::CountAllocation()
+{
+	// the depth is only kept on the game thread, other threads are not ours to count
+	if ((StageDepth > 0) && IsInGameThread())
+	{
+		NumAllocations++;
+	}
+}
+
+void *FVRAllocationCounter::Malloc(SIZE_T Count, uint32 Alignment)
+{
+	CountAllocation();
+	return InnerMalloc->Malloc(Count, Alignment);
+}
+
+void *FVRAllocationCounter::Realloc(void *Original, SIZE_T Count, uint32 Alignment)
+{
+	// shrinking to nothing is a free
+	if (Count > 0)
+	{
+		CountAllocation();
+	}
+	return InnerMalloc->Realloc(Original, Count, Alignment);
+}
+
+void FVRAllocationCounter::Free(void *Original)
+{
+	InnerMalloc->Free(Original);
+}
+
+SIZE_T FVRAllocationCounter::QuantizeSize(SIZE_T Count, uint32 Alignment)
+{
+	return InnerMalloc->QuantizeSize(Count, Alignment);
+}
+
+bool FVRAllocationCounter::GetAllocationSize(void *Original, SIZE_T &SizeOut)
+{
+	return InnerMalloc->GetAllocationSize(Original, SizeOut);
+}
+
+void FVRAllocationCounter::Trim()
+{
+	InnerMalloc->Trim();
+}
+
+void FVRAllocationCounter::SetupTLSCachesOnCurrentThread()
+{
+	InnerMalloc->SetupTLSCachesOnCurrentThread();
+}
+
+void FVRAllocationCounter::ClearAndDisableTLSCachesOnCurrentThread()
+{
+	InnerMalloc->ClearAndDisableTLSCachesOnCurrentThread();
+}
+
+void FVRAllocationCounter::InitializeStatsMetadata()
+{
+	InnerMalloc->InitializeStatsMetadata();
+}
+
+void FVRAllocationCounter::UpdateStats()
+{
+	InnerMalloc->UpdateStats();
+}
+
+void FVRAllocationCounter::GetAllocatorStats(FGenericMemoryStats &OutStats)
+{
+	InnerMalloc->GetAllocatorStats(OutStats);
+}
+
+void FVRAllocationCounter::DumpAllocatorStats(FOutputDevice &Ar)
+{
+	InnerMalloc->DumpAllocatorStats(Ar);
+}
+
+bool FVRAllocationCounter::IsInternallyThreadSafe() const
+{
+	return InnerMalloc->IsInternallyThreadSafe();
+}
+
+bool FVRAllocationCounter::ValidateHeap()
+{
+	return InnerMalloc->ValidateHeap();
+}
+
+const TCHAR *FVRAllocationCounter::GetDescriptiveName()
+{
+	return InnerMalloc->GetDescriptiveName();
+}
+
+FVRCharacterStats::FScopedStage::FScopedStage(FVRCharacterStats &InStats, EVRCharacterStage InStage)
+	: Stats(InStats)
+	, Stage(InStage)
+	, StartCycles(FPlatformTime::Cycles64())
+{
+	// stages run on worker threads in some teleport search modes, their allocations are not counted
+	if (IsInGameThread())
+	{
+		FVRAllocationCounter::EnterStage();
+	}
+}
+
+FVRCharacterStats::FScopedStage::~FScopedStage()
+{
+	double Milliseconds = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+	Stats.FrameStageMilliseconds[(int32)Stage] += (float)Milliseconds;
+
+	if (IsInGameThread())
+	{
+		FVRAllocationCounter::LeaveStage();
+	}
+}
+
+void FVRCharacterStats::BeginFrame()
+{
+	if (bFrameOpen)
+	{
+		EndFrame();
+	}
+
+	for (auto &Milliseconds : FrameStageMilliseconds)
+	{
+		Milliseconds = 0.0f;
+	}
+	FramePhysicsQueries = 0;
+	FrameNavQueries = 0;
+
+	bFrameOpen = true;
+}
+
+void FVRCharacterStats::EndFrame()
+{
+	if (!bFrameOpen)
+	{
+		return;
+	}
+	bFrameOpen = false;
+
+	for (int32 Stage = 0; Stage < (int32)EVRCharacterStage::Count; Stage++)
+	{
+		StageMilliseconds[Stage].Add(FrameStageMilliseconds[Stage]);
+		LastFrameStageMilliseconds[Stage] = FrameStageMilliseconds[Stage];
+	}
+	PhysicsQueries.Add(FramePhysicsQueries);
+	NavQueries.Add(FrameNavQueries);
+
+	CSV_CUSTOM_STAT(VRCharacter, PhysicsQueries, FramePhysicsQueries, ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(VRCharacter, NavQueries, FrameNavQueries, ECsvCustomStatOp::Set);
+}
+
+void FVRCharacterStats::AddPhysicsQueries(int32 NumQueries)
+{
+	FramePhysicsQueries += NumQueries;
+	INC_DWORD_STAT_BY(STAT_VRCharacter_PhysicsQueries, NumQueries);
+}
+
+void FVRCharacterStats::AddNavQueries(int32 NumQueries)
+{
+	FrameNavQueries += NumQueries;
+	INC_DWORD_STAT_BY(STAT_VRCharacter_NavQueries, NumQueries);
+}
+
+void FVRCharacterStats::AddStageMilliseconds(EVRCharacterStage Stage, float Milliseconds)
+{
+	FrameStageMilliseconds[(int32)Stage] += Milliseconds;
+}
+
+void FVRCharacterStats::Dump(FOutputDevice &Ar, const FString &Title) const
+{
+	Ar.Logf(TEXT("%s"), *Title);
+
+	for (int32 Stage = 0; Stage < (int32)EVRCharacterStage::Count; Stage++)
+	{
+		DumpHistory(Ar, GetStageName((EVRCharacterStage)Stage), StageMilliseconds[Stage], TEXT("ms"));
+	}
+
+	DumpHistory(Ar, TEXT("PhysicsQueries"), PhysicsQueries, TEXT("per frame"));
+	DumpHistory(Ar, TEXT("NavQueries"), NavQueries, TEXT("per frame"));
+}
+
+void FVRCharacterStats::Reset()
+{
+	for (auto &History : StageMilliseconds)
+	{
+		History.Reset();
+	}
+	PhysicsQueries.Reset();
+	NavQueries.Reset();
+}
+
+const TCHAR *FVRCharacterStats::GetStageName(EVRCharacterStage Stage)
+{
+	return StageNames[FMath::Clamp((int32)Stage, 0, (int32)EVRCharacterStage::Count - 1)];
+}
@@ -4,9 +4,18 @@
 #include "GameFramework/PlayerController.h"
 #include "Materials/MaterialInstanceDynamic.h"
 #include "Curves/CurveFloat.h"
+#include "Materials/MaterialParameterCollection.h"
+#include "Materials/MaterialParameterCollectionInstance.h"
+#include "Engine/World.h"
+#include "VRMathCoreConversions.h"
 
 void AVRCharacter::SetupBlinkerPostprocessingEffect()
 {
+	SetupBlinkerRadiusTable();
+
+	bBlinkerRadiusPushed = false;
+	bBlinkerCenterPushed = false;
+
 	if (!ensure(PostProcessComponent != nullptr))
 	{
 		return;
@@ -27,94 +36,160 @@ void AVRCharacter::SetupBlinkerPostprocessingEffect()
 	PostProcessComponent->AddOrUpdateBlendable(BlinkerMaterialInstance);
 }
 
-void AVRCharacter::UpdateBlinkerRadius()
+void AVRCharacter::SetupBlinkerRadiusTable()
 {
+	bBlinkerRadiusTableValid = false;
+
 	if (RadiusVsVelocity == nullptr)
 	{
 		return;
 	}
 
-	if (BlinkerMaterialInstance == nullptr)
-	{
-		return;
-	}
+	// outside its keys the curve stays at the first and last value, so does the table
+	float MinSpeed = 0.0f, MaxSpeed = 0.0f;
+	RadiusVsVelocity->GetTimeRange(MinSpeed, MaxSpeed);
 
-	float BlinkerRadius = 0.0f;
-	float MySpeed = GetVelocity().Size();
+	BlinkerRadiusTableMinSpeed = MinSpeed;
+	BlinkerRadiusTableSpeedStep = (MaxSpeed - MinSpeed) / (BlinkerRadiusTableSize - 1);
 
-	BlinkerRadius = RadiusVsVelocity->GetFloatValue(MySpeed);
+	for (int32 Index = 0; Index < BlinkerRadiusTableSize; Index++)
+	{
+		BlinkerRadiusTable[Index] = RadiusVsVelocity->GetFloatValue(MinSpeed + Index * BlinkerRadiusTableSpeedStep);
+	}
 
-	//UE_LOG(LogTemp, Warning, TEXT("AVRCharacter::UpdateBlinkerRadius() setting Radius to %1.4f"), BlinkerRadius);
-	BlinkerMaterialInstance->SetScalarParameterValue(FName(TEXT("Radius")), BlinkerRadius);
+	bBlinkerRadiusTableValid = true;
 }
 
-void AVRCharacter::UpdateBlinkerCenter()
+float AVRCharacter::LookupBlinkerRadius(float Speed) const
 {
-	if (BlinkerMaterialInstance == nullptr)
+	// a curve with a single key
+	if (BlinkerRadiusTableSpeedStep <= 0.0f)
 	{
-		return;
+		return BlinkerRadiusTable[0];
 	}
 
-	FVector2D Center = CalculateBlinkerCenter();
+	auto Position = FMath::Clamp((Speed - BlinkerRadiusTableMinSpeed) / BlinkerRadiusTableSpeedStep, 0.0f, (float)(BlinkerRadiusTableSize - 1));
+	auto Index = FMath::Min(FMath::FloorToInt(Position), BlinkerRadiusTableSize - 2);
 
-	BlinkerMaterialInstance->SetVectorParameterValue(FName(TEXT("Center")), FLinearColor(Center.X, Center.Y, 0.0f, 0.0f));
+	return FMath::Lerp(BlinkerRadiusTable[Index], BlinkerRadiusTable[Index + 1], Position - Index);
 }
 
-FVector2D AVRCharacter::CalculateBlinkerCenter() const
+void AVRCharacter::UpdateBlinkerRadius()
 {
-	const FVector2D CenterDefault = FVector2D(0.5f, 0.5f);
+	if (!bBlinkerRadiusTableValid)
+	{
+		return;
+	}
 
-	if (!ensure(Camera != nullptr))
+	if ((BlinkerMaterialInstance == nullptr) && (BlinkerParameterCollection == nullptr))
 	{
-		return CenterDefault;
+		return;
 	}
 
-	auto PlayerController = Cast<APlayerController>(GetController());
-	if (PlayerController == nullptr)
+	float BlinkerRadius = 0.0f;
+	float MySpeed = GetVelocity().Size();
+
+	BlinkerRadius = LookupBlinkerRadius(MySpeed);
+
+	// standing still or walking at constant speed, nothing to tell the material
+	if (bBlinkerRadiusPushed && FMath::IsNearlyEqual(BlinkerRadius, PushedBlinkerRadius, BlinkerRadiusTolerance))
 	{
-		return CenterDefault;
+		return;
 	}
 
-	auto MyNormalizedVelocity = GetVelocity().GetSafeNormal();
-	if (MyNormalizedVelocity.IsNearlyZero())
+	if (BlinkerParameterCollection != nullptr)
 	{
-		// the Size of GetSafeNormal() will be 1.0, except when the velocity
-		// vector is near zero in which case it returns 0.0
-		//
-		// if we have a near-zero velocity, let's center our blinker
+		if (!IsLocallyControlled())
+		{
+			return;
+		}
+
+		auto CollectionInstance = GetWorld()->GetParameterCollectionInstance(BlinkerParameterCollection);
+		if (!ensure(CollectionInstance != nullptr))
+		{
+			return;
+		}
+		CollectionInstance->SetScalarParameterValue(BlinkerRadiusParameterName, BlinkerRadius);
+	}
+	else
+	{
+		//UE_LOG(LogTemp, Warning, TEXT("AVRCharacter::UpdateBlinkerRadius() setting Radius to %1.4f"), BlinkerRadius);
+		BlinkerMaterialInstance->SetScalarParameterValue(BlinkerRadiusParameterName, BlinkerRadius);
+	}
 
-		return CenterDefault;
+	INC_DWORD_STAT(STAT_VRCharacter_BlinkerParameterPushes);
+	PushedBlinkerRadius = BlinkerRadius;
+	bBlinkerRadiusPushed = true;
+}
+
+void AVRCharacter::UpdateBlinkerCenter()
+{
+	if ((BlinkerMaterialInstance == nullptr) && (BlinkerParameterCollection == nullptr))
+	{
+		return;
 	}
 
-	auto CameraLocation = Camera->GetComponentLocation();
+	ViewCache.Update(Cast<APlayerController>(GetController()));
+
+	// without a headset, or with a material that has one center for both eyes, we push the mono view
+	auto bPerEye = bPerEyeBlinkerCenter && ViewCache.IsStereo();
+	auto LeftCenter = CalculateBlinkerCenter(bPerEye ? EVRView::LeftEye : EVRView::Mono);
+	auto RightCenter = bPerEye ? CalculateBlinkerCenter(EVRView::RightEye) : LeftCenter;
+	FLinearColor Center(LeftCenter.X, LeftCenter.Y, RightCenter.X, RightCenter.Y);
 
-	FVector PointInOurDirectionOfMovement;
-	if (FVector::DotProduct(Camera->GetForwardVector(), MyNormalizedVelocity) > 0) // test is going backwards
+	if (bBlinkerCenterPushed && Center.Equals(PushedBlinkerCenter, BlinkerCenterTolerance))
 	{
-		// we go some arbitrary 1000cm in front of the camera location
-		PointInOurDirectionOfMovement = CameraLocation + 1000.0f*MyNormalizedVelocity;
+		return;
+	}
+
+	if (BlinkerParameterCollection != nullptr)
+	{
+		if (!IsLocallyControlled())
+		{
+			return;
+		}
+
+		auto CollectionInstance = GetWorld()->GetParameterCollectionInstance(BlinkerParameterCollection);
+		if (!ensure(CollectionInstance != nullptr))
+		{
+			return;
+		}
+		CollectionInstance->SetVectorParameterValue(BlinkerCenterParameterName, Center);
 	}
 	else
 	{
-		// we go some arbitrary 1000cm behind the camera location (since we are moving backwards)
-		PointInOurDirectionOfMovement = CameraLocation - 1000.0f*MyNormalizedVelocity;
+		BlinkerMaterialInstance->SetVectorParameterValue(BlinkerCenterParameterName, Center);
 	}
 
-	FVector2D OutScreenLocation;
-	bool bFoundScreenLocation;
-	// project the PointInOurDirectionOfMovement back onto our screen to get a 2d screen location
-	bFoundScreenLocation = PlayerController->ProjectWorldLocationToScreen(PointInOurDirectionOfMovement, OutScreenLocation);
-	if (!bFoundScreenLocation)
+	INC_DWORD_STAT(STAT_VRCharacter_BlinkerParameterPushes);
+	PushedBlinkerCenter = Center;
+	bBlinkerCenterPushed = true;
+}
+
+FVector2D AVRCharacter::CalculateBlinkerCenter(EVRView View) const
+{
+	const FVector2D CenterDefault = FVector2D(0.5f, 0.5f);
+
+	if (!ensure(Camera != nullptr))
 	{
-		// this happens if projection is outside the screen
-		// we are fine if this happens because the center will just be offscreen, which is fine
+		return CenterDefault;
+	}
 
-		// so no special handling code here
+	// no local player or viewport
+	if (!ViewCache.IsValid(View))
+	{
+		return CenterDefault;
 	}
 
-	int32 SizeX, SizeY;
-	PlayerController->GetViewportSize(SizeX, SizeY);
-	auto NewCenter = OutScreenLocation / FVector2D(SizeX, SizeY); // component-wise division; turns coordinate into range 0.0 to 1.0
+	// a point 1000cm along our direction of movement (behind us if we go backwards), projected back onto our screen
+	// fails if we barely move, or if the point is behind the view, which the direction test mostly prevents;
+	// a point outside the screen is fine, the center will just be offscreen
+	VRMathCore::FVec2 NewCenter;
+	if (!VRMathCore::bGetBlinkerCenter(VRMathCore::ToCore(ViewCache.GetViewProjectionMatrix(View)), VRMathCore::ToCore(Camera->GetComponentLocation()),
+		VRMathCore::ToCore(Camera->GetForwardVector()), VRMathCore::ToCore(GetVelocity()), NewCenter))
+	{
+		return CenterDefault;
+	}
 
-	return NewCenter;
+	return VRMathCore::FromCore(NewCenter);
 }
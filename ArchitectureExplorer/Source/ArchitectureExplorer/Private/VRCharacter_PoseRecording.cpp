@@ -0,0 +1,184 @@
+#include "VRCharacter.h"
+#include "Camera/CameraComponent.h"
+#include "MotionControllerComponent.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/CommandLine.h"
+#include "Misc/DateTime.h"
+#include "Misc/Paths.h"
+
+namespace
+{
+	// recordings without an explicit filename go to Saved/PoseRecordings
+	FString GetDefaultPoseRecordingFilename(const AVRCharacter &Character)
+	{
+		return FPaths::ProjectSavedDir() / TEXT("PoseRecordings") / FString::Printf(TEXT("%s_%s.vrposes"), *Character.GetName(), *FDateTime::Now().ToString());
+	}
+
+	FAutoConsoleCommandWithWorldAndArgs RecordPosesCommand(
+		TEXT("vr.RecordPoses"),
+		TEXT("Record the head and controller poses and input of every VR character. Usage: vr.RecordPoses [file]"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString> &Args, UWorld *World)
+		{
+			if (World == nullptr)
+			{
+				return;
+			}
+
+			for (TActorIterator<AVRCharacter> It(World); It; ++It)
+			{
+				It->StartPoseRecording((Args.Num() > 0) ? Args[0] : GetDefaultPoseRecordingFilename(**It));
+			}
+		}));
+
+	FAutoConsoleCommandWithWorldAndArgs ReplayPosesCommand(
+		TEXT("vr.ReplayPoses"),
+		TEXT("Replay a pose recording on every VR character. Usage: vr.ReplayPoses <file> [loop]"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString> &Args, UWorld *World)
+		{
+			if ((World == nullptr) || (Args.Num() == 0))
+			{
+				return;
+			}
+
+			bool bLoop = (Args.Num() > 1) && (Args[1] == TEXT("loop"));
+			for (TActorIterator<AVRCharacter> It(World); It; ++It)
+			{
+				It->StartPoseReplay(Args[0], bLoop);
+			}
+		}));
+
+	FAutoConsoleCommandWithWorld StopPosesCommand(
+		TEXT("vr.StopPoses"),
+		TEXT("Stop recording or replaying poses on every VR character"),
+		FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld *World)
+		{
+			if (World == nullptr)
+			{
+				return;
+			}
+
+			for (TActorIterator<AVRCharacter> It(World); It; ++It)
+			{
+				It->StopPoseRecording();
+				It->StopPoseReplay();
+			}
+		}));
+}
+
+void AVRCharacter::SetupPoseRecording()
+{
+	// headless runs, e.g. -VRReplayPoses=Walkthrough.vrposes -VRReplayPosesLoop -benchmark -fps=90
+	FString Filename;
+	if (FParse::Value(FCommandLine::Get(), TEXT("VRReplayPoses="), Filename))
+	{
+		StartPoseReplay(Filename, FParse::Param(FCommandLine::Get(), TEXT("VRReplayPosesLoop")));
+	}
+	else if (FParse::Value(FCommandLine::Get(), TEXT("VRRecordPoses="), Filename))
+	{
+		StartPoseRecording(Filename);
+	}
+}
+
+bool AVRCharacter::StartPoseRecording(const FString &Filename)
+{
+	StopPoseReplay();
+
+	if (!PoseRecorder.bStart(Filename))
+	{
+		return false;
+	}
+
+	PendingPoseFrameInput = FVRPoseFrame();
+
+	UE_LOG(LogTemp, Display, TEXT("AVRCharacter::StartPoseRecording() recording to %s"), *Filename);
+	return true;
+}
+
+void AVRCharacter::StopPoseRecording()
+{
+	if (!PoseRecorder.IsRecording())
+	{
+		return;
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("AVRCharacter::StopPoseRecording() %d frames recorded"), PoseRecorder.GetNumFrames());
+	PoseRecorder.Stop();
+}
+
+bool AVRCharacter::StartPoseReplay(const FString &Filename, bool bLoop)
+{
+	StopPoseRecording();
+
+	if (!PoseReplay.bOpen(Filename))
+	{
+		return false;
+	}
+
+	bLoopPoseReplay = bLoop;
+
+	UE_LOG(LogTemp, Display, TEXT("AVRCharacter::StartPoseReplay() replaying %d frames from %s"), PoseReplay.GetNumFrames(), *Filename);
+	return true;
+}
+
+void AVRCharacter::StopPoseReplay()
+{
+	if (!PoseReplay.IsPlaying())
+	{
+		return;
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("AVRCharacter::StopPoseReplay() stopped at frame %d of %d"), PoseReplay.GetCurrentFrame(), PoseReplay.GetNumFrames());
+	PoseReplay.Close();
+}
+
+void AVRCharacter::RecordPoseFrame(float DeltaTime)
+{
+	if (!ensure((Camera != nullptr) && (LeftMotionControllerComponent != nullptr) && (RightMotionControllerComponent != nullptr)))
+	{
+		return;
+	}
+
+	// the components hang off VRRoot, so their relative transforms are the tracked poses
+	FVRPoseFrame Frame = PendingPoseFrameInput;
+	Frame.DeltaTime = DeltaTime;
+	Frame.Camera = Camera->GetRelativeTransform();
+	Frame.LeftController = LeftMotionControllerComponent->GetRelativeTransform();
+	Frame.RightController = RightMotionControllerComponent->GetRelativeTransform();
+
+	PoseRecorder.AddFrame(Frame);
+
+	// axes are sent every frame, but a button press only once
+	PendingPoseFrameInput.bTeleportPressed = false;
+}
+
+void AVRCharacter::ApplyPoseReplayFrame()
+{
+	if (!ensure((Camera != nullptr) && (LeftMotionControllerComponent != nullptr) && (RightMotionControllerComponent != nullptr)))
+	{
+		return;
+	}
+
+	FVRPoseFrame Frame;
+	if (!PoseReplay.bNextFrame(Frame, bLoopPoseReplay))
+	{
+		StopPoseReplay();
+		return;
+	}
+
+	// without a headset or tracked controllers the components keep the transforms we give them
+	Camera->SetRelativeTransform(Frame.Camera);
+	LeftMotionControllerComponent->SetRelativeTransform(Frame.LeftController);
+	RightMotionControllerComponent->SetRelativeTransform(Frame.RightController);
+
+	// feed the recorded input through the normal handlers
+	bApplyingPoseReplayInput = true;
+	OnMoveForward(Frame.ForwardAxis);
+	OnMoveRight(Frame.RightAxis);
+	if (Frame.bTeleportPressed)
+	{
+		OnTeleport();
+	}
+	bApplyingPoseReplayInput = false;
+}
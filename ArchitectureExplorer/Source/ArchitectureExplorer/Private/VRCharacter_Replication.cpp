@@ -0,0 +1,395 @@
+#include "VRCharacter.h"
+#include "Camera/CameraComponent.h"
+#include "Components/PostProcessComponent.h"
+#include "Components/StaticMeshComponent.h"
+#include "MotionControllerComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "Components/CapsuleComponent.h"
+#include "NavigationSystem.h"
+#include "Net/UnrealNetwork.h"
+#include "TeleportSearchComponent.h"
+
+namespace
+{
+	// frames don't line up with PoseSendRate, so a pose may go out a little early rather than a whole frame late
+	const float PoseSendSlack = 0.9f;
+
+	// how often the server looks for the nearest viewer of a character
+	const float PoseRateUpdateInterval = 1.0f; // seconds
+}
+
+void AVRCharacter::GetLifetimeReplicatedProps(TArray<FLifetimeProperty> &OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	// the owning client is where both come from
+	DOREPLIFETIME_CONDITION(AVRCharacter, ReplicatedPose, COND_SkipOwner);
+	DOREPLIFETIME_CONDITION(AVRCharacter, TeleportEvent, COND_SkipOwner);
+}
+
+bool AVRCharacter::bIsRemoteVRCharacter() const
+{
+	return (GetNetMode() != NM_Standalone) && !IsLocallyControlled();
+}
+
+bool AVRCharacter::bUpdateRemoteState()
+{
+	auto bRemote = bIsRemoteVRCharacter();
+	if (bRemote == bRemoteVRCharacter)
+	{
+		return bRemote;
+	}
+	bRemoteVRCharacter = bRemote;
+
+	// left alone, the camera and controllers would follow the headset and hands of whoever sits at this machine
+	if (Camera != nullptr)
+	{
+		Camera->bLockToHmd = !bRemote;
+	}
+	for (auto MotionController : { LeftMotionControllerComponent, RightMotionControllerComponent })
+	{
+		if (MotionController != nullptr)
+		{
+			MotionController->SetComponentTickEnabled(!bRemote);
+			MotionController->bDisableLowLatencyUpdate = bRemote;
+		}
+	}
+
+	// an unbound blinker would narrow our own view
+	if (PostProcessComponent != nullptr)
+	{
+		PostProcessComponent->bEnabled = !bRemote;
+	}
+
+	// the owner searches, we only show what it found
+	if (bRemote)
+	{
+		if (TeleportSearchComponent != nullptr)
+		{
+			TeleportSearchComponent->SetComponentTickEnabled(false);
+		}
+		ResetAsyncTeleportSearch();
+		InvalidateTeleportCaches();
+	}
+	else
+	{
+		SetTeleportSearchMode(TeleportSearchMode);
+	}
+
+	if (DestinationMarker != nullptr)
+	{
+		DestinationMarker->SetVisibility(false);
+	}
+	UpdateTeleportArc(false);
+
+	// the first replicated pose blends from wherever the components are
+	RemotePoseAlpha = 1.0f;
+
+	return bRemote;
+}
+
+void AVRCharacter::SendPose()
+{
+	auto World = GetWorld();
+
+	if (!ensure(World != nullptr) || !ensure((Camera != nullptr) && (VRRoot != nullptr) && (DestinationMarker != nullptr)))
+	{
+		return;
+	}
+
+	if (!ensure((LeftMotionControllerComponent != nullptr) && (RightMotionControllerComponent != nullptr)))
+	{
+		return;
+	}
+
+	auto Now = World->GetTimeSeconds();
+	if ((Now - LastPoseSendTime) * PoseSendRate < PoseSendSlack)
+	{
+		return;
+	}
+
+	FVRNetPose Pose;
+	Pose.SetTrackedPoses(Camera->GetRelativeTransform(), LeftMotionControllerComponent->GetRelativeTransform(), RightMotionControllerComponent->GetRelativeTransform(), VRRoot->RelativeLocation);
+
+	auto bAiming = DestinationMarker->IsVisible() && !bIsTeleportInProgress();
+	Pose.SetTeleportAim(bAiming, DestinationMarker->GetComponentLocation(), TeleportArcShapeEndTime);
+
+	// a still head and hands cost nothing, apart from a keyframe now and then in case the last update got lost
+	if ((Pose == LastSentPose) && (Now - LastPoseSendTime < PoseKeyframeInterval))
+	{
+		return;
+	}
+
+	LastSentPose = Pose;
+	LastPoseSendTime = Now;
+	PosesSent++;
+
+	// a listen server host replicates its pose straight away
+	if (HasAuthority())
+	{
+		ReplicatedPose.Pose = Pose;
+	}
+	else
+	{
+		ServerUpdatePose(Pose);
+	}
+}
+
+bool AVRCharacter::ServerUpdatePose_Validate(const FVRNetPose &Pose)
+{
+	// every quantized pose is a valid pose
+	return true;
+}
+
+void AVRCharacter::ServerUpdatePose_Implementation(const FVRNetPose &Pose)
+{
+	ReplicatedPose.Pose = Pose;
+
+	// the server shows it too, e.g. to the host of a listen server
+	OnRep_ReplicatedPose();
+}
+
+void AVRCharacter::OnRep_ReplicatedPose()
+{
+	if (!ensure((Camera != nullptr) && (VRRoot != nullptr) && (LeftMotionControllerComponent != nullptr) && (RightMotionControllerComponent != nullptr)))
+	{
+		return;
+	}
+
+	const auto &Pose = ReplicatedPose.Pose;
+
+	// blend from wherever the components are now, so a pose that arrives mid-blend doesn't jump
+	RemotePoseFrom[0] = Camera->GetRelativeTransform();
+	RemotePoseFrom[1] = LeftMotionControllerComponent->GetRelativeTransform();
+	RemotePoseFrom[2] = RightMotionControllerComponent->GetRelativeTransform();
+	RemoteVRRootFrom = VRRoot->RelativeLocation;
+
+	RemotePoseTo[0] = Pose.Camera.Dequantize();
+	RemotePoseTo[1] = Pose.LeftController.Dequantize();
+	RemotePoseTo[2] = Pose.RightController.Dequantize();
+	RemoteVRRootTo = Pose.GetVRRootLocation();
+
+	RemotePoseAlpha = 0.0f;
+	PosesReceived++;
+}
+
+void AVRCharacter::ApplyReplicatedPose(float DeltaTime)
+{
+	if (!ensure((Camera != nullptr) && (VRRoot != nullptr) && (DestinationMarker != nullptr)))
+	{
+		return;
+	}
+
+	if (!ensure((LeftMotionControllerComponent != nullptr) && (RightMotionControllerComponent != nullptr)))
+	{
+		return;
+	}
+
+	if (RemotePoseAlpha < 1.0f)
+	{
+		RemotePoseAlpha = (PoseInterpolationTime > 0.0f) ? FMath::Min(RemotePoseAlpha + DeltaTime / PoseInterpolationTime, 1.0f) : 1.0f;
+
+		// VRRoot first, the others hang off it
+		VRRoot->SetRelativeLocation(FMath::Lerp(RemoteVRRootFrom, RemoteVRRootTo, RemotePoseAlpha));
+
+		USceneComponent *Components[3] = { Camera, LeftMotionControllerComponent, RightMotionControllerComponent };
+		for (int32 Index = 0; Index < 3; Index++)
+		{
+			FTransform Blended;
+			Blended.Blend(RemotePoseFrom[Index], RemotePoseTo[Index], RemotePoseAlpha);
+			Components[Index]->SetRelativeTransform(Blended);
+		}
+	}
+
+	// the arc starts at the replicated right controller and flies as long as it did for the owner
+	// (if the owner's teleport fan picked a neighbouring arc, we draw the one along the controller)
+	const auto &Pose = ReplicatedPose.Pose;
+
+	FVector Start, Velocity;
+	if (Pose.bTeleportAiming && bGetTeleportArcLaunch(Start, Velocity))
+	{
+		TeleportArcShape = MakeTeleportArcParams(Start, Velocity);
+		TeleportArcShapeEndTime = Pose.GetTeleportArcTime();
+		UpdateTeleportArc(true);
+
+		auto Destination = Pose.GetTeleportDestination();
+		if (!DestinationMarker->GetComponentLocation().Equals(Destination))
+		{
+			DestinationMarker->SetWorldLocation(Destination);
+		}
+		DestinationMarker->SetVisibility(true);
+	}
+	else
+	{
+		UpdateTeleportArc(false);
+		DestinationMarker->SetVisibility(false);
+	}
+}
+
+void AVRCharacter::SendTeleportEvent(bool bArrived, const FVector &Location)
+{
+	if (GetNetMode() == NM_Standalone)
+	{
+		return;
+	}
+
+	if (!HasAuthority())
+	{
+		if (bArrived)
+		{
+			ServerFinishTeleport(Location);
+		}
+		else
+		{
+			ServerBeginTeleport(Location);
+		}
+		return;
+	}
+
+	TeleportEvent.Sequence++;
+	TeleportEvent.bArrived = bArrived;
+	TeleportEvent.Location = Location;
+}
+
+bool AVRCharacter::ServerBeginTeleport_Validate(FVector_NetQuantize Destination)
+{
+	return !Destination.ContainsNaN();
+}
+
+void AVRCharacter::ServerBeginTeleport_Implementation(FVector_NetQuantize Destination)
+{
+	SendTeleportEvent(false, Destination);
+}
+
+bool AVRCharacter::ServerFinishTeleport_Validate(FVector_NetQuantize Location)
+{
+	return !Location.ContainsNaN();
+}
+
+void AVRCharacter::ServerFinishTeleport_Implementation(FVector_NetQuantize Location)
+{
+	// we stay where we are, the client gets corrected back by its next move
+	FVector ValidLocation;
+	if (!bValidateServerTeleport(Location, ValidLocation))
+	{
+		return;
+	}
+
+	SetActorLocation(ValidLocation, false, nullptr, ETeleportType::TeleportPhysics);
+	SendTeleportEvent(true, ValidLocation);
+}
+
+bool AVRCharacter::bValidateServerTeleport(const FVector &Location, FVector &OutLocation) const
+{
+	auto World = GetWorld();
+	auto CapsuleComponent = GetCapsuleComponent();
+
+	if (!ensure(World != nullptr) || !ensure(CapsuleComponent != nullptr))
+	{
+		return false;
+	}
+
+	// the farthest an arc lands from its start: launch speed and gravity pulling in the same direction the whole time
+	// the start is the controller somewhere in the play space, and the landing point gets projected
+	auto HalfHeight = CapsuleComponent->GetScaledCapsuleHalfHeight();
+	auto MaxRange = TeleportProjectileSpeed * TeleportSimulationTime + 0.5f * FMath::Abs(World->GetGravityZ()) * FMath::Square(TeleportSimulationTime);
+	MaxRange += TeleportProjectionExtent.Size() + HalfHeight + ServerTeleportRangeSlack;
+
+	if (FVector::DistSquared(Location, GetActorLocation()) > FMath::Square(MaxRange))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("AVRCharacter::bValidateServerTeleport() %s teleported %.0fcm, out of range %.0fcm"), *GetName(), FVector::Dist(Location, GetActorLocation()), MaxRange);
+		return false;
+	}
+
+	// the client teleports its capsule center, the navigation mesh is at its feet
+	auto Feet = Location - FVector(0.0f, 0.0f, HalfHeight);
+
+	// without navigation there is nothing to snap to, the range check has to do
+	auto NavigationSystem = Cast<UNavigationSystemV1>(World->GetNavigationSystem());
+	if (NavigationSystem == nullptr)
+	{
+		OutLocation = Location;
+		return true;
+	}
+
+	FNavLocation NavLocation;
+	if (!NavigationSystem->ProjectPointToNavigation(Feet, NavLocation, TeleportProjectionExtent))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("AVRCharacter::bValidateServerTeleport() %s teleported off the navigation mesh at %s"), *GetName(), *Location.ToString());
+		return false;
+	}
+
+	OutLocation = NavLocation.Location + FVector(0.0f, 0.0f, HalfHeight);
+	return true;
+}
+
+void AVRCharacter::OnRep_TeleportEvent()
+{
+	if (TeleportEvent.bArrived)
+	{
+		ReceiveRemoteTeleportFinish(TeleportEvent.Location, TeleportFadeIn);
+	}
+	else
+	{
+		ReceiveRemoteTeleportBegin(TeleportEvent.Location, TeleportFadeOut);
+	}
+}
+
+void AVRCharacter::UpdatePoseNetUpdateFrequency()
+{
+	auto World = GetWorld();
+	if (World == nullptr)
+	{
+		return;
+	}
+
+	auto Now = World->GetTimeSeconds();
+	if (Now - PoseRateUpdateTime < PoseRateUpdateInterval)
+	{
+		return;
+	}
+	PoseRateUpdateTime = Now;
+
+	// the nearest viewer decides; the engine's net priority already favours near viewers when bandwidth runs out
+	auto NearestDistance = BIG_NUMBER;
+	for (auto It = World->GetPlayerControllerIterator(); It; ++It)
+	{
+		auto PlayerController = It->Get();
+		if ((PlayerController == nullptr) || (PlayerController->GetPawn() == this))
+		{
+			continue;
+		}
+
+		FVector ViewLocation;
+		FRotator ViewRotation;
+		PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+
+		auto ToUs = GetActorLocation() - ViewLocation;
+		auto Distance = ToUs.Size();
+		if ((ToUs | ViewRotation.Vector()) < 0.0f)
+		{
+			Distance *= 2.0f;
+		}
+		NearestDistance = FMath::Min(NearestDistance, Distance);
+	}
+
+	auto Alpha = FMath::Clamp((NearestDistance - PoseFullRateDistance) / FMath::Max(PoseMinRateDistance - PoseFullRateDistance, 1.0f), 0.0f, 1.0f);
+	NetUpdateFrequency = FMath::Lerp(MaxPoseNetUpdateFrequency, MinPoseNetUpdateFrequency, Alpha);
+}
+
+void AVRCharacter::CountPoseUpdates()
+{
+	auto Now = GetWorld()->GetTimeSeconds();
+	if (Now - PoseCountTime < 1.0f)
+	{
+		return;
+	}
+
+	PosesSentPerSecond = FMath::RoundToInt(PosesSent / (Now - PoseCountTime));
+	PosesReceivedPerSecond = FMath::RoundToInt(PosesReceived / (Now - PoseCountTime));
+
+	PosesSent = 0;
+	PosesReceived = 0;
+	PoseCountTime = Now;
+}
@@ -0,0 +1,33 @@
+#include "VRCharacter.h"
+#include "ArchitectureSignificanceManager.h"
+#include "Camera/CameraComponent.h"
+#include "Components/StaticMeshComponent.h"
+
+void AVRCharacter::SetupSignificance()
+{
+	// nobody looks at a dedicated server
+	if (!bDriveSignificance || (GetNetMode() == NM_DedicatedServer))
+	{
+		return;
+	}
+
+	SignificanceManager = AArchitectureSignificanceManager::FindOrSpawn(GetWorld());
+}
+
+void AVRCharacter::UpdateSignificanceViewpoint()
+{
+	if ((SignificanceManager == nullptr) || !ensure((Camera != nullptr) && (DestinationMarker != nullptr)))
+	{
+		return;
+	}
+
+	// one viewpoint per world: the player at this machine, not benchmark pawns, spectators or other split screen players
+	if (!IsLocallyControlled() || !IsPlayerControlled())
+	{
+		return;
+	}
+
+	// the marker as the last search left it, a frame old if the search runs later
+	auto bAiming = DestinationMarker->IsVisible() && !bIsTeleportInProgress();
+	SignificanceManager->SetViewpoint(Camera->GetComponentLocation(), Camera->GetForwardVector(), bAiming, DestinationMarker->GetComponentLocation());
+}
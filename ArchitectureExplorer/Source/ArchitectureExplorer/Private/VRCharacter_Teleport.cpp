@@ -5,8 +5,33 @@
 #include "MotionControllerComponent.h"
 #include "Kismet/GameplayStatics.h"
 #include "NavigationSystem.h"
+#include "NavMesh/RecastNavMesh.h"
+#include "TeleportSurfaceIndex.h"
+#include "TeleportSearchComponent.h"
+#include "TeleportSearchBatch.h"
 #include "Engine/World.h"
 #include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/PackageName.h"
+#include "Engine/LevelStreaming.h"
+#include "UObject/UObjectGlobals.h"
+#include "Camera/PlayerCameraManager.h"
+#include "GenerateTeleportProxiesCommandlet.h"
+#include "TeleportNavigationUpdater.h"
+
+// compare the arc tracer against PredictProjectilePath while playing
+static TAutoConsoleVariable<int32> CVarValidateTeleportArcTracer(
+	TEXT("vr.ValidateTeleportArcTracer"),
+	0,
+	TEXT("When 1, every synchronous teleport search on the game thread also runs PredictProjectilePath and logs if the arc tracer disagrees"),
+	ECVF_Cheat);
+
+static TAutoConsoleVariable<float> CVarTeleportArcTracerTolerance(
+	TEXT("vr.TeleportArcTracerTolerance"),
+	5.0f,
+	TEXT("Distance in centimeters the arc tracer hit may be away from the PredictProjectilePath hit before vr.ValidateTeleportArcTracer complains"),
+	ECVF_Cheat);
 
 void AVRCharacter::BeginTeleport()
 {
@@ -28,16 +53,39 @@ void AVRCharacter::BeginTeleport()
 		return;
 	}
 
+	// go where the last search found a destination, not where the marker is drawn
+	// the late latch and the extrapolation on skipped frames only move the marker, nothing validated those spots
+	if (!bLastTeleportDestinationFound)
+	{
+		return;
+	}
+	const auto Destination = LastTeleportDestination;
+
+	// the destination may have been found a few frames ago, the cache makes this check almost free
+	if (bValidateTeleportClearance && !bHasTeleportClearance(Destination))
+	{
+		return;
+	}
+
+	// whatever we cached was computed from where we are now
+	InvalidateTeleportCaches();
+
 	// record teleport location
-	TeleportLocation = DestinationMarker->GetComponentLocation();
+	TeleportLocation = Destination;
 	TeleportLocation.Z += CapsuleComponent->GetScaledCapsuleHalfHeight(); // offset up by our capsule so we don't teleport into the ground
 
-	// fade out
-	PlayerController->PlayerCameraManager->StartCameraFade(0.0f, 1.0f, TeleportFadeOut, FLinearColor::Black);
+	// usually the marker rested there long enough already, otherwise the fade out is all the head start we get
+	StartTeleportPrefetch(Destination);
 
-	// setup timer to finish the teleportation
-	GetWorldTimerManager().SetTimer(TeleportFadeTimerHandle, this, &AVRCharacter::FinishTeleport, TeleportFadeOut);
+	// fade out, and stay black until we fade in again
+	PlayerController->PlayerCameraManager->StartCameraFade(0.0f, 1.0f, TeleportFadeOut, FLinearColor::Black, false, true);
 
+	// UpdateTeleport finishes the teleportation once the fade is done
+	TeleportState = ETeleportState::FadingOut;
+	TeleportBeginTime = GetWorld()->GetTimeSeconds();
+	TeleportStateTime = TeleportBeginTime;
+
+	SendTeleportEvent(false, Destination);
 }
 
 void AVRCharacter::FinishTeleport()
@@ -48,43 +96,248 @@ void AVRCharacter::FinishTeleport()
 	// if that happens, we would fail below assert and also never fade back in
 	if (!ensure((PlayerController != nullptr) && (PlayerController->PlayerCameraManager != nullptr)))
 	{
+		TeleportState = ETeleportState::None;
 		return;
 	}
 
+	// how much of the destination made it in time
+	ReportTeleportPrefetch();
+
 	// camera has finished fading out
 	// now we can teleport to new location
 	SetActorLocation(TeleportLocation);
+	SendTeleportEvent(true, TeleportLocation);
+
+	// the level streaming only starts on what is around us now, we wait for it in the dark
+	TeleportState = ETeleportState::WaitingForDestination;
+	TeleportStateTime = GetWorld()->GetTimeSeconds();
+}
+
+void AVRCharacter::UpdateTeleport()
+{
+	if (TeleportState == ETeleportState::None)
+	{
+		return;
+	}
+
+	auto World = GetWorld();
+	if (!ensure(World != nullptr))
+	{
+		return;
+	}
+
+	auto StateAge = World->GetTimeSeconds() - TeleportStateTime;
+
+	if (TeleportState == ETeleportState::FadingOut)
+	{
+		if (StateAge >= TeleportFadeOut)
+		{
+			FinishTeleport();
+		}
+		return;
+	}
+
+	// give the eyes a moment in the dark even if there is nothing to wait for
+	if (StateAge < MinTeleportBlackTime)
+	{
+		return;
+	}
+
+	auto bDestinationReady = !bWaitForTeleportDestination || bIsTeleportDestinationReady();
+	if (bDestinationReady || (StateAge >= MaxTeleportBlackTime))
+	{
+		FadeInTeleport(bDestinationReady);
+	}
+}
+
+void AVRCharacter::FadeInTeleport(bool bDestinationReady)
+{
+	auto PlayerController = Cast<APlayerController>(GetController());
+	auto Now = GetWorld()->GetTimeSeconds();
+
+	TeleportState = ETeleportState::None;
+
+	LastTeleportBlackTime = Now - TeleportStateTime;
+	LastTeleportFadeTime = Now - TeleportBeginTime;
+	TeleportBlackTimeHistory.Add(1000.0f * LastTeleportBlackTime);
+
+	SET_FLOAT_STAT(STAT_VRCharacter_TeleportBlackTime, 1000.0f * LastTeleportBlackTime);
+	CSV_CUSTOM_STAT(VRCharacter, TeleportBlackTime, 1000.0f * LastTeleportBlackTime, ECsvCustomStatOp::Set);
+
+	if (!bDestinationReady)
+	{
+		TeleportBlackTimeouts++;
+		UE_LOG(LogTemp, Warning, TEXT("AVRCharacter::FadeInTeleport() destination still loading after %.2f s, fading in anyway"), LastTeleportBlackTime);
+	}
+	else
+	{
+		UE_LOG(LogTemp, Verbose, TEXT("AVRCharacter::FadeInTeleport() black for %.3f s, teleport took %.3f s"), LastTeleportBlackTime, LastTeleportFadeTime);
+	}
+
+	if (!ensure((PlayerController != nullptr) && (PlayerController->PlayerCameraManager != nullptr)))
+	{
+		return;
+	}
 
 	// fade back in
 	PlayerController->PlayerCameraManager->StartCameraFade(1.0f, 0.0f, TeleportFadeIn, FLinearColor::Black);
 }
 
-bool AVRCharacter::bFindTeleportDestination(FVector &OutLocation)
+bool AVRCharacter::bIsTeleportDestinationReady() const
+{
+	// only what the prefetch asked for; async loads and visibility requests of anybody else
+	// (other players, unrelated streaming) are not ours to wait for
+	for (const auto &StreamingLevelPtr : PrefetchLevels)
+	{
+		auto StreamingLevel = StreamingLevelPtr.Get();
+		if (StreamingLevel == nullptr)
+		{
+			continue;
+		}
+
+		// wanted by the streaming volumes around us, but not there yet
+		if (StreamingLevel->ShouldBeLoaded() && (StreamingLevel->GetLoadedLevel() == nullptr))
+		{
+			return false;
+		}
+
+		// loaded but still being added to the world, a few actors per frame
+		if (StreamingLevel->ShouldBeVisible() && !StreamingLevel->IsLevelVisible())
+		{
+			return false;
+		}
+	}
+
+	// packages we requested that are still in the loading queue (negative once they left it)
+	for (const auto &PackageName : PrefetchPackageNames)
+	{
+		if (GetAsyncLoadPercentage(PackageName) >= 0.0f)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool AVRCharacter::bIsTeleportInProgress() const
+{
+	// the search resumes while we fade back in
+	return TeleportState != ETeleportState::None;
+}
+
+bool AVRCharacter::bFindTeleportDestination(FVector &OutLocation, bool bLookupCache)
+{
+	// don't do line traces if we have a teleport in progress
+	// also stop showing the teleportation marker
+	if (bIsTeleportInProgress())
+	{
+		DestinationMarker->SetVisibility(false);
+		return false;
+	}
+
+	BeginTeleportSearch(TeleportSearchJob, bLookupCache);
+	TeleportSearchJob.Trace();
+
+	return bFinishTeleportSearch(TeleportSearchJob, OutLocation);
+}
+
+bool AVRCharacter::bFinishTeleportSearch(FTeleportSearchJob &Job, FVector &OutLocation)
+{
+	if (!Job.bPending)
+	{
+		return false;
+	}
+	Job.bPending = false;
+
+	if (!Job.bFromCache)
+	{
+		CharacterStats.AddPhysicsQueries(Job.NumQueries);
+
+		if (bUseTeleportArcTracer && (CVarValidateTeleportArcTracer.GetValueOnGameThread() != 0))
+		{
+			bValidateTeleportArcTracer(Job.Arc.Start, Job.Arc.LaunchVelocity, CVarTeleportArcTracerTolerance.GetValueOnGameThread());
+		}
+
+		if (Job.bArcHit)
+		{
+			TeleportArcShape = Job.Arc;
+			TeleportArcShapeEndTime = Job.HitTime;
+		}
+
+		// and project to navigation mesh, unless the surface index already did
+		if (Job.bArcHit && !Job.bResolved)
+		{
+			Job.Result.bFound = Job.bSurfaceIndexMissed ? bProjectTeleportToNavMesh(Job.Result.Location, Job.HitLocation) : bProjectTeleportToNavigation(Job.Result.Location, Job.HitLocation);
+		}
+	}
+
+	// furniture and low ceilings are on the navigation mesh too
+	if (Job.Result.bFound && !Job.bFromCache && bValidateTeleportClearance)
+	{
+		Job.Result.bFound = bHasTeleportClearance(Job.Result.Location);
+	}
+
+	// and so is the floor under a wall that was just moved there; cached results too, the wall may have come since
+	if (Job.Result.bFound && bInsideMovingArchitecture(Job.Result.Location))
+	{
+		Job.Result.bFound = false;
+	}
+
+	// nothing where we point, maybe a little to the side
+	if (!Job.Result.bFound && !Job.bFromCache && bUseTeleportFan)
+	{
+		Job.Result.bFound = bSearchTeleportFan(Job.Arc, Job.bArcHit, Job.HitLocation, Job.Result.Location);
+	}
+
+	if (!Job.bFromCache)
+	{
+		StoreTeleportPoseCache(Job.Result, Job.ControllerLocation, Job.ControllerForward);
+	}
+
+	OutLocation = Job.Result.Location;
+	return Job.Result.bFound;
+}
+
+void AVRCharacter::BeginTeleportSearch(FTeleportSearchJob &Job, bool bLookupCache)
 {
+	Job.Reset();
+
 	auto World = GetWorld();
 
 	if (!ensure(World != nullptr))
 	{
-		return false;
+		return;
 	}
 
 	if (!ensure(Camera != nullptr))
 	{
-		return false;
+		return;
 	}
 
 	if (!ensure(RightMotionControllerComponent != nullptr))
 	{
-		return false;
+		return;
 	}
 
-	// don't do line traces if we have a teleport in progress
-	// also stop showing the teleportation marker
-	if (GetWorldTimerManager().IsTimerActive(TeleportFadeTimerHandle))
+	Job.bPending = true;
+	Job.World = World;
+	Job.QueryParams = &TeleportQueryParams;
+	UpdateTeleportSurfaceValidity();
+	Job.SurfaceIndex = bTeleportSurfaceIndexValid ? TeleportSurfaceIndex : nullptr;
+	Job.SurfaceValidity = TeleportSurfaceValidity;
+	Job.ProjectionExtent = TeleportProjectionExtent;
+
+	// reuse the last search if the controller has barely moved since
+	Job.ControllerLocation = RightMotionControllerComponent->GetComponentLocation();
+	Job.ControllerForward = RightMotionControllerComponent->GetForwardVector();
+
+	if (bLookupCache && bLookupTeleportPoseCache(Job.Result, Job.ControllerLocation, Job.ControllerForward))
 	{
-		DestinationMarker->SetVisibility(false);
-		return false;
+		Job.bFromCache = true;
+		return;
 	}
+	Job.Result.PoseTime = World->GetTimeSeconds();
 
 	// output parameter
 	FHitResult HitResult;
@@ -109,16 +362,18 @@ bool AVRCharacter::bFindTeleportDestination(FVector &OutLocation)
 	FVector Start = RightMotionControllerComponent->GetComponentLocation() + 5.0f * PointDirection;
 	FVector End = Start + MaxTeleportDistance_UNUSED * PointDirection;
 
+	// the teleport fan searches around this arc if we find nothing
+	Job.Arc = MakeTeleportArcParams(Start, TeleportProjectileSpeed * PointDirection);
+
 	if (bUseLinetraceInsteadOfProjectileTrace)
 	{
 		// do the linetrace
-		auto bLineTraceFoundTarget = World->LineTraceSingleByChannel(HitResult, Start, End, ECollisionChannel::ECC_Visibility);
-		if (!bLineTraceFoundTarget)
-		{
-			return false;
-		}
+		Job.bTraced = true;
+		Job.NumQueries = 1;
+		Job.bArcHit = World->LineTraceSingleByChannel(HitResult, Start, End, TeleportArcChannel);
+		Job.HitLocation = HitResult.Location;
 	}
-	else
+	else if (!bUseTeleportArcTracer)
 	{
 		// do projectile trace
 		FPredictProjectilePathParams PredictParams(
@@ -126,30 +381,224 @@ bool AVRCharacter::bFindTeleportDestination(FVector &OutLocation)
 			Start,										// InStartLocation
 			TeleportProjectileSpeed * PointDirection,	// InLaunchVelocity
 			TeleportSimulationTime,						// InMaxSimTime
-			ECollisionChannel::ECC_Visibility,			// InTraceChannel
+			TeleportArcChannel,							// InTraceChannel
 			this										// ActorToIgnore
 		);
-		PredictParams.DrawDebugType = EDrawDebugTrace::ForOneFrame;
 		FPredictProjectilePathResult PredictResult;
 
-		auto bProjectilePathFoundTarget = UGameplayStatics::PredictProjectilePath(this, PredictParams, PredictResult);
+		Job.bTraced = true;
+		Job.bArcHit = UGameplayStatics::PredictProjectilePath(this, PredictParams, PredictResult);
+		// one sweep per simulated step
+		Job.NumQueries = FMath::Max(PredictResult.PathData.Num() - 1, 1);
+		Job.HitLocation = PredictResult.HitResult.Location;
+		Job.HitTime = PredictResult.LastTraceDestination.Time;
+	}
 
-		if (!bProjectilePathFoundTarget)
-		{
-			return false;
-		}
+	// otherwise FTeleportSearchJob::Trace does projectile trace with our own arc tracer, on whatever thread calls it
+}
 
-		HitResult = PredictResult.HitResult;
+void AVRCharacter::SetupTeleportScratch()
+{
+	// built once, so the per-frame searches don't construct (and fill) a new ignore list every time
+	TeleportQueryParams = FCollisionQueryParams(SCENE_QUERY_STAT(TeleportArc), false, this);
+
+	// only processed maps have something on the Teleport channel
+	TeleportArcChannel = (bUseTeleportProxies && UGenerateTeleportProxiesCommandlet::bHasTeleportProxies(GetWorld())) ?
+		UGenerateTeleportProxiesCommandlet::TeleportTraceChannel : ECollisionChannel::ECC_Visibility;
+
+	// grow the working arrays to their steady-state size up front,
+	// after this a teleport search does not touch the heap
+	TeleportSearchJob.Reserve();
+	AsyncTeleportSearchJob.Reserve();
+	CachedNavPolyVerts.Reserve(MaxTeleportNavPolyVerts);
+
+	TeleportFanCandidates.SetNum(TeleportFanSize);
+	TeleportFanTracers.SetNum(TeleportFanSize);
+	for (auto &Tracer : TeleportFanTracers)
+	{
+		Tracer.Reserve();
 	}
+	TeleportFanTasks.Reserve(TeleportFanSize);
+}
 
-	// output parameter
-	FVector NavLocation;
+bool AVRCharacter::bGetTeleportArcLaunch(FVector &OutStart, FVector &OutVelocity) const
+{
+	if (RightMotionControllerComponent == nullptr)
+	{
+		return false;
+	}
 
-	// and project to navigation mesh
-	bool bNavLocationFound = false;
-	bNavLocationFound = bProjectTeleportToNavigation(OutLocation, HitResult.Location);
+	FVector PointDirection = RightMotionControllerComponent->GetForwardVector().GetSafeNormal();
 
-	return bNavLocationFound;
+	// same 5cm step away from the controller as in bFindTeleportDestination
+	OutStart = RightMotionControllerComponent->GetComponentLocation() + 5.0f * PointDirection;
+	OutVelocity = TeleportProjectileSpeed * PointDirection;
+
+	return true;
+}
+
+bool AVRCharacter::bValidateTeleportArcTracer(const FVector &Start, const FVector &LaunchVelocity, float Tolerance, FTeleportArcTracerComparison *OutComparison)
+{
+	auto World = GetWorld();
+	if (!ensure(World != nullptr) || !ensure(IsInGameThread()))
+	{
+		return false;
+	}
+
+	// our own tracer, so the arc shape and hit time of the search stay as they are
+	FTeleportArcTracer Tracer;
+	FHitResult ArcHit;
+	auto StartCycles = FPlatformTime::Cycles64();
+	auto bArcFoundTarget = Tracer.bTrace(World, MakeTeleportArcParams(Start, LaunchVelocity), TeleportQueryParams, ArcHit);
+	auto TracerCycles = FPlatformTime::Cycles64() - StartCycles;
+
+	FPredictProjectilePathParams PredictParams(TeleportProjectileRadius, Start, LaunchVelocity, TeleportSimulationTime, TeleportArcChannel, this);
+	FPredictProjectilePathResult PredictResult;
+	StartCycles = FPlatformTime::Cycles64();
+	auto bPredictFoundTarget = UGameplayStatics::PredictProjectilePath(this, PredictParams, PredictResult);
+	auto PredictCycles = FPlatformTime::Cycles64() - StartCycles;
+
+	if (OutComparison != nullptr)
+	{
+		// the path starts with the launch point, every further point is the end of one sweep
+		OutComparison->TracerQueries = Tracer.GetNumQueries();
+		OutComparison->PredictQueries = FMath::Max(PredictResult.PathData.Num() - 1, 0);
+		OutComparison->TracerMilliseconds = (float)FPlatformTime::ToMilliseconds64(TracerCycles);
+		OutComparison->PredictMilliseconds = (float)FPlatformTime::ToMilliseconds64(PredictCycles);
+	}
+
+	if ((bPredictFoundTarget == bArcFoundTarget) &&
+		(!bArcFoundTarget || (FVector::Dist(PredictResult.HitResult.Location, ArcHit.Location) <= Tolerance)))
+	{
+		return true;
+	}
+
+	UE_LOG(LogTemp, Warning, TEXT("AVRCharacter::bValidateTeleportArcTracer() launched at %s: arc tracer hit=%d at %s (%d queries), PredictProjectilePath hit=%d at %s"),
+		*LaunchVelocity.ToString(), bArcFoundTarget, *ArcHit.Location.ToString(), Tracer.GetNumQueries(),
+		bPredictFoundTarget, *PredictResult.HitResult.Location.ToString());
+	return false;
+}
+
+FTeleportArcParams AVRCharacter::MakeTeleportArcParams(const FVector &Start, const FVector &LaunchVelocity) const
+{
+	FTeleportArcParams Params;
+	Params.Start = Start;
+	Params.LaunchVelocity = LaunchVelocity;
+	Params.SimulationTime = TeleportSimulationTime;
+	Params.Radius = TeleportProjectileRadius;
+	Params.MaxDeviation = TeleportArcMaxDeviation;
+	Params.TraceChannel = TeleportArcChannel;
+
+	auto World = GetWorld();
+	if (World != nullptr)
+	{
+		Params.GravityZ = World->GetGravityZ();
+	}
+
+	return Params;
+}
+
+bool AVRCharacter::bFindTeleportDestinationAsync(FVector &OutLocation)
+{
+	auto World = GetWorld();
+
+	if (!ensure(World != nullptr))
+	{
+		return false;
+	}
+
+	// don't do traces if we have a teleport in progress (same as the synchronous search)
+	// any result we already have would point to where we came from, so drop it
+	if (bIsTeleportInProgress())
+	{
+		ResetAsyncTeleportSearch();
+		return false;
+	}
+
+	// the search we started last frame, if its trace is done
+	CollectAsyncTeleportSearch();
+
+	// and start the next one from the current pose, unless the last one is still tracing
+	auto bCacheChecked = bIssueAsyncTeleportSearch();
+
+	// use the latest completed result unless it got too old (e.g. the trace took longer than a frame)
+	auto ResultAge = World->GetTimeSeconds() - LastAsyncTeleportResult.PoseTime;
+	if ((LastAsyncTeleportResult.PoseTime >= 0.0f) && (ResultAge <= MaxAsyncTeleportResultAge))
+	{
+		OutLocation = LastAsyncTeleportResult.Location;
+		return LastAsyncTeleportResult.bFound;
+	}
+
+	// nothing recent enough, e.g. the very first frame
+	// the issue above already missed the pose cache for this pose, looking again would count a second miss
+	return bFindTeleportDestination(OutLocation, !bCacheChecked);
+}
+
+bool AVRCharacter::bIssueAsyncTeleportSearch()
+{
+	auto World = GetWorld();
+
+	if (!ensure(World != nullptr))
+	{
+		return false;
+	}
+
+	// one search in flight at a time
+	if (AsyncTeleportSearchJob.bPending)
+	{
+		return false;
+	}
+
+	BeginTeleportSearch(AsyncTeleportSearchJob);
+
+	// if the controller has barely moved, the cached search is as good as a new one
+	if (AsyncTeleportSearchJob.bFromCache)
+	{
+		AsyncTeleportSearchJob.bPending = false;
+		LastAsyncTeleportResult = AsyncTeleportSearchJob.Result;
+		LastAsyncTeleportResult.PoseTime = World->GetTimeSeconds();
+		return true;
+	}
+
+	// the job only writes to itself, so the game thread carries on while a worker traces it
+	if (AsyncTeleportSearchJob.bNeedsTrace())
+	{
+		AsyncTeleportSearchTask = FTeleportSearchTraceTask::Dispatch(AsyncTeleportSearchJob);
+	}
+
+	return AsyncTeleportSearchJob.bPending;
+}
+
+void AVRCharacter::CollectAsyncTeleportSearch()
+{
+	if (!AsyncTeleportSearchJob.bPending)
+	{
+		return;
+	}
+
+	// still tracing, we look again next frame instead of waiting
+	if (AsyncTeleportSearchTask.IsValid() && !AsyncTeleportSearchTask->IsComplete())
+	{
+		return;
+	}
+	AsyncTeleportSearchTask.SafeRelease();
+
+	FVector Location;
+	bFinishTeleportSearch(AsyncTeleportSearchJob, Location);
+	LastAsyncTeleportResult = AsyncTeleportSearchJob.Result;
+}
+
+void AVRCharacter::ResetAsyncTeleportSearch()
+{
+	// the trace writes to the job, so it has to be done before anybody touches the job again
+	if (AsyncTeleportSearchTask.IsValid() && !AsyncTeleportSearchTask->IsComplete())
+	{
+		FTaskGraphInterface::Get().WaitUntilTaskCompletes(AsyncTeleportSearchTask, ENamedThreads::GameThread);
+	}
+	AsyncTeleportSearchTask.SafeRelease();
+
+	AsyncTeleportSearchJob.bPending = false;
+	LastAsyncTeleportResult = FTeleportSearchResult();
 }
 
 void AVRCharacter::MoveDestinationMarkerByLineTrace()
@@ -162,8 +611,159 @@ void AVRCharacter::MoveDestinationMarkerByLineTrace()
 	// output parameter
 	FVector Location;
 
+	bool bDestinationFound = false;
+	if (bUseAsyncTeleportSearch)
+	{
+		bDestinationFound = bFindTeleportDestinationAsync(Location);
+	}
+	else
+	{
+		bDestinationFound = bFindTeleportDestination(Location);
+	}
+
+	ShowTeleportDestination(bDestinationFound, Location);
+}
+
+bool AVRCharacter::bUsesTeleportSearchComponent() const
+{
+	return (TeleportSearchMode == ETeleportSearchMode::Component) && (TeleportSearchComponent != nullptr) && TeleportSearchComponent->IsSearching();
+}
+
+bool AVRCharacter::bWantsTeleportSearchBatch() const
+{
+	return (TeleportSearchMode == ETeleportSearchMode::Batch) && (TeleportSearchBatchFrame == GFrameCounter);
+}
+
+void AVRCharacter::SetTeleportSearchMode(ETeleportSearchMode Mode)
+{
+	TeleportSearchMode = Mode;
+
+	if (TeleportSearchComponent != nullptr)
+	{
+		TeleportSearchComponent->SetComponentTickEnabled(Mode == ETeleportSearchMode::Component);
+	}
+
+	if ((Mode == ETeleportSearchMode::Batch) && (TeleportSearchBatch == nullptr))
+	{
+		TeleportSearchBatch = ATeleportSearchBatch::FindOrSpawn(GetWorld());
+		if (TeleportSearchBatch != nullptr)
+		{
+			TeleportSearchBatch->RegisterCharacter(this);
+		}
+	}
+	else if ((Mode != ETeleportSearchMode::Batch) && (TeleportSearchBatch != nullptr))
+	{
+		TeleportSearchBatch->UnregisterCharacter(this);
+		TeleportSearchBatch = nullptr;
+	}
+}
+
+void AVRCharacter::PrepareTeleportSearchJob()
+{
+	// the marker tick hides the marker while we teleport, no need to trace
+	if (!bTeleportSearchThisFrame || bTeleportInProgressThisFrame)
+	{
+		return;
+	}
+
+	VRCHARACTER_SCOPED_STAGE(CharacterStats, MoveDestinationMarkerByLineTrace);
+	BeginTeleportSearch(TeleportSearchJob);
+}
+
+void AVRCharacter::SearchTeleportDestination()
+{
+	// the frame budget skipped us, ApplyTeleportDestinationSearch extrapolates the marker
+	if (!bTeleportSearchThisFrame)
+	{
+		return;
+	}
+
+	VRCHARACTER_SCOPED_STAGE(CharacterStats, MoveDestinationMarkerByLineTrace);
+	MoveDestinationMarkerByLineTrace();
+}
+
+void AVRCharacter::ApplyTeleportDestinationSearch()
+{
+	{
+		VRCHARACTER_SCOPED_STAGE(CharacterStats, MoveDestinationMarkerByLineTrace);
+
+		if (bTeleportInProgressThisFrame)
+		{
+			TeleportSearchJob.bPending = false;
+			ShowTeleportDestination(false, FVector::ZeroVector);
+		}
+		else if (!bTeleportSearchThisFrame)
+		{
+			SkipTeleportSearch();
+		}
+		else if (TeleportSearchJob.bPending)
+		{
+			// the trace ran on a worker thread, outside of the stage
+			CharacterStats.AddStageMilliseconds(EVRCharacterStage::MoveDestinationMarkerByLineTrace, TeleportSearchJob.TraceMilliseconds);
+
+			FVector Location;
+			auto bDestinationFound = bFinishTeleportSearch(TeleportSearchJob, Location);
+			ShowTeleportDestination(bDestinationFound, Location);
+		}
+	}
+
+	// the search was the last part of this character frame
+	CharacterStats.EndFrame();
+}
+
+void AVRCharacter::SkipTeleportSearch()
+{
+	auto World = GetWorld();
+
+	if (!ensure(World != nullptr) || !ensure(DestinationMarker != nullptr))
+	{
+		return;
+	}
+
+	// finish the async search if its trace is done, so its result is not older than it has to be
+	// the next one starts on the next frame we search
+	CollectAsyncTeleportSearch();
+
+	if (!bLastTeleportDestinationFound || !DestinationMarker->IsVisible())
+	{
+		return;
+	}
+
+	auto Age = FMath::Min(World->GetTimeSeconds() - LastTeleportDestinationTime, MaxTeleportMarkerExtrapolation);
+	DestinationMarker->SetWorldLocation(LastTeleportDestination + Age * TeleportDestinationVelocity);
+}
+
+void AVRCharacter::ShowTeleportDestination(bool bDestinationFound, const FVector &Location)
+{
+	auto World = GetWorld();
+
+	if (!ensure(World != nullptr) || !ensure(DestinationMarker != nullptr))
+	{
+		return;
+	}
+
+	// remember how the destination moves, SkipTeleportSearch continues that motion
+	auto Now = World->GetTimeSeconds();
+	if (bDestinationFound && bLastTeleportDestinationFound && (Now > LastTeleportDestinationTime))
+	{
+		TeleportDestinationVelocity = (Location - LastTeleportDestination) / (Now - LastTeleportDestinationTime);
+	}
+	else
+	{
+		TeleportDestinationVelocity = FVector::ZeroVector;
+	}
+	bLastTeleportDestinationFound = bDestinationFound;
+	LastTeleportDestination = Location;
+	LastTeleportDestinationTime = Now;
+
+	// the arc follows the destination marker
+	UpdateTeleportArc(bDestinationFound);
+
+	// a marker that stays put is where we are likely going
+	UpdateTeleportPrefetchDwell(bDestinationFound, Location);
+
 	// if successful, move DestinationMarker to where linetrace hit projected to navigation mesh and unhide it
-	if (bFindTeleportDestination(Location))
+	if (bDestinationFound)
 	{
 		//UE_LOG(LogTemp, Warning, TEXT("AVRCharacter::MoveDestinationMarkerByLineTrace() target found at %s"), *(NavLocation.ToString()));
 		DestinationMarker->SetWorldLocation(Location);
@@ -178,6 +778,29 @@ void AVRCharacter::MoveDestinationMarkerByLineTrace()
 }
 
 bool AVRCharacter::bProjectTeleportToNavigation(FVector &OutLocation, FVector InLocation)
+{
+	// what the baked index finds is on the navigation mesh, but it may miss surfaces smaller than a cell
+	if (bTeleportSurfaceIndexValid && (TeleportSurfaceIndex != nullptr) && TeleportSurfaceIndex->bFindSurface(InLocation, TeleportProjectionExtent, OutLocation, TeleportSurfaceValidity.Get()))
+	{
+		return true;
+	}
+
+	return bProjectTeleportToNavMesh(OutLocation, InLocation);
+}
+
+bool AVRCharacter::bProjectTeleportToNavMesh(FVector &OutLocation, const FVector &InLocation)
+{
+	// most of the time we hit the same polygon as last frame, which needs no navigation query
+	if (bReuseTeleportNavPoly && bProjectToCachedNavPoly(OutLocation, InLocation))
+	{
+		TeleportNavPolyReuses++;
+		return true;
+	}
+
+	return bProjectTeleportWithNavigationSystem(OutLocation, InLocation);
+}
+
+bool AVRCharacter::bProjectTeleportWithNavigationSystem(FVector &OutLocation, const FVector &InLocation)
 {
 	auto World = GetWorld();
 
@@ -196,8 +819,199 @@ bool AVRCharacter::bProjectTeleportToNavigation(FVector &OutLocation, FVector In
 	FNavLocation OutNavLocation;
 
 	auto bNavLocationFound = NavigationSystem->ProjectPointToNavigation(InLocation, OutNavLocation, TeleportProjectionExtent);
+	CharacterStats.AddNavQueries(1);
 
 	OutLocation = OutNavLocation.Location;
 
+	// remember the polygon we landed on for the next projection
+	if (bNavLocationFound && bReuseTeleportNavPoly && (OutNavLocation.NodeRef != CachedNavPolyRef))
+	{
+		CachedNavPolyRef = INVALID_NAVNODEREF;
+		CachedNavPolyVerts.Reset();
+
+		auto RecastNavMesh = Cast<ARecastNavMesh>(NavigationSystem->GetDefaultNavDataInstance());
+		if ((RecastNavMesh != nullptr) && RecastNavMesh->GetPolyVerts(OutNavLocation.NodeRef, CachedNavPolyVerts) && (CachedNavPolyVerts.Num() >= 3))
+		{
+			CachedNavPolyRef = OutNavLocation.NodeRef;
+		}
+		else
+		{
+			CachedNavPolyVerts.Reset();
+		}
+	}
+
 	return bNavLocationFound;
 }
+
+bool AVRCharacter::bProjectToCachedNavPoly(FVector &OutLocation, const FVector &InLocation) const
+{
+	if (CachedNavPolyRef == INVALID_NAVNODEREF)
+	{
+		return false;
+	}
+
+	float PolyZ;
+	if (!UTeleportSurfaceIndex::bProjectOntoPolygon(CachedNavPolyVerts, InLocation, PolyZ))
+	{
+		return false;
+	}
+
+	// same vertical reach as ProjectPointToNavigation, otherwise a hit on the floor above would snap down to us
+	if (FMath::Abs(InLocation.Z - PolyZ) > TeleportProjectionExtent.Z)
+	{
+		return false;
+	}
+
+	OutLocation = FVector(InLocation.X, InLocation.Y, PolyZ);
+	return true;
+}
+
+void AVRCharacter::SetupNavigationUpdates()
+{
+	auto NavigationSystem = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+	if (NavigationSystem != nullptr)
+	{
+		NavigationSystem->OnNavigationGenerationFinishedDelegate.AddUniqueDynamic(this, &AVRCharacter::OnNavigationGenerated);
+	}
+
+	NavigationUpdater = ATeleportNavigationUpdater::FindOrSpawn(GetWorld());
+}
+
+bool AVRCharacter::bInsideMovingArchitecture(const FVector &Location) const
+{
+	return (NavigationUpdater != nullptr) && NavigationUpdater->IsInsideMovingArchitecture(Location);
+}
+
+void AVRCharacter::OnNavigationGenerated(ANavigationData *NavData)
+{
+	InvalidateTeleportCaches();
+}
+
+void AVRCharacter::SetupTeleportSurfaceIndex()
+{
+	bTeleportSurfaceIndexValid = false;
+	TeleportSurfaceValidity.Reset();
+
+	auto World = GetWorld();
+
+	if (!bUseTeleportSurfaceIndex || (World == nullptr))
+	{
+		return;
+	}
+
+	// look for the bake of this map if none was assigned
+	if (TeleportSurfaceIndex == nullptr)
+	{
+		FString MapPackageName = UWorld::RemovePIEPrefix(World->GetOutermost()->GetName());
+		FString IndexPackageName = UTeleportSurfaceIndex::GetPackageNameForMap(MapPackageName);
+		FString IndexObjectPath = IndexPackageName + TEXT(".") + FPackageName::GetShortName(IndexPackageName);
+
+		TeleportSurfaceIndex = LoadObject<UTeleportSurfaceIndex>(nullptr, *IndexObjectPath, nullptr, LOAD_NoWarn | LOAD_Quiet);
+	}
+
+	if (TeleportSurfaceIndex == nullptr)
+	{
+		UE_LOG(LogTemp, Log, TEXT("AVRCharacter::SetupTeleportSurfaceIndex() no baked teleport surfaces, using the navigation system"));
+		return;
+	}
+}
+
+void AVRCharacter::UpdateTeleportSurfaceValidity()
+{
+	// the updater keeps the result until the navigation mesh changes, so this is a lookup most of the time
+	// (a search in flight holds on to the one it started with)
+	TeleportSurfaceValidity.Reset();
+	if (bUseTeleportSurfaceIndex && (TeleportSurfaceIndex != nullptr) && (NavigationUpdater != nullptr))
+	{
+		TeleportSurfaceValidity = NavigationUpdater->GetSurfaceValidity(TeleportSurfaceIndex);
+	}
+
+	bTeleportSurfaceIndexValid = TeleportSurfaceValidity.IsValid() && TeleportSurfaceValidity->bValid;
+}
+
+bool AVRCharacter::bLookupTeleportPoseCache(FTeleportSearchResult &OutResult, const FVector &ControllerLocation, const FVector &ControllerForward)
+{
+	if (!bUseTeleportPoseCache)
+	{
+		return false;
+	}
+
+	auto World = GetWorld();
+
+	if (!ensure(World != nullptr))
+	{
+		return false;
+	}
+
+	if (!TeleportPoseCache.bValid)
+	{
+		TeleportCacheMisses++;
+		return false;
+	}
+
+	if (World->GetTimeSeconds() - TeleportPoseCache.SearchTime > MaxTeleportCacheAge)
+	{
+		InvalidateTeleportCaches();
+		TeleportCacheMisses++;
+		return false;
+	}
+
+	bool bLocationClose = FVector::DistSquared(ControllerLocation, TeleportPoseCache.ControllerLocation) <= FMath::Square(TeleportCacheLocationTolerance);
+	bool bDirectionClose = FVector::DotProduct(ControllerForward, TeleportPoseCache.ControllerForward) >= FMath::Cos(FMath::DegreesToRadians(TeleportCacheAngleTolerance));
+
+	if (!bLocationClose || !bDirectionClose)
+	{
+		TeleportCacheMisses++;
+		return false;
+	}
+
+	TeleportCacheHits++;
+	OutResult = TeleportPoseCache.Result;
+	return true;
+}
+
+void AVRCharacter::StoreTeleportPoseCache(const FTeleportSearchResult &Result, const FVector &ControllerLocation, const FVector &ControllerForward)
+{
+	auto World = GetWorld();
+
+	if (!bUseTeleportPoseCache || (World == nullptr))
+	{
+		return;
+	}
+
+	TeleportPoseCache.bValid = true;
+	TeleportPoseCache.ControllerLocation = ControllerLocation;
+	TeleportPoseCache.ControllerForward = ControllerForward;
+	TeleportPoseCache.SearchTime = World->GetTimeSeconds();
+	TeleportPoseCache.Result = Result;
+}
+
+void AVRCharacter::InvalidateTeleportCaches()
+{
+	if (TeleportPoseCache.bValid)
+	{
+		TeleportCacheInvalidations++;
+	}
+
+	TeleportPoseCache = FTeleportPoseCache();
+
+	CachedNavPolyRef = INVALID_NAVNODEREF;
+	CachedNavPolyVerts.Reset();
+}
+
+void AVRCharacter::ResetTeleportCacheCounters()
+{
+	TeleportCacheHits = 0;
+	TeleportCacheMisses = 0;
+	TeleportCacheInvalidations = 0;
+	TeleportNavPolyReuses = 0;
+
+	TeleportFanSearches = 0;
+	TeleportFanHits = 0;
+	TeleportFanOverBudget = 0;
+	TeleportFanMilliseconds.Reset();
+
+	TeleportClearanceHits = 0;
+	TeleportClearanceMisses = 0;
+	TeleportClearanceInvalidations = 0;
+}
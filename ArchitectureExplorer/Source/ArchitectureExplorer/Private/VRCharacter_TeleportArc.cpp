@@ -0,0 +1,206 @@
+#include "VRCharacter.h"
+#include "Components/SplineMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "Materials/MaterialInterface.h"
+#include "MotionControllerComponent.h"
+#include "IMotionController.h"
+#include "Features/IModularFeatures.h"
+#include "GameFramework/WorldSettings.h"
+#include "Engine/World.h"
+
+void AVRCharacter::SetupTeleportArc()
+{
+	for (auto ArcMesh : TeleportArcMeshPool)
+	{
+		if (ArcMesh == nullptr)
+		{
+			continue;
+		}
+
+		// this is the only time the pool gets a new mesh or material,
+		// afterwards we only bend and hide the meshes
+		ArcMesh->SetForwardAxis(TeleportArcMeshAxis, false);
+		ArcMesh->SetStartScale(TeleportArcMeshScale, false);
+		ArcMesh->SetEndScale(TeleportArcMeshScale, false);
+		ArcMesh->SetStaticMesh(TeleportArcMesh);
+		if (TeleportArcMaterial != nullptr)
+		{
+			ArcMesh->SetMaterial(0, TeleportArcMaterial);
+		}
+		ArcMesh->SetVisibility(false);
+	}
+}
+
+void AVRCharacter::DrawTeleportArc(bool bShowArc, const FTeleportArcParams &Shape, float EndTime)
+{
+	if (!ensure(RightMotionControllerComponent != nullptr))
+	{
+		return;
+	}
+
+	// longer arcs use more meshes, the surplus is hidden
+	int32 NumPieces = 0;
+	if (bShowArc && (TeleportArcMesh != nullptr) && (EndTime > 0.0f))
+	{
+		NumPieces = FMath::Clamp(FMath::CeilToInt(EndTime / TeleportArcPieceTime), 1, TeleportArcMeshPool.Num());
+	}
+
+	float PieceTime = (NumPieces > 0) ? (EndTime / NumPieces) : 0.0f;
+
+	// the meshes are attached to the controller, so bring the world space arc into controller space
+	const auto &ControllerTransform = RightMotionControllerComponent->GetComponentTransform();
+
+	for (int32 Index = 0; Index < TeleportArcMeshPool.Num(); Index++)
+	{
+		auto ArcMesh = TeleportArcMeshPool[Index];
+		if (ArcMesh == nullptr)
+		{
+			continue;
+		}
+
+		if (Index >= NumPieces)
+		{
+			ArcMesh->SetVisibility(false);
+			continue;
+		}
+
+		float PieceStartTime = Index * PieceTime;
+		float PieceEndTime = (Index + 1) * PieceTime;
+
+		// the tangents of a spline mesh are relative to the whole piece, so scale the velocity by its duration
+		FVector StartLocation = ControllerTransform.InverseTransformPosition(FTeleportArcTracer::GetArcLocation(Shape, PieceStartTime));
+		FVector EndLocation = ControllerTransform.InverseTransformPosition(FTeleportArcTracer::GetArcLocation(Shape, PieceEndTime));
+		FVector StartTangent = ControllerTransform.InverseTransformVector(FTeleportArcTracer::GetArcVelocity(Shape, PieceStartTime) * PieceTime);
+		FVector EndTangent = ControllerTransform.InverseTransformVector(FTeleportArcTracer::GetArcVelocity(Shape, PieceEndTime) * PieceTime);
+
+		// bending a spline mesh recreates its render state, so leave it alone if it would barely change
+		bool bChanged =
+			!ArcMesh->GetStartPosition().Equals(StartLocation, TeleportArcUpdateTolerance) ||
+			!ArcMesh->GetEndPosition().Equals(EndLocation, TeleportArcUpdateTolerance) ||
+			!ArcMesh->GetStartTangent().Equals(StartTangent, TeleportArcUpdateTolerance) ||
+			!ArcMesh->GetEndTangent().Equals(EndTangent, TeleportArcUpdateTolerance);
+
+		if (bChanged)
+		{
+			ArcMesh->SetStartAndEnd(StartLocation, StartTangent, EndLocation, EndTangent, true);
+		}
+
+		ArcMesh->SetVisibility(true);
+	}
+}
+
+bool AVRCharacter::bPollRightControllerPose(FTransform &OutPose) const
+{
+	auto World = GetWorld();
+	if ((World == nullptr) || (RightMotionControllerComponent == nullptr))
+	{
+		return false;
+	}
+
+	auto WorldSettings = World->GetWorldSettings();
+	auto WorldToMeters = (WorldSettings != nullptr) ? WorldSettings->WorldToMeters : 100.0f;
+
+	// same lookup as UMotionControllerComponent, the first device that tracks the hand wins
+	auto MotionControllers = IModularFeatures::Get().GetModularFeatureImplementations<IMotionController>(IMotionController::GetModularFeatureName());
+	for (auto MotionController : MotionControllers)
+	{
+		FRotator Orientation;
+		FVector Position;
+		if ((MotionController != nullptr) && MotionController->GetControllerOrientationAndPosition(RightMotionControllerComponent->PlayerIndex, RightMotionControllerComponent->MotionSource, Orientation, Position, WorldToMeters))
+		{
+			OutPose = FTransform(Orientation, Position, RightMotionControllerComponent->RelativeScale3D);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void AVRCharacter::LateLatchTeleportDestination()
+{
+	LastTeleportLateLatchDistance = 0.0f;
+
+	auto bWasLatched = bTeleportArcLatched;
+	bTeleportArcLatched = bLateLatchTeleportArc();
+
+	// frames without a search leave the meshes and maybe the marker alone, so take back last frame's latch ourselves
+	if (bWasLatched && !bTeleportArcLatched && (DestinationMarker != nullptr))
+	{
+		UpdateTeleportArc(DestinationMarker->IsVisible());
+		if (DestinationMarker->GetComponentLocation().Equals(LatchedMarkerLocation))
+		{
+			DestinationMarker->SetWorldLocation(LatchedMarkerLocation - LatchedMarkerCorrection);
+		}
+	}
+}
+
+bool AVRCharacter::bLateLatchTeleportArc()
+{
+	if (!bLateLatchTeleportDestination || bIsTeleportInProgress() || PoseReplay.IsPlaying() || bRemoteVRCharacter)
+	{
+		return false;
+	}
+
+	if (!ensure((DestinationMarker != nullptr) && (RightMotionControllerComponent != nullptr)))
+	{
+		return false;
+	}
+
+	if (!DestinationMarker->IsVisible() || (TeleportArcShapeEndTime <= 0.0f))
+	{
+		return false;
+	}
+
+	auto Parent = RightMotionControllerComponent->GetAttachParent();
+	FTransform LatePose;
+	if ((Parent == nullptr) || !bPollRightControllerPose(LatePose))
+	{
+		return false;
+	}
+
+	// the arc was launched from the early pose; carry a copy of it along into the late one
+	// (TeleportArcShape itself stays as traced, frames that reuse it must not latch it twice)
+	// (this works for the arcs of the teleport fan too, they are fixed relative to the controller)
+	const auto OldTransform = RightMotionControllerComponent->GetComponentTransform();
+	const auto NewTransform = LatePose * Parent->GetComponentTransform();
+
+	auto NewShape = TeleportArcShape;
+	NewShape.Start = NewTransform.TransformPosition(OldTransform.InverseTransformPosition(TeleportArcShape.Start));
+	NewShape.LaunchVelocity = NewTransform.TransformVector(OldTransform.InverseTransformVector(TeleportArcShape.LaunchVelocity));
+
+	// land at the height of the traced hit, a small turn of the wrist keeps you on the same floor
+	auto OldHit = FTeleportArcTracer::GetArcLocation(TeleportArcShape, TeleportArcShapeEndTime);
+	float NewEndTime = 0.0f;
+	if (!FTeleportArcTracer::bGetArcTimeAtHeight(NewShape, OldHit.Z, NewEndTime))
+	{
+		return false;
+	}
+
+	auto Correction = FTeleportArcTracer::GetArcLocation(NewShape, NewEndTime) - OldHit;
+	Correction.Z = 0.0f;
+
+	auto Distance = Correction.Size();
+	if (Distance > MaxTeleportLateLatchDistance)
+	{
+		return false;
+	}
+
+	// the controller goes to the late pose as well, so the render thread late update only adds what happens after now
+	RightMotionControllerComponent->SetRelativeTransform(LatePose);
+
+	DrawTeleportArc(true, NewShape, NewEndTime);
+
+	auto MarkerLocation = DestinationMarker->GetComponentLocation();
+	if (bTeleportArcLatched && MarkerLocation.Equals(LatchedMarkerLocation))
+	{
+		MarkerLocation -= LatchedMarkerCorrection;
+	}
+	LatchedMarkerLocation = MarkerLocation + Correction;
+	LatchedMarkerCorrection = Correction;
+	DestinationMarker->SetWorldLocation(LatchedMarkerLocation);
+
+	LastTeleportLateLatchDistance = Distance;
+	SET_FLOAT_STAT(STAT_VRCharacter_LateLatchCorrection, Distance);
+	CSV_CUSTOM_STAT(VRCharacter, LateLatchCorrection, Distance, ECsvCustomStatOp::Set);
+	return true;
+}
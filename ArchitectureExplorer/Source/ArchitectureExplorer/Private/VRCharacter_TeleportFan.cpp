@@ -0,0 +1,215 @@
+#include "VRCharacter.h"
+#include "Components/CapsuleComponent.h"
+#include "Engine/World.h"
+#include "HAL/PlatformTime.h"
+
+namespace
+{
+	// the clearance test capsule is this much smaller than ours, so touching a wall is not blocked
+	const float ClearanceSkin = 1.0f; // centimeters
+}
+
+bool AVRCharacter::bSearchTeleportFan(const FTeleportArcParams &IntendedArc, bool bIntendedHit, const FVector &IntendedHit, FVector &OutLocation)
+{
+	SCOPE_CYCLE_COUNTER(STAT_VRCharacter_TeleportFan);
+
+	auto World = GetWorld();
+
+	if (!ensure(World != nullptr) || (TeleportFanSize <= 0))
+	{
+		return false;
+	}
+
+	auto StartCycles = FPlatformTime::Cycles64();
+	auto BudgetCycles = (uint64)(TeleportFanBudget / (1000.0 * FPlatformTime::GetSecondsPerCycle64()));
+
+	TeleportFanSearches++;
+
+	// only allocates if TeleportFanSize changed since SetupTeleportScratch
+	if (TeleportFanCandidates.Num() != TeleportFanSize)
+	{
+		TeleportFanCandidates.SetNum(TeleportFanSize);
+		TeleportFanTracers.SetNum(TeleportFanSize);
+	}
+
+	// the candidates launch at the same speed, TeleportFanAngle away from the intended direction
+	auto Speed = IntendedArc.LaunchVelocity.Size();
+	auto Forward = IntendedArc.LaunchVelocity.GetSafeNormal();
+	if (Forward.IsNearlyZero())
+	{
+		return false;
+	}
+
+	auto Side = FVector::CrossProduct(Forward, FVector::UpVector).GetSafeNormal();
+	if (Side.IsNearlyZero())
+	{
+		// pointing straight up or down
+		FVector Unused;
+		Forward.FindBestAxisVectors(Side, Unused);
+	}
+	auto ConeEdge = Forward.RotateAngleAxis(TeleportFanAngle, Side);
+
+	for (int32 Index = 0; Index < TeleportFanSize; Index++)
+	{
+		auto &Candidate = TeleportFanCandidates[Index];
+		Candidate = FTeleportFanCandidate();
+		Candidate.Arc = IntendedArc;
+		Candidate.Arc.LaunchVelocity = Speed * ConeEdge.RotateAngleAxis(360.0f * Index / TeleportFanSize, Forward);
+	}
+
+	// all arcs at once, each with its own tracer; a candidate that starts after the budget ran out is skipped
+	// graph tasks come from the task graph's pool, unlike ParallelFor they don't allocate on every search
+	auto DeadlineCycles = StartCycles + BudgetCycles;
+
+	TeleportFanTasks.Reset();
+	for (int32 Index = 1; Index < TeleportFanCandidates.Num(); Index++)
+	{
+		TeleportFanTasks.Add(FTeleportFanTraceTask::Dispatch(TeleportFanCandidates[Index], TeleportFanTracers[Index], World, TeleportQueryParams, DeadlineCycles));
+	}
+
+	// the game thread would only wait otherwise
+	TeleportFanCandidates[0].Trace(World, TeleportQueryParams, TeleportFanTracers[0], DeadlineCycles);
+
+	FTaskGraphInterface::Get().WaitUntilTasksComplete(TeleportFanTasks, ENamedThreads::GameThread);
+	TeleportFanTasks.Reset();
+
+	// what the player meant: the wall the arc hit, or where the arc would have been when the candidate came down
+	int32 NumQueries = 0;
+	bool bOverBudget = false;
+	for (auto &Candidate : TeleportFanCandidates)
+	{
+		NumQueries += Candidate.NumQueries;
+		bOverBudget |= Candidate.bSkipped;
+
+		if (Candidate.bHit)
+		{
+			auto Intended = bIntendedHit ? IntendedHit : FTeleportArcTracer::GetArcLocation(IntendedArc, Candidate.HitTime);
+			Candidate.Distance = FVector::Dist(Candidate.HitLocation, Intended);
+		}
+	}
+
+	// closest first, so the budget cuts off the least promising ones
+	TeleportFanCandidates.Sort([](const FTeleportFanCandidate &A, const FTeleportFanCandidate &B)
+	{
+		return (A.bHit != B.bHit) ? A.bHit : (A.Distance < B.Distance);
+	});
+
+	int32 BestIndex = INDEX_NONE;
+	float BestScore = 0.0f;
+	FVector BestLocation = FVector::ZeroVector;
+
+	for (int32 Index = 0; Index < TeleportFanCandidates.Num(); Index++)
+	{
+		const auto &Candidate = TeleportFanCandidates[Index];
+
+		// hits are sorted first
+		if (!Candidate.bHit)
+		{
+			break;
+		}
+
+		// the projection moves the hit by a few centimeters at most, no one further away can win
+		if ((BestIndex != INDEX_NONE) && (Candidate.Distance >= BestScore + TeleportProjectionExtent.Size()))
+		{
+			break;
+		}
+
+		if (FPlatformTime::Cycles64() - StartCycles > BudgetCycles)
+		{
+			bOverBudget = true;
+			break;
+		}
+
+		// navigation system queries only on the game thread, one candidate at a time
+		FVector Location;
+		if (!bProjectTeleportToNavigation(Location, Candidate.HitLocation) || bInsideMovingArchitecture(Location))
+		{
+			continue;
+		}
+
+		auto Intended = bIntendedHit ? IntendedHit : FTeleportArcTracer::GetArcLocation(IntendedArc, Candidate.HitTime);
+		auto Score = FVector::Dist(Location, Intended);
+
+		// only worth a clearance test if it could still win
+		if ((BestIndex == INDEX_NONE) || (Score < BestScore))
+		{
+			if (!bHasTeleportClearance(Location))
+			{
+				// we never go where we don't fit if the clearance is validated anyway
+				if (bValidateTeleportClearance)
+				{
+					continue;
+				}
+				Score += TeleportFanBlockedPenalty;
+			}
+		}
+
+		if ((BestIndex == INDEX_NONE) || (Score < BestScore))
+		{
+			BestIndex = Index;
+			BestScore = Score;
+			BestLocation = Location;
+		}
+	}
+
+	CharacterStats.AddPhysicsQueries(NumQueries);
+
+	if (bOverBudget)
+	{
+		TeleportFanOverBudget++;
+	}
+
+	auto Milliseconds = (float)FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+	TeleportFanMilliseconds.Add(Milliseconds);
+	CSV_CUSTOM_STAT(VRCharacter, TeleportFanMs, Milliseconds, ECsvCustomStatOp::Set);
+
+	if (BestIndex == INDEX_NONE)
+	{
+		return false;
+	}
+
+	TeleportFanHits++;
+
+	// the arc leads to where we go, not to where we point
+	TeleportArcShape = TeleportFanCandidates[BestIndex].Arc;
+	TeleportArcShapeEndTime = TeleportFanCandidates[BestIndex].HitTime;
+
+	OutLocation = BestLocation;
+	return true;
+}
+
+bool AVRCharacter::bHasTeleportClearance(const FVector &Location)
+{
+	auto CapsuleComponent = GetCapsuleComponent();
+
+	if (CapsuleComponent == nullptr)
+	{
+		return true;
+	}
+
+	FTeleportClearanceParams Params;
+	Params.Radius = CapsuleComponent->GetScaledCapsuleRadius() - ClearanceSkin;
+	Params.HalfHeight = CapsuleComponent->GetScaledCapsuleHalfHeight() - ClearanceSkin;
+	Params.TraceChannel = CapsuleComponent->GetCollisionObjectType();
+	Params.CellSize = TeleportClearanceCellSize;
+	Params.WatchDistance = TeleportClearanceWatchDistance;
+	Params.MaxAge = MaxTeleportClearanceAge;
+
+	auto InvalidationsBefore = TeleportClearanceCache.GetNumInvalidations();
+
+	bool bFromCache = false;
+	auto bClear = TeleportClearanceCache.bHasClearance(GetWorld(), Params, TeleportQueryParams, Location, bFromCache);
+	CharacterStats.AddPhysicsQueries(TeleportClearanceCache.GetNumQueries());
+
+	if (bFromCache)
+	{
+		TeleportClearanceHits++;
+	}
+	else
+	{
+		TeleportClearanceMisses++;
+	}
+	TeleportClearanceInvalidations += TeleportClearanceCache.GetNumInvalidations() - InvalidationsBefore;
+
+	return bClear;
+}
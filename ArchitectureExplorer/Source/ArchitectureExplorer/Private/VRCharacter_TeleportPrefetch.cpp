@@ -0,0 +1,223 @@
+#include "VRCharacter.h"
+#include "Engine/World.h"
+#include "Engine/LevelStreaming.h"
+#include "Engine/LevelStreamingVolume.h"
+#include "ContentStreaming.h"
+#include "UObject/Package.h"
+#include "UObject/UObjectGlobals.h"
+
+void AVRCharacter::UpdateTeleportPrefetchDwell(bool bDestinationFound, const FVector &Location)
+{
+	auto World = GetWorld();
+
+	if (!bPrefetchTeleportDestination || (World == nullptr))
+	{
+		return;
+	}
+
+	auto Now = World->GetTimeSeconds();
+
+	// let go of a prefetch the user has long lost interest in, also while aiming at nothing or elsewhere
+	// while the marker still rests on it the user hasn't, so we keep it going instead of starting over
+	if (bPrefetchActive && (Now - PrefetchTime > PrefetchHoldTime) && !bIsTeleportInProgress())
+	{
+		if (bDestinationFound && (FVector::DistSquared(Location, PrefetchLocation) <= FMath::Square(PrefetchDwellRadius)))
+		{
+			PrefetchTime = Now;
+			IStreamingManager::Get().AddViewSlaveLocation(PrefetchLocation, 1.0f, false, PrefetchHoldTime);
+		}
+		else
+		{
+			ReleaseTeleportPrefetch();
+		}
+	}
+
+	// nothing to rest on
+	if (!bDestinationFound)
+	{
+		PrefetchDwellStartTime = Now;
+		PrefetchDwellLocation = FVector(BIG_NUMBER);
+		return;
+	}
+
+	// moved away, start counting again from here
+	if (FVector::DistSquared(Location, PrefetchDwellLocation) > FMath::Square(PrefetchDwellRadius))
+	{
+		PrefetchDwellLocation = Location;
+		PrefetchDwellStartTime = Now;
+		return;
+	}
+
+	if (Now - PrefetchDwellStartTime >= PrefetchDwellTime)
+	{
+		StartTeleportPrefetch(PrefetchDwellLocation);
+	}
+}
+
+void AVRCharacter::StartTeleportPrefetch(const FVector &Location)
+{
+	auto World = GetWorld();
+
+	if (!bPrefetchTeleportDestination || (World == nullptr))
+	{
+		return;
+	}
+
+	// already on it
+	if (bPrefetchActive && (FVector::DistSquared(Location, PrefetchLocation) <= FMath::Square(PrefetchDwellRadius)))
+	{
+		return;
+	}
+
+	bPrefetchActive = true;
+	PrefetchLocation = Location;
+	PrefetchTime = World->GetTimeSeconds();
+
+	// the texture streamer streams mips for the destination as if a second camera stood there
+	IStreamingManager::Get().AddViewSlaveLocation(Location, 1.0f, false, PrefetchHoldTime);
+
+	// a nearby new location mostly shares its levels with the old one, those keep their requests
+	TArray<TWeakObjectPtr<ULevelStreaming>, TInlineAllocator<16>> Levels;
+
+	// levels are found through their streaming volumes; unloaded levels have no bounds we could test
+	for (auto StreamingLevel : World->GetStreamingLevels())
+	{
+		if ((StreamingLevel == nullptr) || (StreamingLevel->GetLoadedLevel() != nullptr))
+		{
+			continue;
+		}
+
+		bool bNearDestination = false;
+		for (auto Volume : StreamingLevel->EditorStreamingVolumes)
+		{
+			if ((Volume != nullptr) && Volume->EncompassesPoint(Location, PrefetchLevelRadius))
+			{
+				bNearDestination = true;
+				break;
+			}
+		}
+
+		if (!bNearDestination)
+		{
+			continue;
+		}
+
+		Levels.Add(StreamingLevel);
+
+		if (PrefetchLevels.Contains(StreamingLevel))
+		{
+			continue;
+		}
+
+		// in PIE the streamed levels are duplicated from the editor world, there is no package on disk to load ahead
+		if (World->IsPlayInEditor())
+		{
+			continue;
+		}
+
+		// loading the package is the slow part; when the level streaming asks for it, it is already in memory
+		// this doesn't touch bShouldBeLoaded, so it doesn't fight the streaming volumes
+		auto PackageName = StreamingLevel->GetWorldAssetPackageFName();
+		if (FindObject<UPackage>(nullptr, *PackageName.ToString()) == nullptr)
+		{
+			LoadPackageAsync(PackageName.ToString(), FLoadPackageAsyncDelegate::CreateUObject(this, &AVRCharacter::OnPrefetchPackageLoaded));
+			PrefetchPackageNames.AddUnique(PackageName);
+		}
+	}
+
+	// the levels we no longer go near don't need their packages any more
+	PrefetchLevels.Reset();
+	PrefetchLevels.Append(Levels);
+	PrefetchedPackages.RemoveAll([this](UPackage *Package) { return (Package == nullptr) || !bIsPrefetchLevelPackage(Package->GetFName()); });
+	PrefetchPackageNames.RemoveAll([this](const FName &PackageName) { return !bIsPrefetchLevelPackage(PackageName); });
+
+	UE_LOG(LogTemp, Verbose, TEXT("AVRCharacter::StartTeleportPrefetch() %d streaming levels around %s"), PrefetchLevels.Num(), *Location.ToString());
+}
+
+bool AVRCharacter::bIsPrefetchLevelPackage(const FName &PackageName) const
+{
+	for (const auto &StreamingLevel : PrefetchLevels)
+	{
+		if (StreamingLevel.IsValid() && (StreamingLevel->GetWorldAssetPackageFName() == PackageName))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void AVRCharacter::OnPrefetchPackageLoaded(const FName &PackageName, UPackage *LoadedPackage, EAsyncLoadingResult::Type Result)
+{
+	// the prefetch may have been released or moved away from this level meanwhile
+	if (!bPrefetchActive || (LoadedPackage == nullptr) || (Result != EAsyncLoadingResult::Succeeded) || !bIsPrefetchLevelPackage(PackageName))
+	{
+		return;
+	}
+
+	PrefetchedPackages.AddUnique(LoadedPackage);
+}
+
+void AVRCharacter::ReportTeleportPrefetch()
+{
+	LastTeleportPrefetchLevels = 0;
+	LastTeleportPrefetchLevelsReady = 0;
+	LastTeleportPrefetchCompletion = 100.0f;
+	LastTeleportPrefetchTexturesPending = IStreamingManager::Get().GetNumWantingResources();
+
+	float CompletionSum = 0.0f;
+
+	for (const auto &StreamingLevelPtr : PrefetchLevels)
+	{
+		auto StreamingLevel = StreamingLevelPtr.Get();
+		if (StreamingLevel == nullptr)
+		{
+			continue;
+		}
+
+		LastTeleportPrefetchLevels++;
+
+		auto PackageName = StreamingLevel->GetWorldAssetPackageFName();
+		auto Package = FindObject<UPackage>(nullptr, *PackageName.ToString());
+
+		if ((StreamingLevel->GetLoadedLevel() != nullptr) || ((Package != nullptr) && Package->IsFullyLoaded()))
+		{
+			LastTeleportPrefetchLevelsReady++;
+			CompletionSum += 100.0f;
+		}
+		else
+		{
+			// negative if the package is not in the loading queue at all
+			CompletionSum += FMath::Max(GetAsyncLoadPercentage(PackageName), 0.0f);
+		}
+	}
+
+	if (LastTeleportPrefetchLevels > 0)
+	{
+		LastTeleportPrefetchCompletion = CompletionSum / LastTeleportPrefetchLevels;
+	}
+
+	SET_DWORD_STAT(STAT_VRCharacter_PrefetchLevels, LastTeleportPrefetchLevels);
+	SET_DWORD_STAT(STAT_VRCharacter_PrefetchLevelsReady, LastTeleportPrefetchLevelsReady);
+	SET_FLOAT_STAT(STAT_VRCharacter_PrefetchCompletion, LastTeleportPrefetchCompletion);
+	SET_DWORD_STAT(STAT_VRCharacter_PrefetchTexturesPending, LastTeleportPrefetchTexturesPending);
+	CSV_CUSTOM_STAT(VRCharacter, TeleportPrefetchCompletion, LastTeleportPrefetchCompletion, ECsvCustomStatOp::Set);
+
+	UE_LOG(LogTemp, Log, TEXT("AVRCharacter::ReportTeleportPrefetch() %d of %d levels ready (%.0f%% loaded), %d textures still streaming"),
+		LastTeleportPrefetchLevelsReady, LastTeleportPrefetchLevels, LastTeleportPrefetchCompletion, LastTeleportPrefetchTexturesPending);
+
+	// the level streaming picks the packages up once we are there, until then they stay referenced
+	// UpdateTeleportPrefetchDwell lets go of them after PrefetchHoldTime
+	auto World = GetWorld();
+	if (World != nullptr)
+	{
+		PrefetchTime = World->GetTimeSeconds();
+	}
+}
+
+void AVRCharacter::ReleaseTeleportPrefetch()
+{
+	bPrefetchActive = false;
+	PrefetchLevels.Reset();
+	PrefetchedPackages.Reset();
+	PrefetchPackageNames.Reset();
+}
@@ -0,0 +1,242 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "VRCrowdBenchmarkGameMode.h"
+#include "VRCharacter.h"
+#include "TeleportSearchBatch.h"
+#include "MotionControllerComponent.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/PlayerController.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "HAL/PlatformMisc.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonWriter.h"
+#include "Serialization/JsonSerializer.h"
+
+namespace
+{
+	// roughly where a right hand is relative to the VR root, same as the single character benchmark
+	const FVector ControllerLocation(30.0f, 20.0f, 0.0f);
+}
+
+AVRCrowdBenchmarkGameMode::AVRCrowdBenchmarkGameMode()
+{
+	// we move the controllers before the characters tick
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.TickGroup = TG_PrePhysics;
+
+	BenchmarkPawnClass = TSoftClassPtr<AVRCharacter>(FSoftObjectPath(TEXT("/Game/Blueprints/BP_VRCharacter.BP_VRCharacter_C")));
+}
+
+void AVRCrowdBenchmarkGameMode::InitGame(const FString &MapName, const FString &Options, FString &ErrorMessage)
+{
+	auto PawnClass = BenchmarkPawnClass.LoadSynchronous();
+	if (PawnClass != nullptr)
+	{
+		DefaultPawnClass = PawnClass;
+	}
+	else
+	{
+		UE_LOG(LogTemp, Warning, TEXT("AVRCrowdBenchmarkGameMode::InitGame() unable to load %s, benchmarking the plain AVRCharacter"), *BenchmarkPawnClass.ToString());
+		DefaultPawnClass = AVRCharacter::StaticClass();
+	}
+
+	Super::InitGame(MapName, Options, ErrorMessage);
+
+	OutputFilename = FPaths::ProjectSavedDir() / TEXT("Benchmarks") / TEXT("VRCrowd.json");
+	FParse::Value(FCommandLine::Get(), TEXT("VRBenchmarkOutput="), OutputFilename);
+
+	Results = MakeShared<FJsonObject>();
+	Results->SetStringField(TEXT("map"), MapName);
+	Results->SetNumberField(TEXT("framesPerStep"), FramesPerStep);
+	Results->SetObjectField(TEXT("perPawnTick"), MakeShared<FJsonObject>());
+	Results->SetObjectField(TEXT("batched"), MakeShared<FJsonObject>());
+}
+
+void AVRCrowdBenchmarkGameMode::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	if (bFinished)
+	{
+		return;
+	}
+
+	if ((StepFrame == 0) && !bSetupStep())
+	{
+		// the player's character is not there yet
+		return;
+	}
+
+	// what the searches of last frame cost
+	if (StepFrame > WarmupFrames)
+	{
+		SearchMilliseconds.Add(GetLastFrameSearchMilliseconds());
+	}
+
+	if (StepFrame == WarmupFrames + FramesPerStep)
+	{
+		RecordStep();
+
+		// per pawn tick first, then batched, then twice the pawns
+		StepFrame = 0;
+		bBatched = !bBatched;
+		if (!bBatched)
+		{
+			NumPawns *= 2;
+		}
+
+		if (NumPawns > MaxPawns)
+		{
+			FinishBenchmark();
+		}
+		return;
+	}
+
+	DriveControllers();
+	StepFrame++;
+}
+
+bool AVRCrowdBenchmarkGameMode::bSetupStep()
+{
+	auto World = GetWorld();
+	if (World == nullptr)
+	{
+		return false;
+	}
+
+	// the player's character comes first
+	if (Pawns.Num() == 0)
+	{
+		auto PlayerController = World->GetFirstPlayerController();
+		auto PlayerCharacter = (PlayerController != nullptr) ? Cast<AVRCharacter>(PlayerController->GetPawn()) : nullptr;
+		if (PlayerCharacter == nullptr)
+		{
+			return false;
+		}
+		Pawns.Add(PlayerCharacter);
+	}
+
+	// the others stand around it in a square grid
+	const int32 GridSize = FMath::CeilToInt(FMath::Sqrt((float)FMath::Max(MaxPawns, 1)));
+	const FVector Origin = Pawns[0]->GetActorLocation();
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+
+	while (Pawns.Num() < NumPawns)
+	{
+		int32 Index = Pawns.Num();
+		FVector Offset(PawnSpacing * (Index % GridSize - GridSize / 2), PawnSpacing * (Index / GridSize - GridSize / 2), 0.0f);
+
+		auto Pawn = World->SpawnActor<AVRCharacter>(DefaultPawnClass, Origin + Offset, Pawns[0]->GetActorRotation(), SpawnParameters);
+		if (Pawn == nullptr)
+		{
+			UE_LOG(LogTemp, Error, TEXT("AVRCrowdBenchmarkGameMode::bSetupStep() unable to spawn character %d"), Index);
+			break;
+		}
+		Pawns.Add(Pawn);
+	}
+
+	for (int32 Index = 0; Index < Pawns.Num(); Index++)
+	{
+		auto Pawn = Pawns[Index];
+		if (Pawn == nullptr)
+		{
+			continue;
+		}
+
+		// characters beyond this step's count stand still and don't search
+		bool bActive = Index < NumPawns;
+		Pawn->SetActorTickEnabled(bActive);
+
+		Pawn->AddTickPrerequisiteActor(this);
+		Pawn->SetFrameBudgetEnabled(false);
+		Pawn->SetTeleportSearchMode(bBatched ? ETeleportSearchMode::Batch : ETeleportSearchMode::CharacterTick);
+	}
+
+	SearchMilliseconds.Reset();
+	return true;
+}
+
+void AVRCrowdBenchmarkGameMode::DriveControllers()
+{
+	float Alpha = (float)StepFrame / FMath::Max(WarmupFrames + FramesPerStep, 1);
+
+	for (int32 Index = 0; Index < FMath::Min(NumPawns, Pawns.Num()); Index++)
+	{
+		auto RightController = (Pawns[Index] != nullptr) ? Pawns[Index]->GetRightMotionController() : nullptr;
+		if (RightController == nullptr)
+		{
+			continue;
+		}
+
+		// same sweep as the SweepArcs scenario, every character out of phase with the others
+		float Phase = 0.137f * Index;
+		FRotator Aim(-10.0f + 25.0f * FMath::Sin(2.0f * PI * (3.0f * Alpha + Phase)), 90.0f * FMath::Sin(2.0f * PI * (2.0f * Alpha + Phase)), 0.0f);
+		RightController->SetRelativeLocationAndRotation(ControllerLocation, Aim);
+	}
+}
+
+float AVRCrowdBenchmarkGameMode::GetLastFrameSearchMilliseconds() const
+{
+	if (bBatched)
+	{
+		// the batch runs the searches in parallel, what counts is how long the game thread waited
+		for (TActorIterator<ATeleportSearchBatch> It(GetWorld()); It; ++It)
+		{
+			return It->GetLastBatchMilliseconds();
+		}
+		return 0.0f;
+	}
+
+	// every character searched in its own tick, one after the other
+	float Milliseconds = 0.0f;
+	for (int32 Index = 0; Index < FMath::Min(NumPawns, Pawns.Num()); Index++)
+	{
+		if (Pawns[Index] != nullptr)
+		{
+			Milliseconds += Pawns[Index]->GetCharacterStats().GetLastFrameMilliseconds(EVRCharacterStage::MoveDestinationMarkerByLineTrace);
+		}
+	}
+	return Milliseconds;
+}
+
+void AVRCrowdBenchmarkGameMode::RecordStep()
+{
+	float Min = 0.0f, Average = 0.0f, P99 = 0.0f;
+	SearchMilliseconds.bGetSummary(Min, Average, P99);
+
+	TSharedRef<FJsonObject> Summary = MakeShared<FJsonObject>();
+	Summary->SetNumberField(TEXT("min"), Min);
+	Summary->SetNumberField(TEXT("avg"), Average);
+	Summary->SetNumberField(TEXT("p99"), P99);
+	Summary->SetNumberField(TEXT("avgPerPawn"), Average / FMath::Max(NumPawns, 1));
+
+	Results->GetObjectField(bBatched ? TEXT("batched") : TEXT("perPawnTick"))->SetObjectField(FString::FromInt(NumPawns), Summary);
+
+	UE_LOG(LogTemp, Display, TEXT("AVRCrowdBenchmarkGameMode::RecordStep() %3d pawns %-11s min %8.3f  avg %8.3f  p99 %8.3f ms"),
+		NumPawns, bBatched ? TEXT("batched") : TEXT("per pawn"), Min, Average, P99);
+}
+
+void AVRCrowdBenchmarkGameMode::FinishBenchmark()
+{
+	bFinished = true;
+
+	FString Json;
+	auto Writer = TJsonWriterFactory<>::Create(&Json);
+	FJsonSerializer::Serialize(Results.ToSharedRef(), Writer);
+
+	if (FFileHelper::SaveStringToFile(Json, *OutputFilename))
+	{
+		UE_LOG(LogTemp, Display, TEXT("AVRCrowdBenchmarkGameMode::FinishBenchmark() results written to %s"), *OutputFilename);
+	}
+	else
+	{
+		UE_LOG(LogTemp, Error, TEXT("AVRCrowdBenchmarkGameMode::FinishBenchmark() unable to write %s"), *OutputFilename);
+	}
+
+	FPlatformMisc::RequestExit(false);
+}
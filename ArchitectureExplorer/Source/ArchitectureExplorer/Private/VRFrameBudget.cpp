@@ -0,0 +1,127 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "VRFrameBudget.h"
+
+namespace
+{
+	// weight of the newest sample in the moving averages, about 10 frames of memory
+	const float SmoothingFactor = 0.1f;
+
+	const TCHAR *LevelNames[] =
+	{
+		TEXT("Full"),
+		TEXT("ReducedBlinker"),
+		TEXT("ReducedTrace"),
+		TEXT("Minimal"),
+	};
+	static_assert(ARRAY_COUNT(LevelNames) == (int32)EVRDegradationLevel::Count, "every degradation level needs a name");
+}
+
+const TCHAR *FVRFrameBudget::GetLevelName(EVRDegradationLevel InLevel)
+{
+	return LevelNames[FMath::Clamp((int32)InLevel, 0, (int32)EVRDegradationLevel::Count - 1)];
+}
+
+void FVRFrameBudget::BeginFrame(const FVRFrameBudgetSettings &Settings, const FVRCharacterStats &Stats)
+{
+	FrameNumber++;
+
+	// learn what the stages cost from the frames they actually ran
+	float FullCost = 0.0f;
+	float LastFrameCost = 0.0f;
+	for (int32 Stage = 0; Stage < (int32)EVRCharacterStage::Count; Stage++)
+	{
+		float Milliseconds = Stats.GetLastFrameMilliseconds((EVRCharacterStage)Stage);
+		LastFrameCost += Milliseconds;
+
+		if (bStageRan[Stage])
+		{
+			StageCost[Stage] = FMath::Lerp(StageCost[Stage], Milliseconds, SmoothingFactor);
+		}
+		bStageRan[Stage] = false;
+
+		FullCost += StageCost[Stage];
+	}
+
+	if (!Settings.bEnabled)
+	{
+		Level = EVRDegradationLevel::Full;
+		FramesOverBudget = 0;
+		FramesWithRoom = 0;
+	}
+	else
+	{
+		// over budget is judged by what we spent, recovery by what the full workload would cost
+		// otherwise the savings of a lower level would immediately talk us back up
+		const bool bOverBudget = LastFrameCost > Settings.CharacterBudget;
+		const bool bRoomForFull = FullCost <= Settings.CharacterBudget;
+
+		FramesOverBudget = bOverBudget ? FramesOverBudget + 1 : 0;
+		FramesWithRoom = bRoomForFull ? FramesWithRoom + 1 : 0;
+
+		if ((FramesOverBudget >= Settings.FramesToDegrade) && (Level < EVRDegradationLevel::Minimal))
+		{
+			Level = (EVRDegradationLevel)((int32)Level + 1);
+			FramesOverBudget = 0;
+			FramesWithRoom = 0;
+		}
+		else if ((FramesWithRoom >= Settings.FramesToRecover) && (Level > EVRDegradationLevel::Full))
+		{
+			Level = (EVRDegradationLevel)((int32)Level - 1);
+			FramesOverBudget = 0;
+			FramesWithRoom = 0;
+		}
+	}
+
+	switch (Level)
+	{
+	case EVRDegradationLevel::ReducedTrace:
+		TraceInterval = FMath::Max(Settings.TraceInterval, 1);
+		break;
+	case EVRDegradationLevel::Minimal:
+		TraceInterval = FMath::Max(Settings.MinimalTraceInterval, 1);
+		break;
+	default:
+		TraceInterval = 1;
+		break;
+	}
+
+	SET_DWORD_STAT(STAT_VRCharacter_DegradationLevel, (uint32)Level);
+	CSV_CUSTOM_STAT(VRCharacter, DegradationLevel, (int32)Level, ECsvCustomStatOp::Set);
+}
+
+bool FVRFrameBudget::bShouldRun(EVRCharacterStage Stage)
+{
+	bool bRun = true;
+
+	switch (Stage)
+	{
+	case EVRCharacterStage::MoveDestinationMarkerByLineTrace:
+		bRun = (FrameNumber % TraceInterval) == 0;
+		break;
+
+	case EVRCharacterStage::UpdateBlinkerCenter:
+		bRun = (Level < EVRDegradationLevel::ReducedBlinker) || (FrameNumber % 2 == 0);
+		break;
+
+	case EVRCharacterStage::UpdateBlinkerRadius:
+		// odd frames, so it does not pile up on the frames the blinker center runs
+		bRun = (Level < EVRDegradationLevel::Minimal) || (FrameNumber % 2 == 1);
+		break;
+
+	case EVRCharacterStage::MovePawnToVRCamera:
+	default:
+		break;
+	}
+
+	if (bRun)
+	{
+		bStageRan[(int32)Stage] = true;
+	}
+	else
+	{
+		INC_DWORD_STAT(STAT_VRCharacter_SkippedStages);
+	}
+
+	return bRun;
+}
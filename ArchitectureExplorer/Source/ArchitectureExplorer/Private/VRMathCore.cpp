@@ -0,0 +1,196 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "VRMathCore.h"
+#include <cmath>
+
+namespace VRMathCore
+{
+	// in VRMathCore, so a unity build doesn't mix these up with the engine side helpers of other files
+	namespace
+	{
+		// same tolerances as the engine's GetSafeNormal and IsNearlyZero
+		const float SmallNumber = 1.e-8f;
+		const float KindaSmallNumber = 1.e-4f;
+
+		// the blinker aims at a point this far along the direction of movement
+		const float BlinkerTargetDistance = 1000.0f; // centimeters
+
+		float Dot(const FVec3 &A, const FVec3 &B)
+		{
+			return A.X * B.X + A.Y * B.Y + A.Z * B.Z;
+		}
+
+		FVec3 GetSafeNormal(const FVec3 &Vector)
+		{
+			const float SizeSquared = Dot(Vector, Vector);
+			if (SizeSquared < SmallNumber)
+			{
+				return FVec3{ 0.0f, 0.0f, 0.0f };
+			}
+
+			const float Scale = 1.0f / std::sqrt(SizeSquared);
+			return FVec3{ Vector.X * Scale, Vector.Y * Scale, Vector.Z * Scale };
+		}
+
+		float Clamp(float Value, float Min, float Max)
+		{
+			return (Value < Min) ? Min : ((Value > Max) ? Max : Value);
+		}
+	}
+
+	FVec3 GetArcLocation(const FArcParams &Params, float Time)
+	{
+		const float Fall = 0.5f * Params.GravityZ * Time * Time;
+		return FVec3{
+			Params.Start.X + Params.LaunchVelocity.X * Time,
+			Params.Start.Y + Params.LaunchVelocity.Y * Time,
+			Params.Start.Z + Params.LaunchVelocity.Z * Time + Fall };
+	}
+
+	FVec3 GetArcVelocity(const FArcParams &Params, float Time)
+	{
+		return FVec3{ Params.LaunchVelocity.X, Params.LaunchVelocity.Y, Params.LaunchVelocity.Z + Params.GravityZ * Time };
+	}
+
+	bool bGetArcTimeAtHeight(const FArcParams &Params, float Z, float MaxTime, float &OutTime)
+	{
+		// 0.5 g t^2 + vz t + (z0 - z) = 0, the later root is on the way down
+		const float A = 0.5f * Params.GravityZ;
+		const float B = Params.LaunchVelocity.Z;
+		const float C = Params.Start.Z - Z;
+
+		if (A >= 0.0f)
+		{
+			return false;
+		}
+
+		const float Discriminant = B * B - 4.0f * A * C;
+		if (Discriminant < 0.0f)
+		{
+			return false;
+		}
+
+		OutTime = (-B - std::sqrt(Discriminant)) / (2.0f * A);
+		return (OutTime > 0.0f) && (OutTime <= MaxTime);
+	}
+
+	float GetGravityAcross(float GravityZ, const FVec3 &Velocity)
+	{
+		const FVec3 Direction = GetSafeNormal(Velocity);
+		const FVec3 Gravity{ 0.0f, 0.0f, GravityZ };
+		const float Along = Dot(Gravity, Direction);
+		const FVec3 Across{ Gravity.X - Along * Direction.X, Gravity.Y - Along * Direction.Y, Gravity.Z - Along * Direction.Z };
+		return std::sqrt(Dot(Across, Across));
+	}
+
+	float GetSegmentTime(float GravityAcross, float MaxDeviation, float MinTime, float MaxTime)
+	{
+		if (MaxDeviation <= 0.0f)
+		{
+			return MinTime;
+		}
+
+		if (GravityAcross <= KindaSmallNumber)
+		{
+			return MaxTime;
+		}
+
+		return Clamp(std::sqrt(8.0f * MaxDeviation / GravityAcross), MinTime, MaxTime);
+	}
+
+	void GetArcLocations(const FArcParams &Params, const float *Times, int32_t Count, float *OutX, float *OutY, float *OutZ)
+	{
+		const float HalfGravityZ = 0.5f * Params.GravityZ;
+
+		for (int32_t Index = 0; Index < Count; Index++)
+		{
+			const float Time = Times[Index];
+			OutX[Index] = Params.Start.X + Params.LaunchVelocity.X * Time;
+			OutY[Index] = Params.Start.Y + Params.LaunchVelocity.Y * Time;
+			OutZ[Index] = Params.Start.Z + (Params.LaunchVelocity.Z + HalfGravityZ * Time) * Time;
+		}
+	}
+
+	bool bProject(const FMat4 &ViewProjection, const FVec3 &Location, FVec2 &OutScreen)
+	{
+		const auto &M = ViewProjection.M;
+
+		const float W = Location.X * M[0][3] + Location.Y * M[1][3] + Location.Z * M[2][3] + M[3][3];
+		if (W <= 0.0f)
+		{
+			return false;
+		}
+
+		const float X = Location.X * M[0][0] + Location.Y * M[1][0] + Location.Z * M[2][0] + M[3][0];
+		const float Y = Location.X * M[0][1] + Location.Y * M[1][1] + Location.Z * M[2][1] + M[3][1];
+
+		const float RHW = 1.0f / W;
+		OutScreen.X = 0.5f + 0.5f * X * RHW;
+		OutScreen.Y = 0.5f - 0.5f * Y * RHW;
+		return true;
+	}
+
+	int32_t Project(const FMat4 &ViewProjection, const FVec3 *Locations, int32_t Count, FVec2 *OutScreen, uint8_t *OutInFront)
+	{
+		// in locals, otherwise the compiler has to assume the writes to OutScreen change the matrix
+		const auto &M = ViewProjection.M;
+		const float M00 = M[0][0], M10 = M[1][0], M20 = M[2][0], M30 = M[3][0];
+		const float M01 = M[0][1], M11 = M[1][1], M21 = M[2][1], M31 = M[3][1];
+		const float M03 = M[0][3], M13 = M[1][3], M23 = M[2][3], M33 = M[3][3];
+
+		int32_t NumInFront = 0;
+		for (int32_t Index = 0; Index < Count; Index++)
+		{
+			const FVec3 &Location = Locations[Index];
+
+			const float X = Location.X * M00 + Location.Y * M10 + Location.Z * M20 + M30;
+			const float Y = Location.X * M01 + Location.Y * M11 + Location.Z * M21 + M31;
+			const float W = Location.X * M03 + Location.Y * M13 + Location.Z * M23 + M33;
+
+			// behind the view projects to the center; arithmetic instead of branches keeps the loop vectorizable
+			const float InFront = (float)(W > 0.0f);
+			const float RHW = InFront / (W * InFront + (1.0f - InFront));
+			OutScreen[Index].X = 0.5f + 0.5f * X * RHW;
+			OutScreen[Index].Y = 0.5f - 0.5f * Y * RHW;
+
+			NumInFront += (int32_t)InFront;
+		}
+
+		// a second pass, so the first one has no branch on OutInFront
+		if (OutInFront != nullptr)
+		{
+			for (int32_t Index = 0; Index < Count; Index++)
+			{
+				const FVec3 &Location = Locations[Index];
+				OutInFront[Index] = (Location.X * M03 + Location.Y * M13 + Location.Z * M23 + M33 > 0.0f) ? 1 : 0;
+			}
+		}
+
+		return NumInFront;
+	}
+
+	bool bGetBlinkerCenter(const FMat4 &ViewProjection, const FVec3 &CameraLocation, const FVec3 &CameraForward, const FVec3 &Velocity, FVec2 &OutCenter)
+	{
+		const FVec3 Direction = GetSafeNormal(Velocity);
+		if ((std::fabs(Direction.X) <= KindaSmallNumber) && (std::fabs(Direction.Y) <= KindaSmallNumber) && (std::fabs(Direction.Z) <= KindaSmallNumber))
+		{
+			return false;
+		}
+
+		// moving backwards, look behind us so the point is still in front of the camera
+		const float Distance = (Dot(CameraForward, Direction) > 0.0f) ? BlinkerTargetDistance : -BlinkerTargetDistance;
+		const FVec3 Target{ CameraLocation.X + Distance * Direction.X, CameraLocation.Y + Distance * Direction.Y, CameraLocation.Z + Distance * Direction.Z };
+
+		return bProject(ViewProjection, Target, OutCenter);
+	}
+
+	FVec3 GetPlaySpaceDelta(const FVec3 &CameraLocation, const FVec3 &ActorLocation)
+	{
+		return FVec3{ CameraLocation.X - ActorLocation.X, CameraLocation.Y - ActorLocation.Y, 0.0f };
+	}
+
+	bool bIsInDeadZone(const FVec3 &Delta, float DeadZone)
+	{
+		return Dot(Delta, Delta) < DeadZone * DeadZone;
+	}
+}
@@ -0,0 +1,191 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "VRNetBenchmarkGameMode.h"
+#include "VRCharacter.h"
+#include "Engine/World.h"
+#include "Engine/NetDriver.h"
+#include "Engine/NetConnection.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "HAL/PlatformMisc.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonWriter.h"
+#include "Serialization/JsonSerializer.h"
+
+namespace
+{
+	TSharedRef<FJsonObject> MakeSummary(const FVRStatHistory &History)
+	{
+		float Min = 0.0f, Average = 0.0f, P99 = 0.0f;
+		History.bGetSummary(Min, Average, P99);
+
+		TSharedRef<FJsonObject> Summary = MakeShared<FJsonObject>();
+		Summary->SetNumberField(TEXT("min"), Min);
+		Summary->SetNumberField(TEXT("avg"), Average);
+		Summary->SetNumberField(TEXT("p99"), P99);
+		return Summary;
+	}
+}
+
+AVRNetBenchmarkGameMode::AVRNetBenchmarkGameMode()
+{
+	PrimaryActorTick.bCanEverTick = true;
+
+	BenchmarkPawnClass = TSoftClassPtr<AVRCharacter>(FSoftObjectPath(TEXT("/Game/Blueprints/BP_VRCharacter.BP_VRCharacter_C")));
+}
+
+void AVRNetBenchmarkGameMode::InitGame(const FString &MapName, const FString &Options, FString &ErrorMessage)
+{
+	auto PawnClass = BenchmarkPawnClass.LoadSynchronous();
+	if (PawnClass != nullptr)
+	{
+		DefaultPawnClass = PawnClass;
+	}
+	else
+	{
+		UE_LOG(LogTemp, Warning, TEXT("AVRNetBenchmarkGameMode::InitGame() unable to load %s, benchmarking the plain AVRCharacter"), *BenchmarkPawnClass.ToString());
+		DefaultPawnClass = AVRCharacter::StaticClass();
+	}
+
+	Super::InitGame(MapName, Options, ErrorMessage);
+
+	FParse::Value(FCommandLine::Get(), TEXT("VRNetBenchmarkClients="), NumClients);
+
+	OutputFilename = FPaths::ProjectSavedDir() / TEXT("Benchmarks") / TEXT("VRNet.json");
+	FParse::Value(FCommandLine::Get(), TEXT("VRBenchmarkOutput="), OutputFilename);
+}
+
+APawn *AVRNetBenchmarkGameMode::SpawnDefaultPawnAtTransform_Implementation(AController *NewPlayer, const FTransform &SpawnTransform)
+{
+	// everybody gets the same player start, so spread them out before they spawn into each other
+	const int32 GridSize = FMath::CeilToInt(FMath::Sqrt((float)FMath::Max(NumClients + 1, 1)));
+	int32 Index = NumSpawnedPawns++;
+	FVector Offset(PawnSpacing * (Index % GridSize - GridSize / 2), PawnSpacing * (Index / GridSize - GridSize / 2), 0.0f);
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.Instigator = Instigator;
+	SpawnParameters.ObjectFlags |= RF_Transient;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+
+	FTransform Transform = SpawnTransform;
+	Transform.AddToTranslation(Offset);
+
+	return GetWorld()->SpawnActor<APawn>(GetDefaultPawnClassForController(NewPlayer), Transform, SpawnParameters);
+}
+
+void AVRNetBenchmarkGameMode::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	auto World = GetWorld();
+	if (bFinished || (World == nullptr))
+	{
+		return;
+	}
+
+	auto NetDriver = World->GetNetDriver();
+	if (NetDriver == nullptr)
+	{
+		UE_LOG(LogTemp, Error, TEXT("AVRNetBenchmarkGameMode::Tick() not running as a server, start with -server or open the map with ?listen"));
+		bFinished = true;
+		FPlatformMisc::RequestExit(false);
+		return;
+	}
+
+	auto Now = World->GetTimeSeconds();
+	auto NumConnected = NetDriver->ClientConnections.Num();
+
+	if (StartTime < 0.0f)
+	{
+		if (NumConnected >= NumClients)
+		{
+			UE_LOG(LogTemp, Display, TEXT("AVRNetBenchmarkGameMode::Tick() %d clients connected, measuring after %.0f s warmup"), NumConnected, WarmupSeconds);
+			StartTime = Now;
+			LastSampleTime = Now;
+			MinConnectedClients = NumConnected;
+		}
+		return;
+	}
+
+	// the connections update their byte rates once a second
+	if ((Now - StartTime >= WarmupSeconds) && (Now - LastSampleTime >= 1.0f))
+	{
+		LastSampleTime = Now;
+		SampleConnections();
+	}
+
+	if (Now - StartTime >= WarmupSeconds + MeasureSeconds)
+	{
+		FinishBenchmark();
+	}
+}
+
+void AVRNetBenchmarkGameMode::SampleConnections()
+{
+	auto NetDriver = GetWorld()->GetNetDriver();
+
+	int32 NumConnections = 0;
+	float TotalOut = 0.0f;
+	float TotalIn = 0.0f;
+	float MaxOut = 0.0f;
+
+	for (auto Connection : NetDriver->ClientConnections)
+	{
+		if (Connection == nullptr)
+		{
+			continue;
+		}
+
+		NumConnections++;
+		TotalOut += Connection->OutBytesPerSecond;
+		TotalIn += Connection->InBytesPerSecond;
+		MaxOut = FMath::Max(MaxOut, (float)Connection->OutBytesPerSecond);
+	}
+
+	MinConnectedClients = FMath::Min(MinConnectedClients, NumConnections);
+	if (NumConnections == 0)
+	{
+		return;
+	}
+
+	AverageOutBytes.Add(TotalOut / NumConnections);
+	MaxOutBytes.Add(MaxOut);
+	AverageInBytes.Add(TotalIn / NumConnections);
+}
+
+void AVRNetBenchmarkGameMode::FinishBenchmark()
+{
+	bFinished = true;
+
+	TSharedRef<FJsonObject> Results = MakeShared<FJsonObject>();
+	Results->SetStringField(TEXT("map"), GetWorld()->GetMapName());
+	Results->SetNumberField(TEXT("clients"), NumClients);
+	Results->SetNumberField(TEXT("minConnectedClients"), MinConnectedClients);
+	Results->SetNumberField(TEXT("seconds"), MeasureSeconds);
+
+	// bytes per second, the server's view: out is what a client downloads, in what it uploads
+	Results->SetObjectField(TEXT("outBytesPerClient"), MakeSummary(AverageOutBytes));
+	Results->SetObjectField(TEXT("outBytesBusiestClient"), MakeSummary(MaxOutBytes));
+	Results->SetObjectField(TEXT("inBytesPerClient"), MakeSummary(AverageInBytes));
+
+	float Min = 0.0f, Average = 0.0f, P99 = 0.0f;
+	AverageOutBytes.bGetSummary(Min, Average, P99);
+	UE_LOG(LogTemp, Display, TEXT("AVRNetBenchmarkGameMode::FinishBenchmark() %d clients, server to client min %8.0f  avg %8.0f  p99 %8.0f bytes/s"),
+		MinConnectedClients, Min, Average, P99);
+
+	FString Json;
+	auto Writer = TJsonWriterFactory<>::Create(&Json);
+	FJsonSerializer::Serialize(Results, Writer);
+
+	if (FFileHelper::SaveStringToFile(Json, *OutputFilename))
+	{
+		UE_LOG(LogTemp, Display, TEXT("AVRNetBenchmarkGameMode::FinishBenchmark() results written to %s"), *OutputFilename);
+	}
+	else
+	{
+		UE_LOG(LogTemp, Error, TEXT("AVRNetBenchmarkGameMode::FinishBenchmark() unable to write %s"), *OutputFilename);
+	}
+
+	FPlatformMisc::RequestExit(false);
+}
@@ -0,0 +1,293 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "VRNetPose.h"
+#include "VRCharacterStats.h"
+#include "Serialization/BitWriter.h"
+
+namespace
+{
+	// centimeters per quantization step of the tracked positions and of VRRoot
+	const float PoseStepsPerCentimeter = 32.0f;
+	const int32 PoseLocationBits = 18;
+
+	// the teleport marker is in world space and needs a bigger range
+	const float DestinationStepsPerCentimeter = 2.0f;
+	const int32 DestinationBits = 24;
+
+	// each of the three smallest quaternion components is within +-1/sqrt(2)
+	const int32 RotationBits = 12;
+	const float RotationRange = 0.70710678f;
+	const float RotationSteps = (1 << (RotationBits - 1)) - 1;
+
+	const float ArcTimeStepsPerSecond = 200.0f;
+	const int32 ArcTimeBits = 10;
+
+	const int32 NumPoseParts = 5;
+
+	int32 QuantizeSigned(float Value, float StepsPerUnit, int32 Bits)
+	{
+		const int32 Limit = (1 << (Bits - 1)) - 1;
+		return FMath::Clamp(FMath::RoundToInt(Value * StepsPerUnit), -Limit, Limit);
+	}
+
+	// two's complement would cost the same bits, but the offset keeps SerializeInt's range check simple
+	void SerializeSigned(FArchive &Ar, int32 &Value, int32 Bits)
+	{
+		const int32 Offset = 1 << (Bits - 1);
+
+		uint32 Unsigned = (uint32)(Value + Offset);
+		Ar.SerializeInt(Unsigned, 1u << Bits);
+		Value = (int32)Unsigned - Offset;
+	}
+
+	void SerializeVector(FArchive &Ar, int32 (&Vector)[3], int32 Bits)
+	{
+		SerializeSigned(Ar, Vector[0], Bits);
+		SerializeSigned(Ar, Vector[1], Bits);
+		SerializeSigned(Ar, Vector[2], Bits);
+	}
+
+	void QuantizeVector(const FVector &Vector, float StepsPerUnit, int32 Bits, int32 (&Out)[3])
+	{
+		Out[0] = QuantizeSigned(Vector.X, StepsPerUnit, Bits);
+		Out[1] = QuantizeSigned(Vector.Y, StepsPerUnit, Bits);
+		Out[2] = QuantizeSigned(Vector.Z, StepsPerUnit, Bits);
+	}
+
+	FVector DequantizeVector(const int32 (&In)[3], float StepsPerUnit)
+	{
+		return FVector(In[0], In[1], In[2]) / StepsPerUnit;
+	}
+
+	bool VectorsEqual(const int32 (&A)[3], const int32 (&B)[3])
+	{
+		return (A[0] == B[0]) && (A[1] == B[1]) && (A[2] == B[2]);
+	}
+
+	// the baseline the engine keeps per connection for FVRReplicatedPose
+	class FVRNetPoseDeltaState : public INetDeltaBaseState
+	{
+	public:
+		explicit FVRNetPoseDeltaState(const FVRNetPose &InPose)
+			: Pose(InPose)
+		{
+		}
+
+		virtual bool IsStateEqual(INetDeltaBaseState *OtherState) override
+		{
+			return (OtherState != nullptr) && (static_cast<FVRNetPoseDeltaState *>(OtherState)->Pose == Pose);
+		}
+
+		FVRNetPose Pose;
+	};
+}
+
+void FVRNetTransform::Quantize(const FTransform &Transform)
+{
+	QuantizeVector(Transform.GetLocation(), PoseStepsPerCentimeter, PoseLocationBits, Position);
+
+	// the largest component is left out and recomputed from the others;
+	// q and -q are the same rotation, so we can always make it positive
+	auto Quat = Transform.GetRotation().GetNormalized();
+	float Components[4] = { Quat.X, Quat.Y, Quat.Z, Quat.W };
+
+	LargestComponent = 0;
+	for (uint8 Index = 1; Index < 4; Index++)
+	{
+		if (FMath::Abs(Components[Index]) > FMath::Abs(Components[LargestComponent]))
+		{
+			LargestComponent = Index;
+		}
+	}
+	auto Sign = (Components[LargestComponent] < 0.0f) ? -1.0f : 1.0f;
+
+	int32 Out = 0;
+	for (int32 Index = 0; Index < 4; Index++)
+	{
+		if (Index != LargestComponent)
+		{
+			Rotation[Out++] = QuantizeSigned(Sign * Components[Index] / RotationRange, RotationSteps, RotationBits);
+		}
+	}
+}
+
+FTransform FVRNetTransform::Dequantize() const
+{
+	const float Scale = RotationRange / RotationSteps;
+
+	float Components[4];
+	float SumSquares = 0.0f;
+	int32 In = 0;
+	for (int32 Index = 0; Index < 4; Index++)
+	{
+		if (Index != LargestComponent)
+		{
+			Components[Index] = Rotation[In++] * Scale;
+			SumSquares += FMath::Square(Components[Index]);
+		}
+	}
+	Components[LargestComponent] = FMath::Sqrt(FMath::Max(1.0f - SumSquares, 0.0f));
+
+	FQuat Quat(Components[0], Components[1], Components[2], Components[3]);
+	return FTransform(Quat.GetNormalized(), DequantizeVector(Position, PoseStepsPerCentimeter));
+}
+
+void FVRNetTransform::Serialize(FArchive &Ar)
+{
+	SerializeVector(Ar, Position, PoseLocationBits);
+
+	Ar.SerializeBits(&LargestComponent, 2);
+	SerializeVector(Ar, Rotation, RotationBits);
+}
+
+bool FVRNetTransform::operator==(const FVRNetTransform &Other) const
+{
+	return (LargestComponent == Other.LargestComponent) && VectorsEqual(Position, Other.Position) && VectorsEqual(Rotation, Other.Rotation);
+}
+
+void FVRNetPose::SetTrackedPoses(const FTransform &InCamera, const FTransform &InLeftController, const FTransform &InRightController, const FVector &InVRRootLocation)
+{
+	Camera.Quantize(InCamera);
+	LeftController.Quantize(InLeftController);
+	RightController.Quantize(InRightController);
+	QuantizeVector(InVRRootLocation, PoseStepsPerCentimeter, PoseLocationBits, VRRootLocation);
+}
+
+void FVRNetPose::SetTeleportAim(bool bAiming, const FVector &Destination, float ArcTime)
+{
+	bTeleportAiming = bAiming;
+
+	// a hidden marker may go anywhere, keep it from changing the pose
+	if (!bAiming)
+	{
+		TeleportDestination[0] = TeleportDestination[1] = TeleportDestination[2] = 0;
+		TeleportArcTime = 0;
+		return;
+	}
+
+	QuantizeVector(Destination, DestinationStepsPerCentimeter, DestinationBits, TeleportDestination);
+	TeleportArcTime = (uint16)FMath::Clamp(FMath::RoundToInt(ArcTime * ArcTimeStepsPerSecond), 0, (1 << ArcTimeBits) - 1);
+}
+
+FVector FVRNetPose::GetVRRootLocation() const
+{
+	return DequantizeVector(VRRootLocation, PoseStepsPerCentimeter);
+}
+
+FVector FVRNetPose::GetTeleportDestination() const
+{
+	return DequantizeVector(TeleportDestination, DestinationStepsPerCentimeter);
+}
+
+float FVRNetPose::GetTeleportArcTime() const
+{
+	return TeleportArcTime / ArcTimeStepsPerSecond;
+}
+
+uint8 FVRNetPose::GetChangedParts(const FVRNetPose &Other) const
+{
+	uint8 Parts = 0;
+
+	if (Camera != Other.Camera)
+	{
+		Parts |= VRNetPosePart_Camera;
+	}
+	if (LeftController != Other.LeftController)
+	{
+		Parts |= VRNetPosePart_LeftController;
+	}
+	if (RightController != Other.RightController)
+	{
+		Parts |= VRNetPosePart_RightController;
+	}
+	if (!VectorsEqual(VRRootLocation, Other.VRRootLocation))
+	{
+		Parts |= VRNetPosePart_VRRoot;
+	}
+	if ((bTeleportAiming != Other.bTeleportAiming) || !VectorsEqual(TeleportDestination, Other.TeleportDestination) || (TeleportArcTime != Other.TeleportArcTime))
+	{
+		Parts |= VRNetPosePart_TeleportAim;
+	}
+
+	return Parts;
+}
+
+void FVRNetPose::Serialize(FArchive &Ar, uint8 &Parts)
+{
+	Ar.SerializeBits(&Parts, NumPoseParts);
+
+	if (Parts & VRNetPosePart_Camera)
+	{
+		Camera.Serialize(Ar);
+	}
+	if (Parts & VRNetPosePart_LeftController)
+	{
+		LeftController.Serialize(Ar);
+	}
+	if (Parts & VRNetPosePart_RightController)
+	{
+		RightController.Serialize(Ar);
+	}
+	if (Parts & VRNetPosePart_VRRoot)
+	{
+		SerializeVector(Ar, VRRootLocation, PoseLocationBits);
+	}
+	if (Parts & VRNetPosePart_TeleportAim)
+	{
+		uint8 bAiming = bTeleportAiming ? 1 : 0;
+		Ar.SerializeBits(&bAiming, 1);
+		bTeleportAiming = (bAiming != 0);
+
+		if (bTeleportAiming)
+		{
+			SerializeVector(Ar, TeleportDestination, DestinationBits);
+
+			uint32 ArcTime = TeleportArcTime;
+			Ar.SerializeInt(ArcTime, 1u << ArcTimeBits);
+			TeleportArcTime = (uint16)ArcTime;
+		}
+		else if (Ar.IsLoading())
+		{
+			SetTeleportAim(false, FVector::ZeroVector, 0.0f);
+		}
+	}
+}
+
+bool FVRNetPose::NetSerialize(FArchive &Ar, UPackageMap *Map, bool &bOutSuccess)
+{
+	uint8 Parts = VRNetPosePart_All;
+	Serialize(Ar, Parts);
+
+	bOutSuccess = !Ar.IsError();
+	return true;
+}
+
+bool FVRReplicatedPose::NetDeltaSerialize(FNetDeltaSerializeInfo &DeltaParms)
+{
+	if (DeltaParms.Writer != nullptr)
+	{
+		// no baseline yet: a new connection, or the actor just became relevant to it
+		auto OldState = static_cast<FVRNetPoseDeltaState *>(DeltaParms.OldState);
+		uint8 Parts = (OldState != nullptr) ? Pose.GetChangedParts(OldState->Pose) : (uint8)VRNetPosePart_All;
+		if (Parts == 0)
+		{
+			return false;
+		}
+
+		*DeltaParms.NewState = MakeShareable(new FVRNetPoseDeltaState(Pose));
+
+		auto BitsBefore = DeltaParms.Writer->GetNumBits();
+		Pose.Serialize(*DeltaParms.Writer, Parts);
+		INC_DWORD_STAT_BY(STAT_VRCharacter_PoseBytesSent, (DeltaParms.Writer->GetNumBits() - BitsBefore + 7) / 8);
+		return true;
+	}
+
+	if (DeltaParms.Reader != nullptr)
+	{
+		uint8 Parts = 0;
+		Pose.Serialize(*DeltaParms.Reader, Parts);
+		return !DeltaParms.Reader->IsError();
+	}
+
+	return false;
+}
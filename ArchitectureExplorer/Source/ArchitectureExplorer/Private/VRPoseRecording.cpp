@@ -0,0 +1,272 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "VRPoseRecording.h"
+#include "HAL/PlatformFilemanager.h"
+#include "GenericPlatform/GenericPlatformFile.h"
+#include "Async/MappedFileHandle.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+namespace
+{
+	const uint32 RecordingMagic = 0x52505256; // "VRPR"
+	const uint32 RecordingVersion = 1;
+
+	// centimeters per quantization step of a position; int16 then covers +-6.5 m of tracking space
+	const float DefaultPositionScale = 0.02f;
+
+	// write the buffer to disk once it holds this many frames (about a second at 90 Hz)
+	const int32 FramesPerFlush = 128;
+
+	enum EVRPoseActions : uint8
+	{
+		VRPoseAction_Teleport = 1 << 0,
+	};
+
+	// file layout: one header followed by NumFrames records
+	// both are plain little-endian structs so a mapped file can be indexed directly
+	struct FVRPoseRecordingHeader
+	{
+		uint32 Magic;
+		uint32 Version;
+		float PositionScale;
+		uint32 RecordSize;
+	};
+
+	struct FVRPoseRecordedTransform
+	{
+		int16 Position[3];
+		int16 Rotation[4];
+	};
+
+	struct FVRPoseRecord
+	{
+		FVRPoseRecordedTransform Transforms[3]; // camera, left, right
+		int16 Axes[2]; // forward, right
+		uint16 DeltaTime; // 10 microsecond steps
+		uint8 Actions;
+		uint8 Padding;
+	};
+
+	static_assert(sizeof(FVRPoseRecordingHeader) == 16, "the recording header is part of the file format");
+	static_assert(sizeof(FVRPoseRecord) == 50, "the recording record is part of the file format");
+
+	int16 QuantizeSigned(float Value, float Scale)
+	{
+		return (int16)FMath::Clamp(FMath::RoundToInt(Value / Scale), -32767, 32767);
+	}
+
+	void QuantizeTransform(const FTransform &Transform, float PositionScale, FVRPoseRecordedTransform &Out)
+	{
+		FVector Position = Transform.GetLocation();
+		Out.Position[0] = QuantizeSigned(Position.X, PositionScale);
+		Out.Position[1] = QuantizeSigned(Position.Y, PositionScale);
+		Out.Position[2] = QuantizeSigned(Position.Z, PositionScale);
+
+		// q and -q are the same rotation; keep W positive so every component fits in [-1, 1] consistently
+		FQuat Rotation = Transform.GetRotation().GetNormalized();
+		if (Rotation.W < 0.0f)
+		{
+			Rotation = FQuat(-Rotation.X, -Rotation.Y, -Rotation.Z, -Rotation.W);
+		}
+		Out.Rotation[0] = QuantizeSigned(Rotation.X, 1.0f / 32767.0f);
+		Out.Rotation[1] = QuantizeSigned(Rotation.Y, 1.0f / 32767.0f);
+		Out.Rotation[2] = QuantizeSigned(Rotation.Z, 1.0f / 32767.0f);
+		Out.Rotation[3] = QuantizeSigned(Rotation.W, 1.0f / 32767.0f);
+	}
+
+	FTransform DequantizeTransform(const FVRPoseRecordedTransform &In, float PositionScale)
+	{
+		FVector Position(In.Position[0] * PositionScale, In.Position[1] * PositionScale, In.Position[2] * PositionScale);
+		FQuat Rotation(In.Rotation[0] / 32767.0f, In.Rotation[1] / 32767.0f, In.Rotation[2] / 32767.0f, In.Rotation[3] / 32767.0f);
+
+		return FTransform(Rotation.GetNormalized(), Position);
+	}
+}
+
+FVRPoseRecorder::FVRPoseRecorder()
+{
+}
+
+FVRPoseRecorder::~FVRPoseRecorder()
+{
+	Stop();
+}
+
+bool FVRPoseRecorder::bStart(const FString &Filename)
+{
+	Stop();
+
+	auto &PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	PlatformFile.CreateDirectoryTree(*FPaths::GetPath(Filename));
+
+	File.Reset(PlatformFile.OpenWrite(*Filename));
+	if (!File.IsValid())
+	{
+		UE_LOG(LogTemp, Error, TEXT("FVRPoseRecorder::bStart() unable to open %s"), *Filename);
+		return false;
+	}
+
+	FVRPoseRecordingHeader Header;
+	Header.Magic = RecordingMagic;
+	Header.Version = RecordingVersion;
+	Header.PositionScale = DefaultPositionScale;
+	Header.RecordSize = sizeof(FVRPoseRecord);
+
+	File->Write(reinterpret_cast<const uint8 *>(&Header), sizeof(Header));
+
+	Buffer.Reset();
+	Buffer.Reserve(FramesPerFlush * sizeof(FVRPoseRecord));
+	NumFrames = 0;
+
+	return true;
+}
+
+void FVRPoseRecorder::Stop()
+{
+	if (!File.IsValid())
+	{
+		return;
+	}
+
+	Flush();
+	File.Reset();
+}
+
+void FVRPoseRecorder::AddFrame(const FVRPoseFrame &Frame)
+{
+	if (!File.IsValid())
+	{
+		return;
+	}
+
+	FVRPoseRecord Record;
+	FMemory::Memzero(Record);
+
+	QuantizeTransform(Frame.Camera, DefaultPositionScale, Record.Transforms[0]);
+	QuantizeTransform(Frame.LeftController, DefaultPositionScale, Record.Transforms[1]);
+	QuantizeTransform(Frame.RightController, DefaultPositionScale, Record.Transforms[2]);
+
+	Record.Axes[0] = QuantizeSigned(FMath::Clamp(Frame.ForwardAxis, -1.0f, 1.0f), 1.0f / 32767.0f);
+	Record.Axes[1] = QuantizeSigned(FMath::Clamp(Frame.RightAxis, -1.0f, 1.0f), 1.0f / 32767.0f);
+	Record.DeltaTime = (uint16)FMath::Clamp(FMath::RoundToInt(Frame.DeltaTime * 100000.0f), 0, 65535);
+	Record.Actions = Frame.bTeleportPressed ? VRPoseAction_Teleport : 0;
+
+	Buffer.Append(reinterpret_cast<const uint8 *>(&Record), sizeof(Record));
+	NumFrames++;
+
+	if (Buffer.Num() >= FramesPerFlush * (int32)sizeof(FVRPoseRecord))
+	{
+		Flush();
+	}
+}
+
+void FVRPoseRecorder::Flush()
+{
+	if (File.IsValid() && (Buffer.Num() > 0))
+	{
+		File->Write(Buffer.GetData(), Buffer.Num());
+		File->Flush();
+	}
+	Buffer.Reset();
+}
+
+FVRPoseReplay::FVRPoseReplay()
+{
+}
+
+FVRPoseReplay::~FVRPoseReplay()
+{
+	Close();
+}
+
+bool FVRPoseReplay::bOpen(const FString &Filename)
+{
+	Close();
+
+	// map the file so hours of recording don't have to be read into memory
+	MappedFile.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*Filename));
+	if (MappedFile.IsValid())
+	{
+		MappedRegion.Reset(MappedFile->MapRegion(0, MappedFile->GetFileSize()));
+		if (MappedRegion.IsValid() && bSetData(MappedRegion->GetMappedPtr(), MappedRegion->GetMappedSize()))
+		{
+			return true;
+		}
+	}
+	else if (FFileHelper::LoadFileToArray(LoadedFile, *Filename) && bSetData(LoadedFile.GetData(), LoadedFile.Num()))
+	{
+		return true;
+	}
+
+	UE_LOG(LogTemp, Error, TEXT("FVRPoseReplay::bOpen() %s is not a pose recording"), *Filename);
+	Close();
+	return false;
+}
+
+void FVRPoseReplay::Close()
+{
+	Records = nullptr;
+	NumFrames = 0;
+	CurrentFrame = 0;
+
+	// the region has to go before the file it maps
+	MappedRegion.Reset();
+	MappedFile.Reset();
+	LoadedFile.Empty();
+}
+
+bool FVRPoseReplay::bSetData(const uint8 *Data, int64 Size)
+{
+	if ((Data == nullptr) || (Size < (int64)sizeof(FVRPoseRecordingHeader)))
+	{
+		return false;
+	}
+
+	FVRPoseRecordingHeader Header;
+	FMemory::Memcpy(&Header, Data, sizeof(Header));
+
+	if ((Header.Magic != RecordingMagic) || (Header.Version != RecordingVersion) || (Header.RecordSize != sizeof(FVRPoseRecord)))
+	{
+		return false;
+	}
+
+	Records = Data + sizeof(Header);
+	NumFrames = (int32)((Size - sizeof(Header)) / sizeof(FVRPoseRecord));
+	PositionScale = Header.PositionScale;
+	CurrentFrame = 0;
+
+	return NumFrames > 0;
+}
+
+bool FVRPoseReplay::bNextFrame(FVRPoseFrame &OutFrame, bool bLoop)
+{
+	if (Records == nullptr)
+	{
+		return false;
+	}
+
+	if (CurrentFrame >= NumFrames)
+	{
+		if (!bLoop)
+		{
+			return false;
+		}
+		CurrentFrame = 0;
+	}
+
+	// records are only 2-byte aligned inside the file, so copy instead of casting
+	FVRPoseRecord Record;
+	FMemory::Memcpy(&Record, Records + (int64)CurrentFrame * sizeof(FVRPoseRecord), sizeof(Record));
+	CurrentFrame++;
+
+	OutFrame.Camera = DequantizeTransform(Record.Transforms[0], PositionScale);
+	OutFrame.LeftController = DequantizeTransform(Record.Transforms[1], PositionScale);
+	OutFrame.RightController = DequantizeTransform(Record.Transforms[2], PositionScale);
+	OutFrame.ForwardAxis = Record.Axes[0] / 32767.0f;
+	OutFrame.RightAxis = Record.Axes[1] / 32767.0f;
+	OutFrame.DeltaTime = Record.DeltaTime / 100000.0f;
+	OutFrame.bTeleportPressed = (Record.Actions & VRPoseAction_Teleport) != 0;
+
+	return true;
+}
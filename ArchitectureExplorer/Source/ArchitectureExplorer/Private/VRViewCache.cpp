@@ -0,0 +1,99 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "VRViewCache.h"
+#include "VRMathCoreConversions.h"
+#include "Engine/Engine.h"
+#include "Engine/LocalPlayer.h"
+#include "Engine/GameViewportClient.h"
+#include "GameFramework/PlayerController.h"
+#include "SceneView.h"
+
+void FVRViewCache::Update(const APlayerController *PlayerController)
+{
+	if (UpdateFrame == GFrameCounter)
+	{
+		return;
+	}
+	UpdateFrame = GFrameCounter;
+
+	for (auto &View : Views)
+	{
+		View.bValid = false;
+	}
+
+	auto LocalPlayer = (PlayerController != nullptr) ? PlayerController->GetLocalPlayer() : nullptr;
+	if ((LocalPlayer == nullptr) || (LocalPlayer->ViewportClient == nullptr) || (LocalPlayer->ViewportClient->Viewport == nullptr))
+	{
+		return;
+	}
+
+	auto Viewport = LocalPlayer->ViewportClient->Viewport;
+	bStereo = (GEngine != nullptr) && GEngine->IsStereoscopic3D(Viewport);
+
+	const EStereoscopicPass Passes[] = { eSSP_FULL, eSSP_LEFT_EYE, eSSP_RIGHT_EYE };
+	static_assert(ARRAY_COUNT(Passes) == (int32)EVRView::Count, "every view needs a stereo pass");
+
+	for (int32 Index = 0; Index < (int32)EVRView::Count; Index++)
+	{
+		// without a headset the eyes see what the mono view sees
+		if (!bStereo && (Index != (int32)EVRView::Mono))
+		{
+			Views[Index] = Views[(int32)EVRView::Mono];
+			continue;
+		}
+
+		FSceneViewProjectionData ProjectionData;
+		if (LocalPlayer->GetProjectionData(Viewport, Passes[Index], ProjectionData))
+		{
+			Views[Index].ViewProjection = ProjectionData.ComputeViewProjectionMatrix();
+			Views[Index].bValid = true;
+		}
+	}
+}
+
+bool FVRViewCache::bProject(EVRView View, const FVector &WorldLocation, FVector2D &OutScreen) const
+{
+	const auto &CachedView = Views[(int32)View];
+	if (!CachedView.bValid)
+	{
+		return false;
+	}
+
+	// same as FSceneView::ProjectWorldToScreen, without the view rect
+	VRMathCore::FVec2 Screen;
+	if (!VRMathCore::bProject(VRMathCore::ToCore(CachedView.ViewProjection), VRMathCore::ToCore(WorldLocation), Screen))
+	{
+		return false;
+	}
+
+	OutScreen = VRMathCore::FromCore(Screen);
+	return true;
+}
+
+int32 FVRViewCache::Project(EVRView View, const TArray<FVector> &WorldLocations, TArray<FVector2D> &OutScreen, TArray<bool> *OutInFront) const
+{
+	static_assert(sizeof(bool) == sizeof(uint8), "OutInFront is handed to VRMathCore::Project as bytes");
+
+	OutScreen.SetNumUninitialized(WorldLocations.Num());
+	if (OutInFront != nullptr)
+	{
+		OutInFront->SetNumUninitialized(WorldLocations.Num());
+	}
+
+	const auto &CachedView = Views[(int32)View];
+	if (!CachedView.bValid)
+	{
+		for (int32 Index = 0; Index < WorldLocations.Num(); Index++)
+		{
+			OutScreen[Index] = FVector2D(0.5f, 0.5f);
+			if (OutInFront != nullptr)
+			{
+				(*OutInFront)[Index] = false;
+			}
+		}
+		return 0;
+	}
+
+	auto InFront = (OutInFront != nullptr) ? reinterpret_cast<uint8 *>(OutInFront->GetData()) : nullptr;
+	return VRMathCore::Project(VRMathCore::ToCore(CachedView.ViewProjection), VRMathCore::ToCore(WorldLocations.GetData()), WorldLocations.Num(), VRMathCore::ToCore(OutScreen.GetData()), InFront);
+}
@@ -0,0 +1,203 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Info.h"
+#include "ArchitectureSignificanceManager.generated.h"
+
+class UActorComponent;
+class UPrimitiveComponent;
+class UStaticMeshComponent;
+
+// how much of its full cost a scene actor gets, from most to least
+UENUM()
+enum class EArchitectureSignificance : uint8
+{
+	// ticks as authored, casts shadows, authored LODs
+	Full,
+	// ticks at ReducedTickInterval at most, LODs shifted by ReducedLODBias
+	Reduced,
+	// ticks at MinimalTickInterval at most, LODs shifted by MinimalLODBias, no dynamic shadow
+	Minimal
+};
+
+// one scene actor and what we changed on it
+struct FArchitectureSignificanceEntry
+{
+	TWeakObjectPtr<AActor> Actor;
+
+	// bounding sphere, refreshed for movable actors only
+	FVector Center = FVector::ZeroVector;
+	float Radius = 0.0f; // centimeters
+	bool bMovable = false;
+	bool bHasPrimitives = false;
+
+	float Score = 1.0f;
+	EArchitectureSignificance Level = EArchitectureSignificance::Full;
+
+	// ticks per second the level saves, counted when the level is applied
+	float SkippedTickRate = 0.0f;
+
+	// the authored settings, so Full can put them back
+	float ActorTickInterval = 0.0f; // seconds
+	TArray<TWeakObjectPtr<UActorComponent>> TickingComponents;
+	TArray<float> ComponentTickIntervals; // seconds
+	TArray<TWeakObjectPtr<UPrimitiveComponent>> ShadowCasters;
+	TArray<TWeakObjectPtr<UStaticMeshComponent>> StaticMeshes;
+	TArray<int32> StaticMeshMinLODs; // negative if the component did not override the asset's
+};
+
+// Scales the tick rate, dynamic shadows and LODs of the placed scene actors by how much the VR user can see of them
+//
+// Every actor gets a score between 0 and 1 from the camera pose and the teleport destination
+// of the local AVRCharacter:
+// - distance: 1 within FullDistance, falling to 0 at MinimalDistance
+// - view cone: times OutOfViewFactor if it is outside ViewConeAngle of the camera
+// - occlusion: times NotRenderedFactor if none of its primitives made it to the screen
+//   recently, i.e. it was culled by occlusion (or by the view frustum)
+// The teleport destination scores by distance alone, the user is about to look around there.
+// The score picks a level of EArchitectureSignificance; it has to pass a threshold by
+// Hysteresis before the level changes, so actors near a threshold don't flip every frame.
+//
+// Only ActorsPerFrame actors are scored per frame, round robin, unless the camera jumped
+// (a teleport), then all of them over the next TeleportRescoreFrames frames. Pawns, controllers, infos, brushes and actors tagged
+// AlwaysSignificant are left alone. There is one per world, spawned by the first AVRCharacter.
+//
+// vr.Significance 0 puts every actor back to Full. The game thread time saved is measured
+// against the frames with vr.Significance 0, so switch it off for a few seconds in the same
+// spot to take a reference.
+UCLASS(NotPlaceable, Transient, config = Game)
+class ARCHITECTUREEXPLORER_API AArchitectureSignificanceManager : public AInfo
+{
+	GENERATED_BODY()
+
+public:
+	AArchitectureSignificanceManager();
+
+	static AArchitectureSignificanceManager *FindOrSpawn(UWorld *World);
+
+	// called by the local AVRCharacter every frame
+	void SetViewpoint(const FVector &CameraLocation, const FVector &CameraDirection, bool bTeleportAiming, const FVector &TeleportDestination);
+
+	virtual void Tick(float DeltaSeconds) override;
+
+protected:
+	virtual void BeginPlay() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+	UPROPERTY(config, EditAnywhere, Category = "Significance")
+	bool bEnabled = true;
+
+	UPROPERTY(config, EditAnywhere, Category = "Significance", meta = (ClampMin = "0.0"))
+	float FullDistance = 1500.0f; // centimeters
+
+	UPROPERTY(config, EditAnywhere, Category = "Significance", meta = (ClampMin = "0.0"))
+	float MinimalDistance = 6000.0f; // centimeters
+
+	// half angle, wider than the headset's so turning the head doesn't reveal throttled actors
+	UPROPERTY(config, EditAnywhere, Category = "Significance", meta = (ClampMin = "0.0", ClampMax = "180.0"))
+	float ViewConeAngle = 75.0f; // degrees
+
+	UPROPERTY(config, EditAnywhere, Category = "Significance", meta = (ClampMin = "0.0", ClampMax = "1.0"))
+	float OutOfViewFactor = 0.3f;
+
+	UPROPERTY(config, EditAnywhere, Category = "Significance", meta = (ClampMin = "0.0", ClampMax = "1.0"))
+	float NotRenderedFactor = 0.5f;
+
+	// an actor rendered within this time counts as visible
+	UPROPERTY(config, EditAnywhere, Category = "Significance", meta = (ClampMin = "0.0"))
+	float RecentlyRenderedTime = 0.5f; // seconds
+
+	// scores below these thresholds are Reduced and Minimal
+	UPROPERTY(config, EditAnywhere, Category = "Significance", meta = (ClampMin = "0.0", ClampMax = "1.0"))
+	float ReducedThreshold = 0.5f;
+
+	UPROPERTY(config, EditAnywhere, Category = "Significance", meta = (ClampMin = "0.0", ClampMax = "1.0"))
+	float MinimalThreshold = 0.15f;
+
+	UPROPERTY(config, EditAnywhere, Category = "Significance", meta = (ClampMin = "0.0", ClampMax = "0.5"))
+	float Hysteresis = 0.05f;
+
+	UPROPERTY(config, EditAnywhere, Category = "Significance", meta = (ClampMin = "0.0"))
+	float ReducedTickInterval = 0.1f; // seconds
+
+	UPROPERTY(config, EditAnywhere, Category = "Significance", meta = (ClampMin = "0.0"))
+	float MinimalTickInterval = 0.5f; // seconds
+
+	// added to the min LOD of static meshes; changing it recreates their render state, hence the hysteresis
+	UPROPERTY(config, EditAnywhere, Category = "Significance", meta = (ClampMin = "0"))
+	int32 ReducedLODBias = 0;
+
+	UPROPERTY(config, EditAnywhere, Category = "Significance", meta = (ClampMin = "0"))
+	int32 MinimalLODBias = 1;
+
+	// only movable primitives, the shadows of the others are baked
+	UPROPERTY(config, EditAnywhere, Category = "Significance")
+	bool bDisableMinimalShadows = true;
+
+	UPROPERTY(config, EditAnywhere, Category = "Significance", meta = (ClampMin = "1"))
+	int32 ActorsPerFrame = 500;
+
+	// frames to rescore everything after a teleport; one frame would be a hitch right when the view comes back
+	UPROPERTY(config, EditAnywhere, Category = "Significance", meta = (ClampMin = "1"))
+	int32 TeleportRescoreFrames = 4;
+
+	// actors at each level, and how much game thread time that saves
+	UPROPERTY(VisibleInstanceOnly, Category = "Significance")
+	int32 NumReducedActors = 0;
+
+	UPROPERTY(VisibleInstanceOnly, Category = "Significance")
+	int32 NumMinimalActors = 0;
+
+	UPROPERTY(VisibleInstanceOnly, Category = "Significance")
+	float SkippedTicksPerFrame = 0.0f;
+
+	UPROPERTY(VisibleInstanceOnly, Category = "Significance")
+	float SavedGameThreadTime = 0.0f; // milliseconds
+
+	TArray<FArchitectureSignificanceEntry> Entries;
+	int32 NextEntry = 0;
+
+	// entries still to rescore after the last teleport
+	int32 TeleportRescoreLeft = 0;
+
+	// sum of SkippedTickRate over the entries, kept up to date by ApplyLevel
+	float SkippedTickRate = 0.0f;
+
+	FVector CameraLocation = FVector::ZeroVector;
+	FVector CameraDirection = FVector::ForwardVector;
+	FVector LastScoredCameraLocation = FVector::ZeroVector;
+	bool bTeleportAiming = false;
+	FVector TeleportDestination = FVector::ZeroVector;
+	bool bHasViewpoint = false;
+
+	// true while the actors are throttled, false once they are all back to Full
+	bool bApplied = false;
+
+	// smoothed game thread time with and without throttling, negative until measured
+	float ThrottledGameThreadTime = -1.0f; // milliseconds
+	float ReferenceGameThreadTime = -1.0f; // milliseconds
+
+	FDelegateHandle ActorSpawnedHandle;
+
+	bool bShouldRegister(AActor *Actor) const;
+	void RegisterActor(AActor *Actor);
+	void OnActorSpawned(AActor *Actor);
+
+	float GetScore(const FArchitectureSignificanceEntry &Entry) const;
+	EArchitectureSignificance GetLevel(const FArchitectureSignificanceEntry &Entry) const;
+	void ApplyLevel(FArchitectureSignificanceEntry &Entry, EArchitectureSignificance Level);
+
+	// take an entry out of the level counts, before it is removed
+	void RemoveFromStats(const FArchitectureSignificanceEntry &Entry);
+
+	// false if the actor is gone
+	bool bUpdateEntry(FArchitectureSignificanceEntry &Entry);
+
+	void RestoreAll();
+
+	void UpdateStats(float DeltaSeconds);
+};
@@ -0,0 +1,24 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "BakeTeleportSurfacesCommandlet.generated.h"
+
+// Bakes the teleportable surfaces of a map into a UTeleportSurfaceIndex asset
+//
+// run it after the navigation mesh of the map was built and saved:
+//   UE4Editor-Cmd ArchitectureExplorer.uproject -run=BakeTeleportSurfaces -Map=/Game/MainMap [-CellSize=25]
+//
+// the asset is written to UTeleportSurfaceIndex::GetPackageNameForMap(Map) where AVRCharacter finds it
+UCLASS()
+class ARCHITECTUREEXPLORER_API UBakeTeleportSurfacesCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UBakeTeleportSurfacesCommandlet();
+
+	virtual int32 Main(const FString &Params) override;
+};
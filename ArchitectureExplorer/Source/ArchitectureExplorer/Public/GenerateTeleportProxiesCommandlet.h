@@ -0,0 +1,59 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "GenerateTeleportProxiesCommandlet.generated.h"
+
+class UWorld;
+class ULevel;
+class UStaticMeshComponent;
+
+// Puts simple collision on the Teleport trace channel for the teleport arc to hit
+//
+// run it on a map and its streaming levels after changing the architecture:
+//   UE4Editor-Cmd ArchitectureExplorer.uproject -run=GenerateTeleportProxies -Map=/Game/MainMap [-BoxTolerance=2] [-BoxFit=0.9]
+//
+// The Teleport channel (DefaultEngine.ini) is ignored by default. For every static or
+// stationary static mesh that blocks ECC_Visibility:
+// - meshes with simple collision block the channel, the sweeps then use the simple shapes
+// - complex-only meshes that are boxes (walls, slabs, doors: BoxFit of their triangle area
+//   on the faces of their bounds) get a hidden box component that blocks the channel instead
+// - the rest block the channel with their complex collision, as before
+// Everything else that blocks ECC_Visibility (landscape, BSP, instanced meshes) blocks it too.
+// Running it again replaces the proxies. The map is marked, so AVRCharacter traces the arc
+// on the Teleport channel there and on ECC_Visibility in maps that weren't processed.
+UCLASS()
+class ARCHITECTUREEXPLORER_API UGenerateTeleportProxiesCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UGenerateTeleportProxiesCommandlet();
+
+	virtual int32 Main(const FString &Params) override;
+
+	// the Teleport channel of DefaultEngine.ini
+	static const ECollisionChannel TeleportTraceChannel;
+
+	// on the proxy components, and on the world settings of a processed map
+	static const FName TeleportProxyTag;
+
+	// true if the commandlet ran on the map of World
+	static bool bHasTeleportProxies(const UWorld *World);
+
+private:
+	float BoxTolerance = 2.0f; // centimeters
+	float BoxFit = 0.9f;
+
+	int32 NumSimple = 0;
+	int32 NumBoxes = 0;
+	int32 NumComplex = 0;
+	int32 NumOther = 0;
+
+	void ProcessLevel(ULevel &Level);
+
+	// the box the mesh fits in local space, false if it is not a box
+	bool bGetProxyBox(const UStaticMeshComponent &MeshComponent, FBox &OutBox) const;
+};
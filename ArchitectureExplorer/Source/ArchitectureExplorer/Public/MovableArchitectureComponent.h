@@ -0,0 +1,55 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "MovableArchitectureComponent.generated.h"
+
+class ATeleportNavigationUpdater;
+class UPrimitiveComponent;
+class USceneComponent;
+
+// Add to walls, furniture and everything else that is moved around during a review
+//
+// Reports every move of its actor to the ATeleportNavigationUpdater of the world, which
+// takes the actor out of the navigation octree while it moves and puts it back once it
+// rests, so only the tiles the actor left and entered are rebuilt. While moving, the actor
+// does not block the navigation mesh. The actor's root component must be movable.
+// Its primitives that block ECC_Visibility also block the Teleport trace channel.
+UCLASS(ClassGroup = (VR), meta = (BlueprintSpawnableComponent))
+class ARCHITECTUREEXPLORER_API UMovableArchitectureComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UMovableArchitectureComponent();
+
+	// called by ATeleportNavigationUpdater
+	// take the primitives of the actor out of the navigation octree, so moving them dirties nothing
+	void HoldNavigation();
+	// and put them back where they are now
+	void ReleaseNavigation();
+
+	bool IsNavigationHeld() const { return bNavigationHeld; }
+
+protected:
+	virtual void BeginPlay() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+	UPROPERTY()
+	ATeleportNavigationUpdater *NavigationUpdater = nullptr;
+
+	// where the actor was when we last reported it
+	FBox LastBounds;
+
+	FDelegateHandle TransformUpdatedHandle;
+
+	// primitives HoldNavigation took out of the navigation octree
+	TArray<TWeakObjectPtr<UPrimitiveComponent>> HeldPrimitives;
+	bool bNavigationHeld = false;
+
+	void OnTransformUpdated(USceneComponent *UpdatedComponent, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport);
+};
@@ -0,0 +1,105 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineTypes.h"
+#include "CollisionQueryParams.h"
+#include "WorldCollision.h"
+
+class UWorld;
+
+// everything that defines the teleport arc
+struct FTeleportArcParams
+{
+	FVector Start = FVector::ZeroVector;
+	FVector LaunchVelocity = FVector::ZeroVector; // centimeters per second
+	float GravityZ = -980.0f; // centimeters per second squared
+	float SimulationTime = 2.0f; // seconds
+	float Radius = 3.0f; // centimeters
+
+	// how far a straight segment may stray from the real parabola
+	// bigger values give fewer, longer segments
+	float MaxDeviation = 2.0f; // centimeters
+
+	ECollisionChannel TraceChannel = ECollisionChannel::ECC_Visibility;
+};
+
+// what the arc tracer and PredictProjectilePath spent on the same arc, see AVRCharacter::bValidateTeleportArcTracer
+struct FTeleportArcTracerComparison
+{
+	// overlaps and sweeps of the tracer, sweeps of PredictProjectilePath (one per simulation step up to the hit)
+	int32 TracerQueries = 0;
+	int32 PredictQueries = 0;
+
+	float TracerMilliseconds = 0.0f;
+	float PredictMilliseconds = 0.0f;
+};
+
+// one straight piece of the arc
+struct FTeleportArcSegment
+{
+	FVector Start = FVector::ZeroVector;
+	FVector End = FVector::ZeroVector;
+	float StartTime = 0.0f;
+	float EndTime = 0.0f;
+};
+
+// replacement for UGameplayStatics::PredictProjectilePath for the teleport arc
+//
+// PredictProjectilePath steps the arc at a fixed rate and sweeps every step.
+// This tracer evaluates the parabola analytically, makes segments as long as
+// the curvature allows, throws away segments that cannot touch anything using
+// one coarse overlap query per few consecutive segments and only sweeps the
+// segments that are left. It walks the arc from the start, so nothing past the
+// first hit is queried.
+//
+// The tracer keeps its working arrays between calls so tracing does not allocate
+// once the arrays have grown to their steady-state size.
+class ARCHITECTUREEXPLORER_API FTeleportArcTracer
+{
+public:
+	// position on the arc at the given time
+	static FVector GetArcLocation(const FTeleportArcParams &Params, float Time);
+
+	// velocity on the arc at the given time
+	static FVector GetArcVelocity(const FTeleportArcParams &Params, float Time);
+
+	// when the arc comes down through height Z, within the simulation time
+	// returns false if it never gets that low or only on the way up
+	static bool bGetArcTimeAtHeight(const FTeleportArcParams &Params, float Z, float &OutTime);
+
+	// split the arc into straight segments, each deviating at most Params.MaxDeviation from the parabola
+	static void BuildSegments(const FTeleportArcParams &Params, TArray<FTeleportArcSegment> &OutSegments);
+
+	// most segments BuildSegments ever produces
+	static int32 GetMaxSegments();
+
+	// grow the working arrays so bTrace does not allocate for typical scenes
+	void Reserve();
+
+	// trace the arc and return the first blocking hit along it
+	// returns false if nothing was hit within Params.SimulationTime
+	bool bTrace(UWorld *World, const FTeleportArcParams &Params, const FCollisionQueryParams &QueryParams, FHitResult &OutHit);
+
+	// segments of the last bTrace call
+	const TArray<FTeleportArcSegment> &GetSegments() const { return Segments; }
+
+	// number of physics queries (overlaps and sweeps) the last bTrace call needed
+	int32 GetNumQueries() const { return NumQueries; }
+
+	// number of sweeps the last bTrace call needed
+	int32 GetNumSweeps() const { return NumSweeps; }
+
+	// time along the arc at which the last bTrace call hit something
+	float GetHitTime() const { return HitTime; }
+
+private:
+	TArray<FTeleportArcSegment> Segments;
+	TArray<FOverlapResult> Overlaps;
+	TArray<FBox> CandidateBounds;
+
+	int32 NumQueries = 0;
+	int32 NumSweeps = 0;
+	float HitTime = 0.0f;
+};
@@ -0,0 +1,81 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineTypes.h"
+#include "CollisionQueryParams.h"
+#include "WorldCollision.h"
+
+class UWorld;
+class UPrimitiveComponent;
+
+// what the clearance cache needs to know about the capsule
+struct FTeleportClearanceParams
+{
+	float Radius = 34.0f; // centimeters
+	float HalfHeight = 88.0f; // centimeters
+
+	ECollisionChannel TraceChannel = ECollisionChannel::ECC_Pawn;
+
+	// locations are cached per cell of this size
+	float CellSize = 10.0f; // centimeters
+
+	// movable components within this distance of the capsule are watched; if one of them moves, the cell is tested again
+	float WatchDistance = 50.0f; // centimeters
+
+	// cells are tested again after this long, e.g. for levels that streamed in or out
+	float MaxAge = 10.0f; // seconds
+};
+
+// answers "does the capsule fit standing here" with as few overlap tests as possible
+//
+// Results are cached per grid cell. A cell is tested once with a capsule grown by half a
+// cell, so the answer holds for every location in it; aiming around a room then costs a
+// map lookup per frame. The test also remembers the movable components around the capsule
+// and where they were; when one of them has moved (or is gone) since, the cell is tested again.
+// Static and stationary geometry cannot move, so it needs no watching.
+class ARCHITECTUREEXPLORER_API FTeleportClearanceCache
+{
+public:
+	// true if a capsule standing on Location (its bottom at Location) overlaps nothing blocking
+	// bOutFromCache tells whether an overlap test was needed
+	bool bHasClearance(UWorld *World, const FTeleportClearanceParams &Params, const FCollisionQueryParams &QueryParams, const FVector &Location, bool &bOutFromCache);
+
+	// forget all cells
+	void Reset();
+
+	int32 GetNumCells() const { return Cells.Num(); }
+
+	// number of physics queries the last bHasClearance call needed
+	int32 GetNumQueries() const { return NumQueries; }
+
+	// cells tested again because a watched component moved or the cell got too old
+	int32 GetNumInvalidations() const { return NumInvalidations; }
+	void ResetCounters() { NumInvalidations = 0; }
+
+private:
+	struct FWatchedComponent
+	{
+		TWeakObjectPtr<UPrimitiveComponent> Component;
+		FTransform Transform;
+	};
+
+	struct FCell
+	{
+		bool bClear = false;
+		float Time = 0.0f; // seconds
+		TArray<FWatchedComponent, TInlineAllocator<4>> Watched;
+	};
+
+	// true if the cell is still valid
+	static bool bIsCellValid(const FCell &Cell, const FTeleportClearanceParams &Params, float Now);
+
+	TMap<FIntVector, FCell> Cells;
+
+	// reused by the overlap query
+	TArray<FOverlapResult> Overlaps;
+
+	int32 NumQueries = 0;
+	int32 NumInvalidations = 0;
+};
@@ -0,0 +1,28 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "TeleportLateLatchComponent.generated.h"
+
+// Moves the teleport arc and DestinationMarker of its AVRCharacter to a late controller pose
+//
+// The character traces the arc from the controller pose it read at the start of the frame.
+// This component ticks in TG_PostUpdateWork, after the search and everything else that
+// moves things around, polls the right controller once more and re-bends the arc and
+// shifts the marker by how much the new pose moved the landing point. The trace itself
+// is not repeated, so the correction is capped at the character's MaxTeleportLateLatchDistance.
+UCLASS(ClassGroup = (VR), meta = (BlueprintSpawnableComponent))
+class ARCHITECTUREEXPLORER_API UTeleportLateLatchComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UTeleportLateLatchComponent();
+
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction *ThisTickFunction) override;
+
+protected:
+	virtual void RegisterComponentTickFunctions(bool bRegister) override;
+};
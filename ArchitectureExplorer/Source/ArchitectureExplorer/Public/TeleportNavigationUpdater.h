@@ -0,0 +1,149 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Info.h"
+#include "TeleportNavigationUpdater.generated.h"
+
+class ARecastNavMesh;
+class ANavigationData;
+class UMovableArchitectureComponent;
+class UTeleportSurfaceIndex;
+struct FTeleportSurfaceValidity;
+
+// moved architecture that is out of the navigation octree until it settles
+struct FHeldArchitecture
+{
+	TWeakObjectPtr<UMovableArchitectureComponent> Component;
+
+	// where it was before its first move, and where it is now
+	FBox StartBounds = FBox(ForceInit);
+	FBox EndBounds = FBox(ForceInit);
+};
+
+// Keeps the navigation mesh up to date while architecture is moved around at runtime
+//
+// The navigation mesh generates at runtime (RuntimeGeneration=Dynamic in DefaultEngine.ini),
+// so the recast generator only rebuilds the tiles under moved geometry, on worker threads,
+// and a rebuilt tile replaces the old one in one go on the game thread. Teleport queries
+// keep using the old tile until then.
+//
+// What this adds:
+// - while something is being dragged, every frame would restart the rebuild of its tiles;
+//   the moving actor is taken out of the navigation octree until it has rested for SettleTime,
+//   so it dirties nothing while it moves, and put back afterwards, which dirties the tiles
+//   under its new place through the navigation system's own dirty area path
+//   (a navigation build lock would not do: releasing it rebuilds the whole mesh)
+// - taking the actor out dirties the tiles under where it started at once, and those may be
+//   rebuilt without it while it is still held; until the tiles under where it stands are rebuilt
+//   with it, IsInsideMovingArchitecture tells the teleport search not to go there
+// - at most MaxTileJobs tiles build at the same time, and only one while the frame budget of
+//   the local VR character is degraded, which bounds both the worker load and the tiles
+//   swapped in per frame; the navigation mesh gets its own job count back afterwards
+// - how many tiles were dirtied (where the architecture started and where it was released,
+//   not every place it passed on the way) and how long it took until they were all rebuilt
+// - which parts of the baked teleport surfaces still match the navigation mesh, checked once
+//   per rebuild for the whole world instead of by every character
+//
+// Moves are reported by UMovableArchitectureComponent. There is one per world, spawned
+// by the first component or VR character that needs it.
+UCLASS(NotPlaceable, Transient, config = Game)
+class ARCHITECTUREEXPLORER_API ATeleportNavigationUpdater : public AInfo
+{
+	GENERATED_BODY()
+
+public:
+	ATeleportNavigationUpdater();
+
+	static ATeleportNavigationUpdater *FindOrSpawn(UWorld *World);
+
+	// OldBounds and NewBounds are where the moved geometry was and is
+	void NotifyArchitectureMoved(UMovableArchitectureComponent *Component, const FBox &OldBounds, const FBox &NewBounds);
+
+	virtual void BeginPlay() override;
+
+	virtual void Tick(float DeltaSeconds) override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	// true while moves are held back or tiles are still building
+	bool IsUpdating() const { return bHolding || bRebuilding; }
+
+	// true if Location is within an agent radius of architecture the navigation mesh doesn't know about yet:
+	// held architecture, or released architecture whose tiles are still building
+	bool IsInsideMovingArchitecture(const FVector &Location) const;
+
+	// which cells of Index still match the navigation mesh, shared by all characters of the world
+	// checked on the first call after the navigation mesh changed; game thread only
+	TSharedPtr<const FTeleportSurfaceValidity, ESPMode::ThreadSafe> GetSurfaceValidity(const UTeleportSurfaceIndex *Index);
+
+private:
+	// moved actors stay out of the navigation octree until nothing moved for this long
+	UPROPERTY(config, EditAnywhere, Category = "Navigation", meta = (ClampMin = "0.0"))
+	float SettleTime = 0.25f; // seconds
+
+	// but not longer than this, so architecture that keeps moving still gets navigation
+	UPROPERTY(config, EditAnywhere, Category = "Navigation", meta = (ClampMin = "0.0"))
+	float MaxHoldTime = 2.0f; // seconds
+
+	// tiles that build at the same time when there is time to spare
+	UPROPERTY(config, EditAnywhere, Category = "Navigation", meta = (ClampMin = "1"))
+	int32 MaxTileJobs = 2;
+
+	// how the last rebuild went
+	UPROPERTY(VisibleInstanceOnly, Category = "Navigation")
+	int32 LastDirtyTiles = 0;
+
+	UPROPERTY(VisibleInstanceOnly, Category = "Navigation")
+	float LastRebuildTime = 0.0f; // seconds
+
+	bool bHolding = false;
+	bool bRebuilding = false;
+	float HoldStartTime = 0.0f; // seconds
+	float LastMoveTime = 0.0f; // seconds
+	float RebuildStartTime = 0.0f; // seconds
+	int32 TileJobs = 0;
+
+	// the navigation mesh's own job count from before we changed it, negative while we haven't
+	int32 OriginalTileJobs = -1;
+
+	// most tile tasks seen during the rebuild, more than the dirty tiles means the whole mesh was rebuilt
+	int32 PeakTileTasks = 0;
+
+	TArray<FHeldArchitecture> HeldArchitecture;
+
+	// where released architecture stands while its tiles build
+	TArray<FBox> RebuildingBounds;
+
+	// surface indices checked since the navigation mesh last changed
+	// a search in flight keeps its own reference, so a new check never changes what it reads
+	struct FCheckedSurfaceIndex
+	{
+		TWeakObjectPtr<const UTeleportSurfaceIndex> Index;
+		TSharedPtr<const FTeleportSurfaceValidity, ESPMode::ThreadSafe> Validity;
+	};
+	TArray<FCheckedSurfaceIndex> CheckedSurfaceIndices;
+
+	UFUNCTION()
+	void OnNavigationGenerated(ANavigationData *NavData);
+
+	// tiles touched by the moves since the last rebuild, as (x, y) tile coordinates
+	TSet<FIntPoint> DirtyTiles;
+
+	ARecastNavMesh *GetNavMesh() const;
+
+	void AddDirtyTiles(const FBox &Bounds);
+
+	// put the held architecture back into the navigation octree and start timing the rebuild
+	void ReleaseHeld();
+
+	// choose the number of tile jobs for this frame
+	void UpdateTileJobs();
+
+	// give the navigation mesh its own job count back
+	void RestoreTileJobs();
+
+	// true if the VR character of the local player does less than its full work to keep its frame budget
+	bool IsFrameBudgetDegraded() const;
+};
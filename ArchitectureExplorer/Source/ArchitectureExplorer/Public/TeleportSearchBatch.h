@@ -0,0 +1,60 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Info.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "TeleportSearchBatch.generated.h"
+
+class AVRCharacter;
+struct FTeleportSearchJob;
+
+// Runs the teleport searches of all characters of a world as one batch
+//
+// For sessions with many VR characters: instead of every character tracing in its own
+// tick, characters in ETeleportSearchMode::Batch register here and this actor, which
+// ticks after all of them, traces the search jobs they set up in their tick on worker threads
+// (one pooled graph task per job, the game thread traces one itself). A job only writes
+// to itself, so the workers never touch a character. The rest
+// (navigation system queries, which are not thread safe, caches and moving the markers)
+// then runs for each character in turn on the game thread.
+//
+// There is one per world, spawned by the first character that needs it.
+UCLASS(NotPlaceable, Transient)
+class ARCHITECTUREEXPLORER_API ATeleportSearchBatch : public AInfo
+{
+	GENERATED_BODY()
+
+public:
+	ATeleportSearchBatch();
+
+	static ATeleportSearchBatch *FindOrSpawn(UWorld *World);
+
+	void RegisterCharacter(AVRCharacter *Character);
+	void UnregisterCharacter(AVRCharacter *Character);
+
+	virtual void Tick(float DeltaSeconds) override;
+
+	// game thread time of the last batch (parallel searches plus the serial part)
+	float GetLastBatchMilliseconds() const { return LastBatchMilliseconds; }
+
+	int32 GetNumCharacters() const { return Characters.Num(); }
+
+private:
+	// below this many characters the searches run on the game thread, a task costs more than it saves
+	UPROPERTY(EditAnywhere, Category = "Movement", meta = (ClampMin = "1"))
+	int32 MinParallelSearches = 2;
+
+	UPROPERTY()
+	TArray<AVRCharacter *> Characters;
+
+	// characters that ticked this frame and their jobs to trace; reused every frame
+	TArray<AVRCharacter *> FrameCharacters;
+	TArray<FTeleportSearchJob *> FrameJobs;
+
+	// the graph tasks tracing FrameJobs; reused every frame
+	FGraphEventArray FrameTraceTasks;
+
+	float LastBatchMilliseconds = 0.0f;
+};
@@ -0,0 +1,73 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "TeleportSearchComponent.generated.h"
+
+class UTeleportSearchComponent;
+
+// second tick of UTeleportSearchComponent
+// runs on the game thread after the search and moves the destination marker
+USTRUCT()
+struct FTeleportMarkerTickFunction : public FTickFunction
+{
+	GENERATED_USTRUCT_BODY()
+
+	UTeleportSearchComponent *Target = nullptr;
+
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef &MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override;
+};
+
+template<>
+struct TStructOpsTypeTraits<FTeleportMarkerTickFunction> : public TStructOpsTypeTraitsBase2<FTeleportMarkerTickFunction>
+{
+	enum
+	{
+		WithCopy = false
+	};
+};
+
+// Ticks the teleport destination search of its AVRCharacter
+//
+// The search runs in this component's tick group and at its tick interval (Component Tick
+// in the details panel) instead of inside the character tick. By default it runs on the game
+// thread and uses the async search of the character (bUseAsyncTeleportSearch). With
+// bSearchOnWorkerThread only the character's FTeleportSearchJob is traced on a worker thread,
+// overlapping other actors' ticks: the character sets the job up in its tick, and a second tick
+// function finishes it (navigation query if needed, caches, arc meshes, DestinationMarker) on
+// the game thread.
+//
+// The component always ticks after its character, so it sees the controller pose of this frame.
+UCLASS(ClassGroup = (VR), meta = (BlueprintSpawnableComponent))
+class ARCHITECTUREEXPLORER_API UTeleportSearchComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UTeleportSearchComponent();
+
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction *ThisTickFunction) override;
+
+	// called by FTeleportMarkerTickFunction
+	void TickMarker();
+
+	// true if the search runs here and not in the character tick
+	bool IsSearching() const;
+
+	// true if the search runs here and traces on a worker thread
+	bool IsSearchingOnWorkerThread() const { return IsSearching() && PrimaryComponentTick.bRunOnAnyThread; }
+
+protected:
+	virtual void RegisterComponentTickFunctions(bool bRegister) override;
+
+private:
+	// run the trace on a worker thread, off by default
+	// the async teleport search of the character is not used in this mode
+	UPROPERTY(EditAnywhere, Category = "Movement")
+	bool bSearchOnWorkerThread = false;
+
+	FTeleportMarkerTickFunction MarkerTickFunction;
+};
@@ -0,0 +1,192 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "TeleportArcTracer.h"
+
+class UWorld;
+class UTeleportSurfaceIndex;
+struct FTeleportSurfaceValidity;
+
+// result of one teleport destination search
+// the async search keeps the most recent one around so it can be reused the next frame(s)
+struct FTeleportSearchResult
+{
+	// true if the arc hit something that projects onto the navigation mesh
+	bool bFound = false;
+
+	// navigation mesh location of the destination (only valid if bFound)
+	FVector Location = FVector::ZeroVector;
+
+	// world time at which the controller pose for this search was sampled
+	// negative if no search has completed yet
+	float PoseTime = -1.0f;
+};
+
+// controller pose a teleport search was done for, together with what it found
+// most frames the controller barely moves, so we can reuse the result instead of tracing again
+struct FTeleportPoseCache
+{
+	bool bValid = false;
+
+	FVector ControllerLocation = FVector::ZeroVector;
+	FVector ControllerForward = FVector::ForwardVector;
+
+	// world time at which the search for this pose ran
+	float SearchTime = 0.0f;
+
+	FTeleportSearchResult Result;
+};
+
+// one arc of the teleport fan
+struct FTeleportFanCandidate
+{
+	FTeleportArcParams Arc;
+
+	// the budget ran out before this arc was traced
+	bool bSkipped = false;
+
+	bool bHit = false;
+	FVector HitLocation = FVector::ZeroVector;
+	float HitTime = 0.0f; // seconds along the arc
+	int32 NumQueries = 0;
+
+	// distance from the hit to where the player meant to go
+	float Distance = 0.0f; // centimeters
+
+	// trace Arc with Tracer, unless the clock is past DeadlineCycles (FPlatformTime::Cycles64), then mark it skipped
+	// any thread; touches nothing but this candidate, the tracer and the scene
+	void Trace(UWorld *World, const FCollisionQueryParams &QueryParams, FTeleportArcTracer &Tracer, uint64 DeadlineCycles);
+};
+
+// one teleport search of a character, split so that the arc trace can run on any thread
+//
+// The character fills in the inputs on the game thread (see AVRCharacter::BeginTeleportSearch),
+// Trace may then run anywhere and only writes to the job, and the character reads the job
+// back on the game thread (AVRCharacter::bFinishTeleportSearch), where it updates its stats,
+// caches, arc and marker. So nothing but the job changes while a trace is in flight.
+struct ARCHITECTUREEXPLORER_API FTeleportSearchJob
+{
+	// inputs, set on the game thread
+
+	UWorld *World = nullptr;
+	const FCollisionQueryParams *QueryParams = nullptr;
+
+	// only set if it matches the navigation mesh; it is not changed while a trace is in flight
+	// SurfaceValidity tells which of its cells are stale, the job keeps it alive until it is reset
+	const UTeleportSurfaceIndex *SurfaceIndex = nullptr;
+	TSharedPtr<const FTeleportSurfaceValidity, ESPMode::ThreadSafe> SurfaceValidity;
+	FVector ProjectionExtent = FVector::ZeroVector;
+
+	// controller pose the search is for
+	FVector ControllerLocation = FVector::ZeroVector;
+	FVector ControllerForward = FVector::ForwardVector;
+
+	// the arc to trace; the teleport fan searches around it
+	FTeleportArcParams Arc;
+
+	// begun and not finished yet
+	bool bPending = false;
+
+	// the result came from the pose cache, nothing to trace or store
+	bool bFromCache = false;
+
+	// the arc was already traced on the game thread (PredictProjectilePath or the old line trace)
+	bool bTraced = false;
+
+	// outputs, written by Trace (or on the game thread if bTraced was set there)
+
+	FTeleportSearchResult Result;
+
+	// whether the arc hit anything, where and when along the arc
+	bool bArcHit = false;
+	FVector HitLocation = FVector::ZeroVector;
+	float HitTime = 0.0f; // seconds
+
+	// the surface index found a destination, no navigation projection needed
+	bool bResolved = false;
+
+	// the surface index was asked and found nothing, the navigation projection can skip it
+	bool bSurfaceIndexMissed = false;
+
+	int32 NumQueries = 0;
+	float TraceMilliseconds = 0.0f;
+
+	// forget everything but the tracer's working arrays
+	void Reset();
+
+	// grow the tracer's working arrays, see FTeleportArcTracer::Reserve
+	void Reserve() { Tracer.Reserve(); }
+
+	// true if Trace still has something to do
+	bool bNeedsTrace() const { return bPending && !bFromCache && !bTraced; }
+
+	// trace the arc and look the hit up in the surface index
+	// any thread; touches nothing but this job and the scene
+	void Trace();
+
+private:
+	FTeleportArcTracer Tracer;
+};
+
+// traces one FTeleportSearchJob on a worker thread
+//
+// Unlike ParallelFor, which allocates its bookkeeping on every call, graph tasks and their
+// events come from the task graph's pools, so dispatching one does not allocate once the
+// pools have warmed up. The job must stay where it is until the returned event completed.
+class FTeleportSearchTraceTask
+{
+public:
+	explicit FTeleportSearchTraceTask(FTeleportSearchJob &InJob) : Job(InJob) {}
+
+	static FGraphEventRef Dispatch(FTeleportSearchJob &Job)
+	{
+		return TGraphTask<FTeleportSearchTraceTask>::CreateTask().ConstructAndDispatchWhenReady(Job);
+	}
+
+	static ENamedThreads::Type GetDesiredThread() { return ENamedThreads::AnyThread; }
+	static ESubsequentsMode::Type GetSubsequentsMode() { return ESubsequentsMode::TrackSubsequents; }
+	FORCEINLINE TStatId GetStatId() const { RETURN_QUICK_DECLARE_CYCLE_STAT(FTeleportSearchTraceTask, STATGROUP_TaskGraphTasks); }
+
+	void DoTask(ENamedThreads::Type CurrentThread, const FGraphEventRef &MyCompletionGraphEvent)
+	{
+		Job.Trace();
+	}
+
+private:
+	FTeleportSearchJob &Job;
+};
+
+// traces one arc of the teleport fan on a worker thread, see FTeleportFanCandidate::Trace
+// pooled like FTeleportSearchTraceTask; the candidate and tracer must stay where they are until the event completed
+class FTeleportFanTraceTask
+{
+public:
+	FTeleportFanTraceTask(FTeleportFanCandidate &InCandidate, FTeleportArcTracer &InTracer, UWorld *InWorld, const FCollisionQueryParams &InQueryParams, uint64 InDeadlineCycles)
+		: Candidate(InCandidate), Tracer(InTracer), World(InWorld), QueryParams(InQueryParams), DeadlineCycles(InDeadlineCycles)
+	{
+	}
+
+	static FGraphEventRef Dispatch(FTeleportFanCandidate &Candidate, FTeleportArcTracer &Tracer, UWorld *World, const FCollisionQueryParams &QueryParams, uint64 DeadlineCycles)
+	{
+		return TGraphTask<FTeleportFanTraceTask>::CreateTask().ConstructAndDispatchWhenReady(Candidate, Tracer, World, QueryParams, DeadlineCycles);
+	}
+
+	static ENamedThreads::Type GetDesiredThread() { return ENamedThreads::AnyThread; }
+	static ESubsequentsMode::Type GetSubsequentsMode() { return ESubsequentsMode::TrackSubsequents; }
+	FORCEINLINE TStatId GetStatId() const { RETURN_QUICK_DECLARE_CYCLE_STAT(FTeleportFanTraceTask, STATGROUP_TaskGraphTasks); }
+
+	void DoTask(ENamedThreads::Type CurrentThread, const FGraphEventRef &MyCompletionGraphEvent)
+	{
+		Candidate.Trace(World, QueryParams, Tracer, DeadlineCycles);
+	}
+
+private:
+	FTeleportFanCandidate &Candidate;
+	FTeleportArcTracer &Tracer;
+	UWorld *World;
+	const FCollisionQueryParams &QueryParams;
+	uint64 DeadlineCycles;
+};
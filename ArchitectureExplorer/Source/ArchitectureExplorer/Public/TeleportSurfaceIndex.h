@@ -0,0 +1,124 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "TeleportSurfaceIndex.generated.h"
+
+class ARecastNavMesh;
+
+// which cells of a UTeleportSurfaceIndex still match the navigation mesh, see UTeleportSurfaceIndex::Validate
+// computed on the game thread after the navigation mesh changed and never changed afterwards,
+// so searches on any thread can read it
+struct FTeleportSurfaceValidity
+{
+	// false if the bake does not fit the navigation mesh at all
+	bool bValid = false;
+
+	// navigation tiles that are different from the bake
+	int32 NumStaleTiles = 0;
+
+	// one bit per cell, set under the stale tiles; empty if there are none
+	TBitArray<> StaleCells;
+
+	bool bIsCellStale(int32 CellIndex) const { return (StaleCells.Num() > 0) && StaleCells[CellIndex]; }
+};
+
+// Baked teleportable surfaces of one map
+//
+// A uniform 2D grid over the navigation mesh. Every cell stores the heights of the
+// navigation mesh layers (floors) that cover the cell center, so looking up where a
+// hit point lands is an array index plus a scan over a handful of heights instead of
+// a navigation mesh query. Only the cell centers are known to be on the navigation
+// mesh, unless a layer covers all four corners of its cell too; so the exact hit point
+// is only returned for such fully covered cells, everywhere else the cell center.
+// If nothing is found the caller asks the navigation mesh, the grid may miss surfaces
+// smaller than a cell. Every navigation tile is baked with a checksum, so when some tiles
+// are rebuilt at runtime only the cells under them go back to the navigation mesh.
+//
+// The asset is created by the BakeTeleportSurfaces commandlet and stored next to the map
+// (see GetPackageNameForMap). All data lives in flat arrays so it loads as a few
+// contiguous blocks.
+UCLASS()
+class ARCHITECTUREEXPLORER_API UTeleportSurfaceIndex : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	// where the bake for a map is stored, e.g. /Game/MainMap -> /Game/TeleportSurfaces/MainMap_TeleportSurfaces
+	static FString GetPackageNameForMap(const FString &MapPackageName);
+
+	// checksum of the navigation mesh polygons: their vertices and flags
+	// if it differs from NavSignature the bake is stale and must not be used
+	static int32 ComputeNavSignature(const ARecastNavMesh &NavMesh);
+
+	// compare the tile checksums of the bake with NavMesh and mark the cells under the tiles that differ
+	// a bake without tile checksums is either valid or not as a whole
+	void Validate(const ARecastNavMesh &NavMesh, FTeleportSurfaceValidity &OutValidity) const;
+
+	// project Point straight down/up onto a convex polygon
+	// returns false if Point is not above/below the polygon; OutZ is the height of the polygon plane at Point
+	static bool bProjectOntoPolygon(const TArray<FVector> &PolyVerts, const FVector &Point, float &OutZ);
+
+	// rasterize the navigation mesh into the grid
+	// returns false if the navigation mesh has no polygons
+	bool bBake(const ARecastNavMesh &NavMesh, float InCellSize);
+
+	// find the teleportable surface closest to Location within Extent
+	// this looks at a bounded number of cells, so the cost does not depend on the size of the map
+	// returns false if the grid knows no surface there, which does not mean the navigation mesh has none
+	// cells that Validity marks as stale are skipped
+	bool bFindSurface(const FVector &Location, const FVector &Extent, FVector &OutLocation, const FTeleportSurfaceValidity *Validity = nullptr) const;
+
+	int32 GetNavSignature() const { return NavSignature; }
+
+private:
+	// minimum corner of the grid in world space
+	UPROPERTY(VisibleAnywhere, Category = "Teleport")
+	FVector2D Origin = FVector2D::ZeroVector;
+
+	UPROPERTY(VisibleAnywhere, Category = "Teleport")
+	float CellSize = 25.0f; // centimeters
+
+	UPROPERTY(VisibleAnywhere, Category = "Teleport")
+	int32 SizeX = 0;
+
+	UPROPERTY(VisibleAnywhere, Category = "Teleport")
+	int32 SizeY = 0;
+
+	// the heights of cell (X, Y) are LayerHeights[CellLayerStart[i]] to LayerHeights[CellLayerStart[i + 1] - 1]
+	// with i = Y * SizeX + X; CellLayerStart has one more entry than there are cells
+	UPROPERTY()
+	TArray<int32> CellLayerStart;
+
+	UPROPERTY()
+	TArray<float> LayerHeights;
+
+	// one per entry of LayerHeights: 1 if the layer covers the whole cell (all four corners), 0 if only its center
+	UPROPERTY()
+	TArray<uint8> LayerFullyCovered;
+
+	// ComputeNavSignature of the navigation mesh we were baked from
+	UPROPERTY(VisibleAnywhere, Category = "Teleport")
+	int32 NavSignature = 0;
+
+	// the navigation tiles we were baked from as (x, y, layer), with the checksum of each and its bounds
+	UPROPERTY()
+	TArray<FIntVector> TileCoords;
+
+	UPROPERTY()
+	TArray<int32> TileSignatures;
+
+	UPROPERTY()
+	TArray<FBox> TileBounds;
+
+	// get the heights of one cell and the index of the first one in LayerHeights, returns the number of heights
+	int32 GetCellLayers(int32 CellX, int32 CellY, const float *&OutHeights, int32 &OutFirstLayer) const;
+
+	// world space center of a cell at the given height
+	FVector GetCellCenter(int32 CellX, int32 CellY, float Z) const;
+
+	// mark the cells Bounds overlaps
+	void MarkStaleCells(const FBox &Bounds, FTeleportSurfaceValidity &OutValidity) const;
+};
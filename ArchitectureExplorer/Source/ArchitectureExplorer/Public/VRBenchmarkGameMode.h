@@ -0,0 +1,109 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/GameModeBase.h"
+#include "VRBenchmarkGameMode.generated.h"
+
+class AVRCharacter;
+class FJsonObject;
+struct FTeleportArcTracerComparison;
+
+// Headless benchmark of the VR character tick
+//
+// Spawns the VR character, drives its right controller through a fixed list of scripted
+// scenarios (sweeping arcs, aiming at walls, aiming across the navigation mesh edge,
+// teleporting), writes per-stage timings, query counts and heap allocations inside the measured
+// character stages (see FVRAllocationCounter) to a JSON file and compares them against a stored
+// baseline. The aiming scenarios must not allocate at all. After the scenarios the arc tracer
+// must still hit what PredictProjectilePath hits, and what both of them spent on those arcs
+// goes to the JSON file too.
+// Runs without a GPU or headset, e.g. on a Linux build agent:
+//
+//   UE4Editor ArchitectureExplorer.uproject /Game/MainMap?game=/Script/ArchitectureExplorer.VRBenchmarkGameMode
+//       -game -nullrhi -unattended -nosound -benchmark -fps=90
+//       [-VRBenchmarkOutput=<file>] [-VRBenchmarkBaseline=<file>] [-VRBenchmarkThreshold=0.15]
+//
+// the process exits when all scenarios are done; the exit code is non-zero if a stage regressed or a check failed
+UCLASS(config = Game)
+class ARCHITECTUREEXPLORER_API AVRBenchmarkGameMode : public AGameModeBase
+{
+	GENERATED_BODY()
+
+public:
+	AVRBenchmarkGameMode();
+
+	virtual void InitGame(const FString &MapName, const FString &Options, FString &ErrorMessage) override;
+
+	virtual void Tick(float DeltaSeconds) override;
+
+private:
+	// the character to benchmark, Blueprint child so it has its materials and curves
+	UPROPERTY(config, EditDefaultsOnly, Category = "Benchmark")
+	TSoftClassPtr<AVRCharacter> BenchmarkPawnClass;
+
+	// measured frames per scenario
+	// the character keeps the last 600 frames of stats, more than that only the last 600 count
+	UPROPERTY(config, EditDefaultsOnly, Category = "Benchmark")
+	int32 FramesPerScenario = 600;
+
+	// frames at the start of each scenario that are not measured (cache warm-up, streaming)
+	UPROPERTY(config, EditDefaultsOnly, Category = "Benchmark")
+	int32 WarmupFrames = 90;
+
+	// frames between two teleports in the teleport scenario
+	UPROPERTY(config, EditDefaultsOnly, Category = "Benchmark")
+	int32 TeleportIntervalFrames = 240;
+
+	// a stage regressed if its average got slower than the baseline by more than this fraction...
+	UPROPERTY(config, EditDefaultsOnly, Category = "Benchmark")
+	float RegressionThreshold = 0.15f;
+
+	// ...and by more than this absolute amount, so noise on tiny stages does not fail the run
+	UPROPERTY(config, EditDefaultsOnly, Category = "Benchmark")
+	float MinRegressionMilliseconds = 0.005f;
+
+	// count the allocations inside the character stages; any in an aiming scenario, or more than the baseline, fails the run
+	UPROPERTY(config, EditDefaultsOnly, Category = "Benchmark")
+	bool bCheckAllocations = true;
+
+	// how far the arc tracer hit may be from the PredictProjectilePath hit in the arc tracer check
+	UPROPERTY(config, EditDefaultsOnly, Category = "Benchmark")
+	float ArcTracerTolerance = 5.0f; // centimeters
+
+	FString OutputFilename;
+	FString BaselineFilename;
+
+	// scenario we are in and frame within it (including warm-up)
+	int32 ScenarioIndex = 0;
+	int32 ScenarioFrame = 0;
+
+	// FVRAllocationCounter at the end of the warm-up
+	uint64 ScenarioStartAllocations = 0;
+
+	// results of all finished scenarios
+	TSharedPtr<FJsonObject> Results;
+
+	// checks that failed, each one fails the run
+	int32 NumFailedChecks = 0;
+
+	AVRCharacter *GetBenchmarkCharacter() const;
+
+	// move the right controller (and teleport) for the current scenario frame
+	void DriveScenario(AVRCharacter &Character);
+
+	// add the stats of the finished scenario to Results
+	void RecordScenario(AVRCharacter &Character);
+
+	// trace a fixed set of arcs with the arc tracer and PredictProjectilePath
+	// OutTotal gets what each of them spent over all arcs
+	// returns the number of arcs on which they disagree
+	int32 CheckArcTracer(AVRCharacter &Character, FTeleportArcTracerComparison &OutTotal);
+
+	// write Results, compare with the baseline and quit
+	void FinishBenchmark();
+
+	// returns the number of regressed stages/counters/allocation counts
+	int32 CompareWithBaseline(const FJsonObject &Baseline) const;
+};
@@ -4,6 +4,18 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
+// exception to the forward declaration rule below: we store NavNodeRef, the search jobs,
+// the stats, the frame budget, the pose recorder and the network pose by value, so we need the full types;
+// the spline mesh header is for the ESplineMeshAxis property
+#include "AI/Navigation/NavigationTypes.h"
+#include "Components/SplineMeshComponent.h"
+#include "TeleportSearchJob.h"
+#include "TeleportClearanceCache.h"
+#include "VRCharacterStats.h"
+#include "VRFrameBudget.h"
+#include "VRPoseRecording.h"
+#include "VRNetPose.h"
+#include "VRViewCache.h"
 #include "VRCharacter.generated.h"
 
 // Forward declarations
@@ -18,8 +30,42 @@ class UPostProcessComponent;
 class UMaterialInterface;
 class UMaterialInstanceDynamic;
 class UCurveFloat;
+class UMaterialParameterCollection;
 class UMotionControllerComponent;
-struct FTimerHandle;
+class UTeleportSurfaceIndex;
+class UTeleportSearchComponent;
+class UTeleportLateLatchComponent;
+class AArchitectureSignificanceManager;
+class ATeleportSearchBatch;
+class ATeleportNavigationUpdater;
+class ULevelStreaming;
+class UPackage;
+class ANavigationData;
+class USplineMeshComponent;
+class UStaticMesh;
+
+// where the teleport search of a character runs
+UENUM()
+enum class ETeleportSearchMode : uint8
+{
+	// inside the character tick
+	CharacterTick,
+	// in the character's UTeleportSearchComponent, in its own tick group
+	Component,
+	// together with all other characters of the world in ATeleportSearchBatch
+	Batch,
+};
+
+// where a teleport is, from BeginTeleport until the fade in starts
+UENUM()
+enum class ETeleportState : uint8
+{
+	None,
+	// the camera fades to black at the old location
+	FadingOut,
+	// we are at the destination, the screen stays black until it has loaded
+	WaitingForDestination,
+};
 
 UCLASS()
 class ARCHITECTUREEXPLORER_API AVRCharacter : public ACharacter
@@ -36,10 +82,39 @@ public:
 	// Called to bind functionality to input
 	virtual void SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent) override;
 
+	// log min/avg/p99 of the tick stages and query counts (see vr.DumpCharacterStats)
+	void DumpStats(FOutputDevice &Ar) const;
+
+	FVRCharacterStats &GetCharacterStats() { return CharacterStats; }
+
+	const FVRFrameBudget &GetFrameBudget() const { return FrameBudget; }
+
+	// benchmarks switch the frame budget off so they always measure the full workload
+	void SetFrameBudgetEnabled(bool bEnabled) { FrameBudgetSettings.bEnabled = bEnabled; }
+
+	void SetTeleportSearchMode(ETeleportSearchMode Mode);
+	ETeleportSearchMode GetTeleportSearchMode() const { return TeleportSearchMode; }
+
+	UMotionControllerComponent *GetRightMotionController() const { return RightMotionControllerComponent; }
+
+	// same as pressing the teleport button, for benchmarks and scripted players
+	void PressTeleport() { OnTeleport(); }
+
+	// trace the arc launched from Start with LaunchVelocity with the arc tracer and with PredictProjectilePath
+	// returns false (and logs) if only one of them hits or the hits are more than Tolerance apart; game thread only
+	// OutComparison, if given, gets what each of them cost
+	bool bValidateTeleportArcTracer(const FVector &Start, const FVector &LaunchVelocity, float Tolerance, FTeleportArcTracerComparison *OutComparison = nullptr);
+
+	// view projections of this frame, for screen-space effects
+	// call Update on it first, it is only recomputed once per frame
+	FVRViewCache &GetViewCache() { return ViewCache; }
+
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Camera")
 	UCameraComponent *Camera = nullptr;
 
@@ -47,6 +122,7 @@ protected:
 	USceneComponent *VRRoot = nullptr;
 
 	// player input handlers
+	// while a pose replay runs, live input is ignored and the replay calls these instead
 	void OnMoveForward(float throttle);
 	void OnMoveRight(float throttle);
 	void OnTeleport();
@@ -59,6 +135,40 @@ private:
 	// when we walk around in our vr space, this will ensure the pawn location updates, too
 	void MovePawnToVRCamera();
 
+	// move the capsule and VRRoot in one transform update, so the components below
+	// are updated once instead of twice; when false, they are moved one after the other
+	UPROPERTY(EditAnywhere, Category = "Movement")
+	bool bBatchPlaySpaceReconciliation = true;
+
+	// camera movement below this is left for later frames, it adds up until it is worth moving the pawn
+	UPROPERTY(EditAnywhere, Category = "Movement", meta = (EditCondition = "bBatchPlaySpaceReconciliation", ClampMin = "0.0"))
+	float PlaySpaceDeadZone = 0.1f; // centimeters
+
+	// component transform updates the batched reconciliation saved, over the last full second
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly, Category = "Movement", meta = (AllowPrivateAccess = "true"))
+	int32 PlaySpaceUpdatesSavedPerSecond = 0;
+
+	// components moved along with the capsule and with VRRoot, counted in SetupPlaySpaceReconciliation
+	int32 NumCapsuleComponents = 0;
+	int32 NumVRRootComponents = 0;
+
+	int32 PlaySpaceUpdatesSaved = 0;
+	float PlaySpaceUpdatesSavedTime = 0.0f; // seconds
+
+	// called from BeginPlay
+	void SetupPlaySpaceReconciliation();
+
+	void CountPlaySpaceUpdatesSaved(int32 NumSaved);
+
+	// timings and query counts of the last frames
+	FVRCharacterStats CharacterStats;
+
+	// when frames run over budget, the teleport search and blinker updates are spread over several frames
+	UPROPERTY(EditAnywhere, Category = "Budget")
+	FVRFrameBudgetSettings FrameBudgetSettings;
+
+	FVRFrameBudget FrameBudget;
+
 /////////////////////
 // MOTION CONTROLLERS
 
@@ -70,6 +180,195 @@ private:
 	UPROPERTY(VisibleAnywhere, Category = "Controller")
 	UMotionControllerComponent *RightMotionControllerComponent = nullptr;
 
+/////////////////
+// POSE RECORDING
+public:
+	// record the tracked poses and input of every frame to Filename (see vr.RecordPoses)
+	// returns false if the file cannot be written
+	bool StartPoseRecording(const FString &Filename);
+	void StopPoseRecording();
+
+	// replay a recording made with StartPoseRecording (see vr.ReplayPoses)
+	// the camera and controllers follow the recording and live input is ignored until it ends
+	// for identical runs start the game with a fixed frame rate, e.g. -benchmark -fps=90
+	bool StartPoseReplay(const FString &Filename, bool bLoop);
+	void StopPoseReplay();
+
+	bool IsRecordingPoses() const { return PoseRecorder.IsRecording(); }
+	bool IsReplayingPoses() const { return PoseReplay.IsPlaying(); }
+
+private:
+	FVRPoseRecorder PoseRecorder;
+	FVRPoseReplay PoseReplay;
+
+	bool bLoopPoseReplay = false;
+
+	// true while the replay calls the input handlers, so they know the input is not live
+	bool bApplyingPoseReplayInput = false;
+
+	// input of this frame, filled by the input handlers which run before our Tick
+	FVRPoseFrame PendingPoseFrameInput;
+
+	// start a replay or recording given on the command line (-VRReplayPoses=, -VRRecordPoses=)
+	// called from BeginPlay
+	void SetupPoseRecording();
+
+	// move camera and controllers to the next recorded frame and replay its input
+	// called at the start of Tick
+	void ApplyPoseReplayFrame();
+
+	// write this frame's poses and input
+	// called at the start of Tick, before anything uses the poses
+	void RecordPoseFrame(float DeltaTime);
+
+	// true if live input should be dropped because a replay drives the character
+	bool bIgnoreLiveInput() const { return PoseReplay.IsPlaying() && !bApplyingPoseReplayInput; }
+
+//////////////
+// REPLICATION
+public:
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty> &OutLifetimeProps) const override;
+
+protected:
+	// another participant's character began a teleport to Destination, e.g. to fade out its avatar
+	// the teleporting player's screen fades out over FadeOutTime
+	UFUNCTION(BlueprintImplementableEvent, Category = "Replication")
+	void ReceiveRemoteTeleportBegin(FVector Destination, float FadeOutTime);
+
+	// and arrived there, its screen fades in over FadeInTime
+	UFUNCTION(BlueprintImplementableEvent, Category = "Replication")
+	void ReceiveRemoteTeleportFinish(FVector Location, float FadeInTime);
+
+private:
+	// the owning client sends its pose to the server at most this often, and only when it changed...
+	UPROPERTY(EditAnywhere, Category = "Replication", meta = (ClampMin = "1.0"))
+	float PoseSendRate = 45.0f; // per second
+
+	// ...or when it hasn't sent one for this long; pose updates are unreliable, so a lost last
+	// update before the player holds still would otherwise never be repaired
+	UPROPERTY(EditAnywhere, Category = "Replication", meta = (ClampMin = "0.0"))
+	float PoseKeyframeInterval = 1.0f; // seconds
+
+	// the server only moves a client as far as a teleport arc reaches from where the server has it,
+	// plus this much for the play space and the controller (see bValidateServerTeleport)
+	UPROPERTY(EditAnywhere, Category = "Replication", meta = (ClampMin = "0.0"))
+	float ServerTeleportRangeSlack = 200.0f; // centimeters
+
+	// the server replicates a character at MaxPoseNetUpdateFrequency while somebody is within
+	// PoseFullRateDistance of it, going down to MinPoseNetUpdateFrequency at PoseMinRateDistance;
+	// characters behind everybody who is close count as twice as far away
+	UPROPERTY(EditAnywhere, Category = "Replication", meta = (ClampMin = "1.0"))
+	float MaxPoseNetUpdateFrequency = 45.0f; // per second
+
+	UPROPERTY(EditAnywhere, Category = "Replication", meta = (ClampMin = "1.0"))
+	float MinPoseNetUpdateFrequency = 5.0f; // per second
+
+	UPROPERTY(EditAnywhere, Category = "Replication", meta = (ClampMin = "0.0"))
+	float PoseFullRateDistance = 1000.0f; // centimeters
+
+	UPROPERTY(EditAnywhere, Category = "Replication", meta = (ClampMin = "0.0"))
+	float PoseMinRateDistance = 4000.0f; // centimeters
+
+	// remote poses are blended from where they were to the newest one over this long
+	UPROPERTY(EditAnywhere, Category = "Replication", meta = (ClampMin = "0.0"))
+	float PoseInterpolationTime = 0.05f; // seconds
+
+	// how often pose updates went out and came in, over the last full second
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly, Category = "Replication", meta = (AllowPrivateAccess = "true"))
+	int32 PosesSentPerSecond = 0;
+
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly, Category = "Replication", meta = (AllowPrivateAccess = "true"))
+	int32 PosesReceivedPerSecond = 0;
+
+	// the pose of the owning client, for everybody else
+	UPROPERTY(ReplicatedUsing = OnRep_ReplicatedPose)
+	FVRReplicatedPose ReplicatedPose;
+
+	UPROPERTY(ReplicatedUsing = OnRep_TeleportEvent)
+	FVRTeleportEvent TeleportEvent;
+
+	UFUNCTION(Server, Unreliable, WithValidation)
+	void ServerUpdatePose(const FVRNetPose &Pose);
+
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerBeginTeleport(FVector_NetQuantize Destination);
+
+	// the server moves us there as well, so the movement replication agrees with us
+	// unless the location is out of reach or off the navigation mesh, then the movement correction pulls us back
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerFinishTeleport(FVector_NetQuantize Location);
+
+	// check a capsule Location a client teleported to: on the navigation mesh and within arc range of where we are
+	// OutLocation is Location snapped onto the navigation mesh; server only
+	bool bValidateServerTeleport(const FVector &Location, FVector &OutLocation) const;
+
+	UFUNCTION()
+	void OnRep_ReplicatedPose();
+
+	UFUNCTION()
+	void OnRep_TeleportEvent();
+
+	// true for characters somebody else controls over the network
+	// they show the replicated pose and run none of the local tracking, teleport search or blinker
+	bool bIsRemoteVRCharacter() const;
+
+	// what bIsRemoteVRCharacter was last frame; the controller may only be known a few frames after BeginPlay
+	bool bRemoteVRCharacter = false;
+
+	// switch the local-only components on or off when bIsRemoteVRCharacter changes
+	// returns bIsRemoteVRCharacter
+	bool bUpdateRemoteState();
+
+	// last pose we sent to the server (or replicated, on a listen server) and when
+	FVRNetPose LastSentPose;
+	float LastPoseSendTime = 0.0f; // seconds
+
+	// the pose blend of remote characters: from where the components were to the newest pose
+	FTransform RemotePoseFrom[3];
+	FTransform RemotePoseTo[3];
+	FVector RemoteVRRootFrom = FVector::ZeroVector;
+	FVector RemoteVRRootTo = FVector::ZeroVector;
+	float RemotePoseAlpha = 1.0f;
+
+	int32 PosesSent = 0;
+	int32 PosesReceived = 0;
+	float PoseCountTime = 0.0f; // seconds
+	float PoseRateUpdateTime = 0.0f; // seconds
+
+	// quantize our pose and send it, if PoseSendRate allows and it changed or PoseKeyframeInterval passed
+	// called at the end of Tick on the locally controlled character of a networked game
+	void SendPose();
+
+	// blend the camera, controllers and VRRoot towards the replicated pose and show the teleport aim
+	// called instead of the rest of Tick on remote characters
+	void ApplyReplicatedPose(float DeltaTime);
+
+	// scale NetUpdateFrequency by how close the nearest viewer is, about once a second
+	// server only
+	void UpdatePoseNetUpdateFrequency();
+
+	// tell the others that we begin or finished a teleport
+	void SendTeleportEvent(bool bArrived, const FVector &Location);
+
+	void CountPoseUpdates();
+
+///////////////
+// SIGNIFICANCE
+private:
+	// throttle the scene actors by what we look at and where we are about to teleport
+	// see AArchitectureSignificanceManager
+	UPROPERTY(EditAnywhere, Category = "Significance")
+	bool bDriveSignificance = true;
+
+	UPROPERTY()
+	AArchitectureSignificanceManager *SignificanceManager = nullptr;
+
+	// called from BeginPlay
+	void SetupSignificance();
+
+	// hand our camera and teleport destination to the manager, every tick of the local character
+	void UpdateSignificanceViewpoint();
+
 ////////////////////////
 // BLINKER FUNCTIONALITY
 protected:
@@ -88,6 +387,46 @@ private:
 	UPROPERTY(EditAnywhere, Category = "Blinker")
 	UCurveFloat *RadiusVsVelocity = nullptr;
 
+	// names of the blinker material parameters
+	// kept here so we don't build an FName from a string every frame
+	UPROPERTY(EditDefaultsOnly, Category = "Blinker")
+	FName BlinkerRadiusParameterName = TEXT("Radius");
+
+	UPROPERTY(EditDefaultsOnly, Category = "Blinker")
+	FName BlinkerCenterParameterName = TEXT("Center");
+
+	// push the left-eye center in RG and the right-eye center in BA of the Center parameter
+	// M_BlinkerMaterial only reads RG, so leave this off (mono center for both eyes) until the material picks the channels per eye
+	UPROPERTY(EditDefaultsOnly, Category = "Blinker")
+	bool bPerEyeBlinkerCenter = false;
+
+	// when set, the blinker parameters go to this collection instead of our material instance,
+	// for blinker materials (and other post process materials) that read them from there
+	// only the locally controlled character writes to it
+	UPROPERTY(EditAnywhere, Category = "Blinker")
+	UMaterialParameterCollection *BlinkerParameterCollection = nullptr;
+
+	// parameters are only pushed to the material when they changed by more than this,
+	// otherwise the material's uniform buffer is rebuilt every frame for nothing
+	UPROPERTY(EditAnywhere, Category = "Blinker", meta = (ClampMin = "0.0"))
+	float BlinkerRadiusTolerance = 0.002f;
+
+	UPROPERTY(EditAnywhere, Category = "Blinker", meta = (ClampMin = "0.0"))
+	float BlinkerCenterTolerance = 0.002f; // fraction of the screen
+
+	// RadiusVsVelocity sampled at evenly spaced speeds, filled in SetupBlinkerRadiusTable
+	static const int32 BlinkerRadiusTableSize = 64;
+	float BlinkerRadiusTable[BlinkerRadiusTableSize] = {};
+	float BlinkerRadiusTableMinSpeed = 0.0f; // centimeters per second
+	float BlinkerRadiusTableSpeedStep = 0.0f; // centimeters per second
+	bool bBlinkerRadiusTableValid = false;
+
+	// what we pushed last
+	float PushedBlinkerRadius = 0.0f;
+	FLinearColor PushedBlinkerCenter = FLinearColor::Transparent;
+	bool bBlinkerRadiusPushed = false;
+	bool bBlinkerCenterPushed = false;
+
 	// Setup the blinker postprocessing effect
 	//
 	// the blinker material type comes from Blueprint set via the BlinkerMaterialBase
@@ -95,6 +434,13 @@ private:
 	// at run-time. For example, we can adjust the radius depending on player movement.
 	void SetupBlinkerPostprocessingEffect();
 
+	// bake RadiusVsVelocity into BlinkerRadiusTable
+	// the curve is not evaluated after this, so changes to it at run-time need another call
+	void SetupBlinkerRadiusTable();
+
+	// RadiusVsVelocity at Speed, interpolated from BlinkerRadiusTable
+	float LookupBlinkerRadius(float Speed) const;
+
 	// calculate a new blinker radius based on my current velocity
 	// then update the blinker radius
 	//
@@ -103,11 +449,16 @@ private:
 
 	// calculate a new blinker center based on direction character moves
 	// do not update the blinker center in this function
-	FVector2D CalculateBlinkerCenter() const;
+	// the center is in 0..1 across the View, so each eye gets its own
+	FVector2D CalculateBlinkerCenter(EVRView View) const;
 
 	// update the blinker center (calls CalculateBlinkerCenter)
+	// the material gets the left eye (or mono) center in RG and the right eye center in BA
 	void UpdateBlinkerCenter();
 
+	// view projections of this frame, shared by everything that projects to the screen
+	FVRViewCache ViewCache;
+
 /////////////////////////
 // TELEPORT FUNCTIONALITY
 protected:
@@ -115,7 +466,39 @@ protected:
 	UPROPERTY(VisibleAnywhere, Category = "Movement")
 	UStaticMeshComponent *DestinationMarker = nullptr;
 
+	// runs the teleport search in its own tick group, see UTeleportSearchComponent
+	// if its tick is disabled, the search runs in our Tick as before
+	UPROPERTY(VisibleAnywhere, Category = "Movement")
+	UTeleportSearchComponent *TeleportSearchComponent = nullptr;
+
+public:
+	// entry points for UTeleportSearchComponent and ATeleportSearchBatch, game thread unless noted
+
+	// true if the batch should search for us this frame
+	bool bWantsTeleportSearchBatch() const;
+
+	// the job our Tick began, for the teleport search component or batch to trace on any thread
+	// null if there is nothing to trace this frame
+	FTeleportSearchJob *GetTeleportSearchJobToTrace() { return TeleportSearchJob.bNeedsTrace() ? &TeleportSearchJob : nullptr; }
+
+	// called by the teleport search component after our Tick if it searches on the game thread
+	void SearchTeleportDestination();
+
+	// called by the teleport search component or batch after the search or trace
+	// finishes a pending search job, moves the marker and closes the stats frame
+	void ApplyTeleportDestinationSearch();
+
 private:
+	// Batch is meant for sessions with many characters in one world
+	UPROPERTY(EditAnywhere, Category = "Movement")
+	ETeleportSearchMode TeleportSearchMode = ETeleportSearchMode::Component;
+
+	// the batch we are registered with in Batch mode
+	UPROPERTY(Transient)
+	ATeleportSearchBatch *TeleportSearchBatch = nullptr;
+
+	// frame of our last Tick in Batch mode; the batch skips us if we didn't tick this frame
+	uint64 TeleportSearchBatchFrame = 0;
 
 	UPROPERTY(EditAnywhere, Category = "Movement")
 	float MaxTeleportDistance_UNUSED = 1000.0f; // centimeters
@@ -135,29 +518,548 @@ private:
 	UPROPERTY(EditAnywhere, Category = "Movement")
 	float TeleportFadeIn = 1.0f; // seconds
 
+	// the screen stays black at the destination at least this long, even if everything is loaded
+	UPROPERTY(EditAnywhere, Category = "Movement", meta = (ClampMin = "0.0"))
+	float MinTeleportBlackTime = 0.1f; // seconds
+
+	// and at most this long, ready or not
+	UPROPERTY(EditAnywhere, Category = "Movement", meta = (ClampMin = "0.0"))
+	float MaxTeleportBlackTime = 2.0f; // seconds
+
+	// when false, the fade in starts right after MinTeleportBlackTime
+	UPROPERTY(EditAnywhere, Category = "Movement")
+	bool bWaitForTeleportDestination = true;
+
+	// how long the screen was black at the last destination, and how long the whole teleport took
+	// from BeginTeleport until the fade in started
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly, Category = "Movement", meta = (AllowPrivateAccess = "true"))
+	float LastTeleportBlackTime = 0.0f; // seconds
+
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly, Category = "Movement", meta = (AllowPrivateAccess = "true"))
+	float LastTeleportFadeTime = 0.0f; // seconds
+
+	// teleports that faded in at MaxTeleportBlackTime before the destination was ready
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly, Category = "Movement", meta = (AllowPrivateAccess = "true"))
+	int32 TeleportBlackTimeouts = 0;
+
+	// black screen time of the last teleports, summarized by vr.DumpCharacterStats
+	FVRStatHistory TeleportBlackTimeHistory;
+
+	ETeleportState TeleportState = ETeleportState::None;
+
+	// world time when the current state was entered and when the teleport began
+	float TeleportStateTime = 0.0f; // seconds
+	float TeleportBeginTime = 0.0f; // seconds
+
 	UPROPERTY(EditAnywhere, Category = "Movement")
 	FVector TeleportProjectionExtent = FVector(100.0f, 100.0f, 100.0f);
 
-	FTimerHandle TeleportFadeTimerHandle;
+	// when true, the arc is traced on a worker thread and the result is used a frame later
+	// instead of blocking the game thread in PredictProjectilePath every tick
+	UPROPERTY(EditAnywhere, Category = "Movement")
+	bool bUseAsyncTeleportSearch = true;
+
+	// oldest async result we still show on the DestinationMarker
+	// if no completed result is younger than this, we fall back to the synchronous search
+	UPROPERTY(EditAnywhere, Category = "Movement", meta = (EditCondition = "bUseAsyncTeleportSearch", ClampMin = "0.0"))
+	float MaxAsyncTeleportResultAge = 0.05f; // seconds
+
+	// use our own arc tracer instead of UGameplayStatics::PredictProjectilePath
+	// PredictProjectilePath only runs on the game thread, so without the tracer every search traces there
+	UPROPERTY(EditAnywhere, Category = "Movement")
+	bool bUseTeleportArcTracer = true;
+
+	// trace the arc on the Teleport channel if the map went through UGenerateTeleportProxiesCommandlet
+	// the arc then hits the simple proxies instead of the render meshes; other maps use ECC_Visibility
+	UPROPERTY(EditAnywhere, Category = "Movement")
+	bool bUseTeleportProxies = true;
+
+	// channel the arc traces, decided in SetupTeleportScratch
+	ECollisionChannel TeleportArcChannel = ECollisionChannel::ECC_Visibility;
+
+	// how far a straight arc segment may stray from the real parabola
+	// bigger values mean fewer sweeps but a less exact hit point
+	UPROPERTY(EditAnywhere, Category = "Movement", meta = (ClampMin = "0.0"))
+	float TeleportArcMaxDeviation = 2.0f; // centimeters
+
+	// collision query parameters of all teleport traces, built once in SetupTeleportScratch
+	FCollisionQueryParams TeleportQueryParams;
+
+	// recast polygons never have more vertices than this
+	static const int32 MaxTeleportNavPolyVerts = 6;
+
+	// the async search: its job traces on a worker thread while the game thread carries on,
+	// AsyncTeleportSearchTask is set while that trace may still run
+	FTeleportSearchJob AsyncTeleportSearchJob;
+	FGraphEventRef AsyncTeleportSearchTask;
+
+	// most recent completed async search
+	FTeleportSearchResult LastAsyncTeleportResult;
+
+	// reuse the last teleport search while the right controller stays within these tolerances
+	UPROPERTY(EditAnywhere, Category = "Movement")
+	bool bUseTeleportPoseCache = true;
+
+	UPROPERTY(EditAnywhere, Category = "Movement", meta = (EditCondition = "bUseTeleportPoseCache", ClampMin = "0.0"))
+	float TeleportCacheLocationTolerance = 0.5f; // centimeters
+
+	UPROPERTY(EditAnywhere, Category = "Movement", meta = (EditCondition = "bUseTeleportPoseCache", ClampMin = "0.0"))
+	float TeleportCacheAngleTolerance = 0.25f; // degrees
+
+	// a cached result is thrown away after this long even if the controller did not move,
+	// so we notice geometry that moved under a still hand
+	UPROPERTY(EditAnywhere, Category = "Movement", meta = (EditCondition = "bUseTeleportPoseCache", ClampMin = "0.0"))
+	float MaxTeleportCacheAge = 0.5f; // seconds
+
+	// if the new hit lands inside the navigation polygon we found last time,
+	// compute the destination on that polygon instead of querying the navigation system again
+	UPROPERTY(EditAnywhere, Category = "Movement")
+	bool bReuseTeleportNavPoly = true;
+
+	FTeleportPoseCache TeleportPoseCache;
+
+	// baked teleportable surfaces of the map (see UBakeTeleportSurfacesCommandlet)
+	// when set, hit points are resolved against its cells that are up to date instead of the navigation system
+	// if not set, BeginPlay looks for the bake of the current map
+	UPROPERTY(EditAnywhere, Category = "Movement")
+	UTeleportSurfaceIndex *TeleportSurfaceIndex = nullptr;
+
+	UPROPERTY(EditAnywhere, Category = "Movement")
+	bool bUseTeleportSurfaceIndex = true;
+
+	// true if TeleportSurfaceIndex matches the navigation mesh, at least in part; updated when a search begins
+	bool bTeleportSurfaceIndexValid = false;
+
+	// which cells of TeleportSurfaceIndex are up to date, checked once per navigation change by
+	// ATeleportNavigationUpdater for all characters of the world
+	TSharedPtr<const FTeleportSurfaceValidity, ESPMode::ThreadSafe> TeleportSurfaceValidity;
+
+	// fetch TeleportSurfaceValidity and update bTeleportSurfaceIndexValid
+	void UpdateTeleportSurfaceValidity();
+
+	// navigation polygon of the last successful projection (empty if none)
+	NavNodeRef CachedNavPolyRef = INVALID_NAVNODEREF;
+	TArray<FVector> CachedNavPolyVerts;
+
+	// how well the caches work; reset with ResetTeleportCacheCounters
+	// ---
+	// hits: searches answered from the pose cache without tracing
+	// misses: searches that had to trace
+	// invalidations: cached results thrown away (too old, teleport, reset)
+	// nav poly reuses: navigation projections answered from the cached polygon
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly, Category = "Movement", meta = (AllowPrivateAccess = "true"))
+	int32 TeleportCacheHits = 0;
+
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly, Category = "Movement", meta = (AllowPrivateAccess = "true"))
+	int32 TeleportCacheMisses = 0;
+
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly, Category = "Movement", meta = (AllowPrivateAccess = "true"))
+	int32 TeleportCacheInvalidations = 0;
+
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly, Category = "Movement", meta = (AllowPrivateAccess = "true"))
+	int32 TeleportNavPolyReuses = 0;
 
 	// we don't teleport until after the fade-out completes
 	// this variable is used to remember where we want to teleport to
 	FVector TeleportLocation;
 
 	// project the teleport location down to the navigation mesh to avoid targets that are on walls
-	// returns true if navigation mesh point was found
+	// tries the baked surface index and the cached navigation polygon before the navigation system
+	// returns true if navigation mesh point was found; game thread only
 	bool bProjectTeleportToNavigation(FVector &OutLocation, FVector InLocation);
 
+	// bProjectTeleportToNavigation without the surface index: the cached navigation polygon, then the navigation system
+	bool bProjectTeleportToNavMesh(FVector &OutLocation, const FVector &InLocation);
+
+	// project InLocation with the navigation system and cache the polygon it lands on
+	// game thread only
+	bool bProjectTeleportWithNavigationSystem(FVector &OutLocation, const FVector &InLocation);
+
 	// do a line trace and project point to navigation mesh to find a teleport destination
+	// bLookupCache false skips the pose cache, for callers that already missed it for this pose
 	// returns true if found
-	bool bFindTeleportDestination(FVector &OutLocation);
+	bool bFindTeleportDestination(FVector &OutLocation, bool bLookupCache = true);
+
+	// the game thread part before the trace: controller pose, pose cache lookup (unless bLookupCache is false) and the arc
+	// the job is traced right away if we do not use the arc tracer, PredictProjectilePath needs the game thread
+	void BeginTeleportSearch(FTeleportSearchJob &Job, bool bLookupCache = true);
+
+	// the game thread part after FTeleportSearchJob::Trace: stats, arc shape, navigation projection,
+	// clearance, teleport fan and the pose cache
+	// returns true if a destination was found
+	bool bFinishTeleportSearch(FTeleportSearchJob &Job, FVector &OutLocation);
+
+	bool bIsTeleportInProgress() const;
+
+	// the synchronous search, and the one the teleport search component or batch traces on a worker thread
+	// between our Tick and ApplyTeleportDestinationSearch
+	FTeleportSearchJob TeleportSearchJob;
+
+	// sampled in Tick, so the search component and batch don't have to look at the teleport state
+	bool bTeleportInProgressThisFrame = false;
+
+	// false if the frame budget skips the teleport search this frame
+	bool bTeleportSearchThisFrame = true;
+
+	// on frames without a search the marker keeps moving the way it moved between the last two searches,
+	// for at most this long
+	UPROPERTY(EditAnywhere, Category = "Movement", meta = (ClampMin = "0.0"))
+	float MaxTeleportMarkerExtrapolation = 0.05f; // seconds
+
+	// last destination shown and how fast it moved
+	bool bLastTeleportDestinationFound = false;
+	FVector LastTeleportDestination = FVector::ZeroVector;
+	FVector TeleportDestinationVelocity = FVector::ZeroVector; // centimeters per second
+	float LastTeleportDestinationTime = 0.0f; // seconds
+
+	// used instead of MoveDestinationMarkerByLineTrace on frames the frame budget skips the search
+	// keeps the async search alive and extrapolates the marker
+	void SkipTeleportSearch();
+
+	// true if the teleport search component runs the search this frame instead of our Tick
+	bool bUsesTeleportSearchComponent() const;
+
+	// begin TeleportSearchJob in our Tick when the teleport search component or batch traces it on a worker thread
+	void PrepareTeleportSearchJob();
+
+	// async variant of bFindTeleportDestination
+	// finishes the search started last frame if its trace is done, starts one for this frame's controller pose
+	// and returns the most recent completed result if it is not older than MaxAsyncTeleportResultAge,
+	// otherwise it falls back to bFindTeleportDestination
+	bool bFindTeleportDestinationAsync(FVector &OutLocation);
+
+	// where the teleport arc starts and how fast it is launched from the right controller
+	// returns false if we have no controller
+	bool bGetTeleportArcLaunch(FVector &OutStart, FVector &OutVelocity) const;
+
+	// arc parameters for the arc tracer from our teleport settings
+	FTeleportArcParams MakeTeleportArcParams(const FVector &Start, const FVector &LaunchVelocity) const;
+
+	// begin AsyncTeleportSearchJob for the current controller pose and dispatch its trace
+	// does nothing while the last one is still pending
+	// returns true if it looked the current pose up in the pose cache
+	bool bIssueAsyncTeleportSearch();
+
+	// finish AsyncTeleportSearchJob and update LastAsyncTeleportResult, if its trace is done
+	// never waits for the trace
+	void CollectAsyncTeleportSearch();
+
+	// wait for the trace in flight, if any, and forget it and the completed async results
+	void ResetAsyncTeleportSearch();
+
+	// returns true and fills OutResult if the cached search is still good for the given controller pose
+	// counts a hit, a miss or an invalidation
+	bool bLookupTeleportPoseCache(FTeleportSearchResult &OutResult, const FVector &ControllerLocation, const FVector &ControllerForward);
+
+	// remember the result of a search that was done for the given controller pose
+	void StoreTeleportPoseCache(const FTeleportSearchResult &Result, const FVector &ControllerLocation, const FVector &ControllerForward);
+
+	// build the reusable query parameters and reserve the working arrays of the teleport search
+	// called from BeginPlay
+	void SetupTeleportScratch();
+
+	// find the baked surface index for this map, ATeleportNavigationUpdater checks which parts are stale
+	// called from BeginPlay
+	void SetupTeleportSurfaceIndex();
+
+	// the navigation mesh may change at runtime (see ATeleportNavigationUpdater)
+	// called from BeginPlay
+	void SetupNavigationUpdates();
+
+	// knows where moved architecture stands before the navigation mesh does
+	UPROPERTY()
+	ATeleportNavigationUpdater *NavigationUpdater = nullptr;
+
+	// true if Location is on navigation that architecture moved onto and which isn't rebuilt yet
+	bool bInsideMovingArchitecture(const FVector &Location) const;
+
+	// tiles were rebuilt: our cached polygon may be gone and the baked index may not match there
+	UFUNCTION()
+	void OnNavigationGenerated(ANavigationData *NavData);
+
+	// throw away the pose cache and the cached navigation polygon
+	void InvalidateTeleportCaches();
+
+	// project InLocation onto the cached navigation polygon
+	// returns false if InLocation is not above/below that polygon within TeleportProjectionExtent
+	bool bProjectToCachedNavPoly(FVector &OutLocation, const FVector &InLocation) const;
+
+public:
+	// zero the teleport cache hit/miss/invalidation counters, e.g. before a walkthrough
+	UFUNCTION(BlueprintCallable, Category = "Movement")
+	void ResetTeleportCacheCounters();
+
+private:
 
 	// move the DestinationMarker to the first hit of a linetrace
 	// this is called every tick
 	void MoveDestinationMarkerByLineTrace();
 
+	// show the arc and DestinationMarker at Location, or hide both
+	void ShowTeleportDestination(bool bFound, const FVector &Location);
+
+/////////////////
+// TELEPORT FAN
+private:
+	// when the arc finds no destination (it hit a wall or just missed the navigation mesh),
+	// trace a fan of arcs around it and take the best destination they find
+	UPROPERTY(EditAnywhere, Category = "Movement")
+	bool bUseTeleportFan = true;
+
+	// arcs in the fan, spread evenly on a cone around the pointing direction
+	UPROPERTY(EditAnywhere, Category = "Movement", meta = (EditCondition = "bUseTeleportFan", ClampMin = "1", ClampMax = "32"))
+	int32 TeleportFanSize = 8;
+
+	// half angle of that cone
+	UPROPERTY(EditAnywhere, Category = "Movement", meta = (EditCondition = "bUseTeleportFan", ClampMin = "0.0", ClampMax = "45.0"))
+	float TeleportFanAngle = 8.0f; // degrees
+
+	// once the fan took this long, it starts no more traces or projections and the best destination so far wins
+	UPROPERTY(EditAnywhere, Category = "Movement", meta = (EditCondition = "bUseTeleportFan", ClampMin = "0.0"))
+	float TeleportFanBudget = 0.5f; // milliseconds
+
+	// candidates are scored by their distance to where the arc hit (or would have been when the candidate hit),
+	// plus this if our capsule doesn't fit there (unless bValidateTeleportClearance rules it out); lowest score wins
+	UPROPERTY(EditAnywhere, Category = "Movement", meta = (EditCondition = "bUseTeleportFan", ClampMin = "0.0"))
+	float TeleportFanBlockedPenalty = 200.0f; // centimeters
+
+	// how the fan does; reset with ResetTeleportCacheCounters
+	// ---
+	// searches: times the arc failed and the fan ran
+	// hits: fan searches that found a destination
+	// over budget: fan searches that ran out of time before evaluating every candidate
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly, Category = "Movement", meta = (AllowPrivateAccess = "true"))
+	int32 TeleportFanSearches = 0;
+
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly, Category = "Movement", meta = (AllowPrivateAccess = "true"))
+	int32 TeleportFanHits = 0;
+
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly, Category = "Movement", meta = (AllowPrivateAccess = "true"))
+	int32 TeleportFanOverBudget = 0;
+
+	// game thread time of the last fan searches, summarized by vr.DumpCharacterStats
+	FVRStatHistory TeleportFanMilliseconds;
+
+	// the candidates are traced in parallel, one tracer each; sized in SetupTeleportScratch
+	TArray<FTeleportArcTracer> TeleportFanTracers;
+	TArray<FTeleportFanCandidate> TeleportFanCandidates;
+	FGraphEventArray TeleportFanTasks;
+
+	// trace the fan around IntendedArc, project the hits to navigation and pick the best one
+	// IntendedHit is where IntendedArc hit, if bIntendedHit
+	// game thread only, the projections may query the navigation system
+	bool bSearchTeleportFan(const FTeleportArcParams &IntendedArc, bool bIntendedHit, const FVector &IntendedHit, FVector &OutLocation);
+
+	// true if our capsule fits standing at Location
+	// answered from TeleportClearanceCache whenever possible
+	bool bHasTeleportClearance(const FVector &Location);
+
+	// only offer destinations our capsule fits into; the fan then looks for one next to a blocked one
+	UPROPERTY(EditAnywhere, Category = "Movement")
+	bool bValidateTeleportClearance = true;
+
+	// grid cell size of the clearance cache
+	// every cell is tested as a whole, so bigger cells keep a bit more distance from walls
+	UPROPERTY(EditAnywhere, Category = "Movement", meta = (EditCondition = "bValidateTeleportClearance", ClampMin = "1.0"))
+	float TeleportClearanceCellSize = 10.0f; // centimeters
+
+	// movable objects within this distance of a tested cell are watched and the cell is tested again if they move
+	UPROPERTY(EditAnywhere, Category = "Movement", meta = (EditCondition = "bValidateTeleportClearance", ClampMin = "0.0"))
+	float TeleportClearanceWatchDistance = 50.0f; // centimeters
+
+	// anything else (e.g. a level streaming in) is picked up after this long
+	UPROPERTY(EditAnywhere, Category = "Movement", meta = (EditCondition = "bValidateTeleportClearance", ClampMin = "0.0"))
+	float MaxTeleportClearanceAge = 10.0f; // seconds
+
+	// how well the clearance cache works; reset with ResetTeleportCacheCounters
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly, Category = "Movement", meta = (AllowPrivateAccess = "true"))
+	int32 TeleportClearanceHits = 0;
+
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly, Category = "Movement", meta = (AllowPrivateAccess = "true"))
+	int32 TeleportClearanceMisses = 0;
+
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly, Category = "Movement", meta = (AllowPrivateAccess = "true"))
+	int32 TeleportClearanceInvalidations = 0;
+
+	FTeleportClearanceCache TeleportClearanceCache;
+
+/////////////////////
+// TELEPORT PREFETCH
+private:
+	// start loading the destination as soon as the marker rests on it for PrefetchDwellTime,
+	// and at the latest when the teleport begins, so the fade-out hides the loading
+	UPROPERTY(EditAnywhere, Category = "Movement")
+	bool bPrefetchTeleportDestination = true;
+
+	UPROPERTY(EditAnywhere, Category = "Movement", meta = (EditCondition = "bPrefetchTeleportDestination", ClampMin = "0.0"))
+	float PrefetchDwellTime = 0.3f; // seconds
+
+	// the marker counts as resting while it stays within this distance
+	UPROPERTY(EditAnywhere, Category = "Movement", meta = (EditCondition = "bPrefetchTeleportDestination", ClampMin = "0.0"))
+	float PrefetchDwellRadius = 50.0f; // centimeters
+
+	// streaming levels whose streaming volumes are within this distance of the destination are loaded
+	UPROPERTY(EditAnywhere, Category = "Movement", meta = (EditCondition = "bPrefetchTeleportDestination", ClampMin = "0.0"))
+	float PrefetchLevelRadius = 500.0f; // centimeters
+
+	// how long the texture streamer treats the destination like a second camera
+	// also how long prefetched levels are kept in memory if we don't go there
+	UPROPERTY(EditAnywhere, Category = "Movement", meta = (EditCondition = "bPrefetchTeleportDestination", ClampMin = "0.0"))
+	float PrefetchHoldTime = 5.0f; // seconds
+
+	// how the last teleport went: prefetched levels, how many of them had loaded by FinishTeleport,
+	// their average load progress then and texture requests still waiting
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly, Category = "Movement", meta = (AllowPrivateAccess = "true"))
+	int32 LastTeleportPrefetchLevels = 0;
+
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly, Category = "Movement", meta = (AllowPrivateAccess = "true"))
+	int32 LastTeleportPrefetchLevelsReady = 0;
+
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly, Category = "Movement", meta = (AllowPrivateAccess = "true"))
+	float LastTeleportPrefetchCompletion = 0.0f; // percent
+
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly, Category = "Movement", meta = (AllowPrivateAccess = "true"))
+	int32 LastTeleportPrefetchTexturesPending = 0;
+
+	// level packages we loaded ahead of time; the references keep them from being collected
+	// until the level streaming picks them up or PrefetchHoldTime runs out without the marker resting there
+	UPROPERTY(Transient)
+	TArray<UPackage *> PrefetchedPackages;
+
+	// streaming levels at the current prefetch location
+	TArray<TWeakObjectPtr<ULevelStreaming>> PrefetchLevels;
+
+	// packages of PrefetchLevels we asked LoadPackageAsync for
+	TArray<FName> PrefetchPackageNames;
+
+	bool bPrefetchActive = false;
+	FVector PrefetchLocation = FVector::ZeroVector;
+	float PrefetchTime = 0.0f; // seconds
+
+	// where the marker started resting and when
+	FVector PrefetchDwellLocation = FVector(BIG_NUMBER);
+	float PrefetchDwellStartTime = 0.0f; // seconds
+
+	// called whenever the marker moves; starts a prefetch once it rests
+	void UpdateTeleportPrefetchDwell(bool bDestinationFound, const FVector &Location);
+
+	// request the streaming levels and textures around Location
+	// does nothing if we are already prefetching there; levels we already prefetch are not requested again,
+	// the packages of levels no longer around Location are let go
+	void StartTeleportPrefetch(const FVector &Location);
+
+	// true if PackageName is the package of one of PrefetchLevels
+	bool bIsPrefetchLevelPackage(const FName &PackageName) const;
+
+	// measure how far the prefetch got, called from FinishTeleport
+	void ReportTeleportPrefetch();
+
+	// forget prefetched packages nobody went to
+	void ReleaseTeleportPrefetch();
+
+	void OnPrefetchPackageLoaded(const FName &PackageName, UPackage *LoadedPackage, EAsyncLoadingResult::Type Result);
+
+/////////////////////
+// TELEPORT ARC
+protected:
+	// pool of meshes that draw the teleport arc, created once in the constructor
+	// they are attached to the right controller, so the arc follows the hand
+	UPROPERTY(VisibleAnywhere, Category = "Movement")
+	TArray<USplineMeshComponent *> TeleportArcMeshPool;
+
+	// moves the arc and the marker to a late controller pose just before rendering
+	UPROPERTY(VisibleAnywhere, Category = "Movement")
+	UTeleportLateLatchComponent *TeleportLateLatchComponent = nullptr;
+
+public:
+	// called by UTeleportLateLatchComponent at the end of the frame
+	void LateLatchTeleportDestination();
+
+private:
+	// mesh that is bent along each piece of the arc, the engine's cylinder unless the blueprint sets another one
+	UPROPERTY(EditDefaultsOnly, Category = "Movement")
+	UStaticMesh *TeleportArcMesh = nullptr;
+
+	// axis of TeleportArcMesh that points along the arc
+	UPROPERTY(EditDefaultsOnly, Category = "Movement")
+	TEnumAsByte<ESplineMeshAxis::Type> TeleportArcMeshAxis = ESplineMeshAxis::Z;
+
+	// scale of TeleportArcMesh across the arc; the cylinder is a meter wide
+	UPROPERTY(EditDefaultsOnly, Category = "Movement")
+	FVector2D TeleportArcMeshScale = FVector2D(0.03f, 0.03f);
+
+	// material for the arc meshes, M_SplineArcMat unless the blueprint sets another one
+	UPROPERTY(EditDefaultsOnly, Category = "Movement")
+	UMaterialInterface *TeleportArcMaterial = nullptr;
+
+	// how much arc time one mesh covers; longer arcs use more meshes of the pool
+	UPROPERTY(EditAnywhere, Category = "Movement", meta = (ClampMin = "0.01"))
+	float TeleportArcPieceTime = 0.1f; // seconds
+
+	// arc meshes are only re-bent if their ends or tangents moved more than this
+	// bending a spline mesh recreates its render state, which we don't want for sub-millimeter jitter
+	UPROPERTY(EditAnywhere, Category = "Movement", meta = (ClampMin = "0.0"))
+	float TeleportArcUpdateTolerance = 0.5f; // centimeters
+
+	// the arc of the last search that found a destination, from the launch point to the hit
+	// only searches write it; the late latch draws a moved copy, so its moves never add up
+	FTeleportArcParams TeleportArcShape;
+	float TeleportArcShapeEndTime = 0.0f; // seconds
+
+	// the arc meshes show a late-latched copy of TeleportArcShape
+	bool bTeleportArcLatched = false;
+
+	// where the latch put the marker and by how much it moved it; if nothing moved the marker since,
+	// the next latch starts from where it was before
+	FVector LatchedMarkerLocation = FVector::ZeroVector;
+	FVector LatchedMarkerCorrection = FVector::ZeroVector;
+
+	// re-bend the arc and shift the marker for the controller pose right before rendering
+	// the trace is not repeated, the landing point just moves along with the arc
+	// only what we see moves: teleporting still goes to the destination the last search found
+	UPROPERTY(EditAnywhere, Category = "Movement")
+	bool bLateLatchTeleportDestination = true;
+
+	// if the late pose would move the marker further than this, the traced destination is kept
+	// (it may be on a different surface by now, the next search will tell)
+	UPROPERTY(EditAnywhere, Category = "Movement", meta = (ClampMin = "0.0"))
+	float MaxTeleportLateLatchDistance = 30.0f; // centimeters
+
+	// how far the marker moved by the last late pose
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly, Category = "Movement", meta = (AllowPrivateAccess = "true"))
+	float LastTeleportLateLatchDistance = 0.0f; // centimeters
+
+	// draw a copy of TeleportArcShape moved to the late controller pose and shift the marker along
+	// returns false if there is nothing to latch or the late pose is too far off
+	bool bLateLatchTeleportArc();
+
+	// read the right controller pose from the device now, relative to VRRoot
+	// returns false if it isn't tracked
+	bool bPollRightControllerPose(FTransform &OutPose) const;
+
+	// give the arc meshes their mesh and material
+	// called from BeginPlay
+	void SetupTeleportArc();
+
+	// bend the arc meshes along TeleportArcShape and hide the ones we don't need
+	// if bShowArc is false, all of them are hidden
+	void UpdateTeleportArc(bool bShowArc) { DrawTeleportArc(bShowArc, TeleportArcShape, TeleportArcShapeEndTime); }
+
+	// same for any arc, from launch to EndTime
+	void DrawTeleportArc(bool bShowArc, const FTeleportArcParams &Shape, float EndTime);
+
 	// functions to begin and finish teleportation
 	// phasing in and out requires two separate steps
 	void BeginTeleport();
 	void FinishTeleport();
+
+	// move the teleport in progress along, called every tick
+	// FinishTeleport once the screen is black, FadeInTeleport once the destination is ready
+	void UpdateTeleport();
+
+	void FadeInTeleport(bool bDestinationReady);
+
+	// true if none of the levels and packages the prefetch requested is still loading or becoming visible
+	// (the precomputed visibility of a level comes with it, so visible levels have theirs)
+	bool bIsTeleportDestinationReady() const;
 };
@@ -0,0 +1,209 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "HAL/MemoryBase.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+
+class FOutputDevice;
+
+// stat VRCharacter shows where the character tick spends its time
+DECLARE_STATS_GROUP(TEXT("VRCharacter"), STATGROUP_VRCharacter, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("MovePawnToVRCamera"), STAT_VRCharacter_MovePawnToVRCamera, STATGROUP_VRCharacter, ARCHITECTUREEXPLORER_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("MoveDestinationMarkerByLineTrace"), STAT_VRCharacter_MoveDestinationMarkerByLineTrace, STATGROUP_VRCharacter, ARCHITECTUREEXPLORER_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("UpdateBlinkerRadius"), STAT_VRCharacter_UpdateBlinkerRadius, STATGROUP_VRCharacter, ARCHITECTUREEXPLORER_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("UpdateBlinkerCenter"), STAT_VRCharacter_UpdateBlinkerCenter, STATGROUP_VRCharacter, ARCHITECTUREEXPLORER_API);
+
+// part of MoveDestinationMarkerByLineTrace, only when the arc found nothing
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Teleport fan"), STAT_VRCharacter_TeleportFan, STATGROUP_VRCharacter, ARCHITECTUREEXPLORER_API);
+
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Physics queries"), STAT_VRCharacter_PhysicsQueries, STATGROUP_VRCharacter, ARCHITECTUREEXPLORER_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Navigation queries"), STAT_VRCharacter_NavQueries, STATGROUP_VRCharacter, ARCHITECTUREEXPLORER_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Transform updates saved"), STAT_VRCharacter_TransformUpdatesSaved, STATGROUP_VRCharacter, ARCHITECTUREEXPLORER_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Blinker parameter pushes"), STAT_VRCharacter_BlinkerParameterPushes, STATGROUP_VRCharacter, ARCHITECTUREEXPLORER_API);
+
+// see FVRFrameBudget
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Degradation level"), STAT_VRCharacter_DegradationLevel, STATGROUP_VRCharacter, ARCHITECTUREEXPLORER_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Skipped stages"), STAT_VRCharacter_SkippedStages, STATGROUP_VRCharacter, ARCHITECTUREEXPLORER_API);
+
+// how much of the destination prefetch had finished when the last teleport arrived
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Teleport prefetch levels"), STAT_VRCharacter_PrefetchLevels, STATGROUP_VRCharacter, ARCHITECTUREEXPLORER_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Teleport prefetch levels ready"), STAT_VRCharacter_PrefetchLevelsReady, STATGROUP_VRCharacter, ARCHITECTUREEXPLORER_API);
+DECLARE_FLOAT_ACCUMULATOR_STAT_EXTERN(TEXT("Teleport prefetch completion %"), STAT_VRCharacter_PrefetchCompletion, STATGROUP_VRCharacter, ARCHITECTUREEXPLORER_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Teleport textures pending"), STAT_VRCharacter_PrefetchTexturesPending, STATGROUP_VRCharacter, ARCHITECTUREEXPLORER_API);
+
+// how long the screen stayed black at the destination of the last teleport
+DECLARE_FLOAT_ACCUMULATOR_STAT_EXTERN(TEXT("Teleport black screen ms"), STAT_VRCharacter_TeleportBlackTime, STATGROUP_VRCharacter, ARCHITECTUREEXPLORER_API);
+
+// see ATeleportNavigationUpdater
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Navigation tiles dirtied"), STAT_VRCharacter_NavDirtyTiles, STATGROUP_VRCharacter, ARCHITECTUREEXPLORER_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Navigation tile tasks"), STAT_VRCharacter_NavTileTasks, STATGROUP_VRCharacter, ARCHITECTUREEXPLORER_API);
+DECLARE_FLOAT_ACCUMULATOR_STAT_EXTERN(TEXT("Navigation rebuild ms"), STAT_VRCharacter_NavRebuildTime, STATGROUP_VRCharacter, ARCHITECTUREEXPLORER_API);
+
+// pose updates the server wrote for other clients this frame, see FVRReplicatedPose
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Pose bytes sent"), STAT_VRCharacter_PoseBytesSent, STATGROUP_VRCharacter, ARCHITECTUREEXPLORER_API);
+
+// see AArchitectureSignificanceManager
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Significance"), STAT_VRCharacter_Significance, STATGROUP_VRCharacter, ARCHITECTUREEXPLORER_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Significance reduced actors"), STAT_VRCharacter_SignificanceReduced, STATGROUP_VRCharacter, ARCHITECTUREEXPLORER_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Significance minimal actors"), STAT_VRCharacter_SignificanceMinimal, STATGROUP_VRCharacter, ARCHITECTUREEXPLORER_API);
+DECLARE_FLOAT_ACCUMULATOR_STAT_EXTERN(TEXT("Significance ticks skipped"), STAT_VRCharacter_SignificanceSkippedTicks, STATGROUP_VRCharacter, ARCHITECTUREEXPLORER_API);
+DECLARE_FLOAT_ACCUMULATOR_STAT_EXTERN(TEXT("Significance game thread ms saved"), STAT_VRCharacter_SignificanceSaved, STATGROUP_VRCharacter, ARCHITECTUREEXPLORER_API);
+
+// how far the late controller pose moved the teleport marker this frame, see UTeleportLateLatchComponent
+DECLARE_FLOAT_ACCUMULATOR_STAT_EXTERN(TEXT("Late latch correction cm"), STAT_VRCharacter_LateLatchCorrection, STATGROUP_VRCharacter, ARCHITECTUREEXPLORER_API);
+
+// csvprofile captures get a VRCharacter category with the same stages and counters
+CSV_DECLARE_CATEGORY_MODULE_EXTERN(ARCHITECTUREEXPLORER_API, VRCharacter);
+
+// the parts of the character tick we measure
+enum class EVRCharacterStage : uint8
+{
+	MovePawnToVRCamera,
+	MoveDestinationMarkerByLineTrace,
+	UpdateBlinkerRadius,
+	UpdateBlinkerCenter,
+
+	Count
+};
+
+// the last few hundred values of one per-frame measurement
+class ARCHITECTUREEXPLORER_API FVRStatHistory
+{
+public:
+	FVRStatHistory();
+
+	void Add(float Value);
+
+	// forget all samples
+	void Reset();
+
+	// returns false if there are no samples yet
+	bool bGetSummary(float &OutMin, float &OutAverage, float &OutP99) const;
+
+private:
+	// samples are stored in a ring buffer that is allocated once
+	TArray<float> Samples;
+	int32 NextSample = 0;
+	int32 NumSamples = 0;
+};
+
+// counts the heap allocations the game thread makes inside the measured stages of the character tick
+//
+// Wraps GMalloc once installed and stays installed until exit, since memory allocated
+// through it may be freed at any time. Only the benchmark installs it (see AVRBenchmarkGameMode),
+// otherwise the stages just keep track of whether they are running.
+class ARCHITECTUREEXPLORER_API FVRAllocationCounter : public FMalloc
+{
+public:
+	// wrap GMalloc, does nothing if already installed
+	static void Install();
+	static bool IsInstalled() { return Instance != nullptr; }
+
+	// allocations counted so far, 0 if not installed
+	static uint64 GetNumAllocations();
+
+	// called by FVRCharacterStats::FScopedStage, stages may nest
+	static void EnterStage() { StageDepth++; }
+	static void LeaveStage() { StageDepth--; }
+
+	virtual void *Malloc(SIZE_T Count, uint32 Alignment) override;
+	virtual void *Realloc(void *Original, SIZE_T Count, uint32 Alignment) override;
+	virtual void Free(void *Original) override;
+	virtual SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment) override;
+	virtual bool GetAllocationSize(void *Original, SIZE_T &SizeOut) override;
+	virtual void Trim() override;
+	virtual void SetupTLSCachesOnCurrentThread() override;
+	virtual void ClearAndDisableTLSCachesOnCurrentThread() override;
+	virtual void InitializeStatsMetadata() override;
+	virtual void UpdateStats() override;
+	virtual void GetAllocatorStats(FGenericMemoryStats &OutStats) override;
+	virtual void DumpAllocatorStats(FOutputDevice &Ar) override;
+	virtual bool IsInternallyThreadSafe() const override;
+	virtual bool ValidateHeap() override;
+	virtual const TCHAR *GetDescriptiveName() override;
+
+private:
+	explicit FVRAllocationCounter(FMalloc *InInnerMalloc) : InnerMalloc(InInnerMalloc) {}
+
+	// only game thread allocations inside a stage count
+	void CountAllocation();
+
+	FMalloc *InnerMalloc;
+	uint64 NumAllocations = 0;
+
+	static FVRAllocationCounter *Instance;
+	// only touched on the game thread
+	static int32 StageDepth;
+};
+
+// per-character timings and query counts, summarized by the vr.DumpCharacterStats console command
+//
+// the timings also go to the stats system (stat VRCharacter) and the csv profiler,
+// the rolling history here works in every build configuration
+class ARCHITECTUREEXPLORER_API FVRCharacterStats
+{
+public:
+	// times one stage from construction to destruction
+	class FScopedStage
+	{
+	public:
+		FScopedStage(FVRCharacterStats &InStats, EVRCharacterStage InStage);
+		~FScopedStage();
+
+	private:
+		FVRCharacterStats &Stats;
+		EVRCharacterStage Stage;
+		uint64 StartCycles;
+	};
+
+	// call at the start and end of every character frame
+	// a frame that was not ended (e.g. the teleport search did not tick) is ended by the next BeginFrame
+	void BeginFrame();
+	void EndFrame();
+
+	// count physics queries (overlaps, sweeps, line traces) and navigation queries of this frame
+	void AddPhysicsQueries(int32 NumQueries);
+	void AddNavQueries(int32 NumQueries);
+
+	// add time a stage spent outside of its FScopedStage, e.g. in a job on a worker thread
+	// game thread only, like the scoped stages
+	void AddStageMilliseconds(EVRCharacterStage Stage, float Milliseconds);
+
+	// write min/avg/p99 of every stage and counter
+	void Dump(FOutputDevice &Ar, const FString &Title) const;
+
+	// forget the history, e.g. at the start of a benchmark run
+	void Reset();
+
+	static const TCHAR *GetStageName(EVRCharacterStage Stage);
+
+	const FVRStatHistory &GetStageHistory(EVRCharacterStage Stage) const { return StageMilliseconds[(int32)Stage]; }
+	const FVRStatHistory &GetPhysicsQueryHistory() const { return PhysicsQueries; }
+	const FVRStatHistory &GetNavQueryHistory() const { return NavQueries; }
+
+	// time of a stage in the last ended frame, 0 if it did not run
+	float GetLastFrameMilliseconds(EVRCharacterStage Stage) const { return LastFrameStageMilliseconds[(int32)Stage]; }
+
+private:
+	FVRStatHistory StageMilliseconds[(int32)EVRCharacterStage::Count];
+	FVRStatHistory PhysicsQueries;
+	FVRStatHistory NavQueries;
+
+	// stage times of the current frame (a stage may run more than once per frame)
+	float FrameStageMilliseconds[(int32)EVRCharacterStage::Count] = {};
+	float LastFrameStageMilliseconds[(int32)EVRCharacterStage::Count] = {};
+	int32 FramePhysicsQueries = 0;
+	int32 FrameNavQueries = 0;
+
+	bool bFrameOpen = false;
+};
+
+// time one stage of the character tick for stat VRCharacter, csvprofile and vr.DumpCharacterStats
+#define VRCHARACTER_SCOPED_STAGE(Stats, Stage) \
+	SCOPE_CYCLE_COUNTER(STAT_VRCharacter_##Stage); \
+	CSV_SCOPED_TIMING_STAT(VRCharacter, Stage); \
+	FVRCharacterStats::FScopedStage ScopedStage_##Stage(Stats, EVRCharacterStage::Stage)
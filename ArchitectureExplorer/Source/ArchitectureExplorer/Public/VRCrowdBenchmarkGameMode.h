@@ -0,0 +1,81 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/GameModeBase.h"
+#include "VRCharacterStats.h"
+#include "VRCrowdBenchmarkGameMode.generated.h"
+
+class AVRCharacter;
+class FJsonObject;
+
+// Headless benchmark of the teleport search with many VR characters in one world
+//
+// For 1, 2, 4 ... MaxPawns characters it measures the game thread time of all teleport
+// searches of a frame, once with every character searching in its own tick and once with
+// the searches batched in ATeleportSearchBatch. All characters sweep their arcs through
+// the room at the same time. Results go to a JSON file:
+//
+//   UE4Editor ArchitectureExplorer.uproject /Game/MainMap?game=/Script/ArchitectureExplorer.VRCrowdBenchmarkGameMode
+//       -game -nullrhi -unattended -nosound -benchmark -fps=90 [-VRBenchmarkOutput=<file>]
+UCLASS(config = Game)
+class ARCHITECTUREEXPLORER_API AVRCrowdBenchmarkGameMode : public AGameModeBase
+{
+	GENERATED_BODY()
+
+public:
+	AVRCrowdBenchmarkGameMode();
+
+	virtual void InitGame(const FString &MapName, const FString &Options, FString &ErrorMessage) override;
+
+	virtual void Tick(float DeltaSeconds) override;
+
+private:
+	UPROPERTY(config, EditDefaultsOnly, Category = "Benchmark")
+	TSoftClassPtr<AVRCharacter> BenchmarkPawnClass;
+
+	// the pawn count doubles from 1 up to this
+	UPROPERTY(config, EditDefaultsOnly, Category = "Benchmark")
+	int32 MaxPawns = 64;
+
+	UPROPERTY(config, EditDefaultsOnly, Category = "Benchmark")
+	int32 FramesPerStep = 300;
+
+	UPROPERTY(config, EditDefaultsOnly, Category = "Benchmark")
+	int32 WarmupFrames = 30;
+
+	// distance between the characters, they stand in a square grid around the player
+	UPROPERTY(config, EditDefaultsOnly, Category = "Benchmark")
+	float PawnSpacing = 120.0f; // centimeters
+
+	FString OutputFilename;
+
+	// all characters, the player's first
+	UPROPERTY()
+	TArray<AVRCharacter *> Pawns;
+
+	// step = pawn count and search mode
+	int32 NumPawns = 1;
+	bool bBatched = false;
+	int32 StepFrame = 0;
+	bool bFinished = false;
+
+	// game thread milliseconds of all teleport searches per frame in this step
+	FVRStatHistory SearchMilliseconds;
+
+	TSharedPtr<FJsonObject> Results;
+
+	// spawn characters until we have NumPawns and switch them all to the step's search mode
+	bool bSetupStep();
+
+	// aim every character's right controller for this frame
+	void DriveControllers();
+
+	// game thread time the teleport searches took last frame
+	float GetLastFrameSearchMilliseconds() const;
+
+	void RecordStep();
+
+	void FinishBenchmark();
+};
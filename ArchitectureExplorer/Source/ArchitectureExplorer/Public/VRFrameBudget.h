@@ -0,0 +1,98 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VRCharacterStats.h"
+#include "VRFrameBudget.generated.h"
+
+// how much of the character work we drop to stay within the frame budget
+// every level includes the savings of the levels below it
+UENUM()
+enum class EVRDegradationLevel : uint8
+{
+	// everything every frame
+	Full,
+	// blinker center every other frame
+	ReducedBlinker,
+	// teleport search every TraceInterval frames, the marker is extrapolated in between
+	ReducedTrace,
+	// teleport search every MinimalTraceInterval frames, blinker radius every other frame
+	Minimal,
+
+	Count UMETA(Hidden)
+};
+
+USTRUCT()
+struct FVRFrameBudgetSettings
+{
+	GENERATED_BODY()
+
+	// if false the character does all its work every frame
+	UPROPERTY(EditAnywhere, Category = "Budget")
+	bool bEnabled = true;
+
+	// a frame counts as over budget if the character stages together took longer than this
+	// only our own cost counts: a slow frame is as likely the GPU or another actor, and dropping
+	// our work would not help it
+	UPROPERTY(EditAnywhere, Category = "Budget", meta = (ClampMin = "0.0"))
+	float CharacterBudget = 1.0f; // milliseconds
+
+	// over budget frames in a row before we degrade one level
+	UPROPERTY(EditAnywhere, Category = "Budget", meta = (ClampMin = "1"))
+	int32 FramesToDegrade = 5;
+
+	// frames in a row with room for the full workload before we go back up one level
+	UPROPERTY(EditAnywhere, Category = "Budget", meta = (ClampMin = "1"))
+	int32 FramesToRecover = 90;
+
+	// teleport search interval of the ReducedTrace and Minimal levels
+	UPROPERTY(EditAnywhere, Category = "Budget", meta = (ClampMin = "1"))
+	int32 TraceInterval = 2; // frames
+
+	UPROPERTY(EditAnywhere, Category = "Budget", meta = (ClampMin = "1"))
+	int32 MinimalTraceInterval = 4; // frames
+};
+
+// Decides every frame which character stages run
+//
+// It watches what each stage costs when it runs. If the character keeps going over
+// CharacterBudget it steps down one EVRDegradationLevel at a time, and it only steps
+// back up when the full workload (from the measured stage costs) would fit again, so
+// it does not flip back and forth.
+//
+// The current level goes to stat VRCharacter, csvprofile and vr.DumpCharacterStats.
+class ARCHITECTUREEXPLORER_API FVRFrameBudget
+{
+public:
+	// call once at the start of every character frame, before any bShouldRun
+	// Stats holds the stage timings of the previous frame
+	void BeginFrame(const FVRFrameBudgetSettings &Settings, const FVRCharacterStats &Stats);
+
+	// true if Stage should do its work this frame
+	// MovePawnToVRCamera always runs, skipping it would let the pawn drift away from the headset
+	bool bShouldRun(EVRCharacterStage Stage);
+
+	EVRDegradationLevel GetLevel() const { return Level; }
+
+	// average cost of a stage over the frames it ran
+	float GetStageCost(EVRCharacterStage Stage) const { return StageCost[(int32)Stage]; }
+
+	static const TCHAR *GetLevelName(EVRDegradationLevel InLevel);
+
+private:
+	EVRDegradationLevel Level = EVRDegradationLevel::Full;
+
+	// moving averages
+	float StageCost[(int32)EVRCharacterStage::Count] = {}; // milliseconds
+
+	// which stages ran last frame; only those tell us something about their cost
+	bool bStageRan[(int32)EVRCharacterStage::Count] = {};
+
+	int32 FramesOverBudget = 0;
+	int32 FramesWithRoom = 0;
+
+	uint32 FrameNumber = 0;
+
+	int32 TraceInterval = 1;
+};
@@ -0,0 +1,89 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+// The math of the teleport arc, the blinker and the play space, in plain C++
+//
+// Nothing in here includes the engine, so it builds on its own and can be measured
+// outside the editor, see Tools/VRMathBench. The engine side converts with
+// VRMathCoreConversions.h. Units and conventions are the engine's: centimeters, Z up,
+// row vectors times matrices (like FMatrix), screen 0..1 with (0,0) top left.
+//
+// The batch versions take plain arrays and do the same math as the single versions
+// in simple loops without branches the compiler can't turn into selects, so they vectorize.
+
+#include <cstdint>
+
+namespace VRMathCore
+{
+	struct FVec2
+	{
+		float X;
+		float Y;
+	};
+
+	struct FVec3
+	{
+		float X;
+		float Y;
+		float Z;
+	};
+
+	// same layout as FMatrix: M[Row][Column], a location is transformed as (X, Y, Z, 1) * M
+	struct FMat4
+	{
+		float M[4][4];
+	};
+
+	struct FArcParams
+	{
+		FVec3 Start;
+		FVec3 LaunchVelocity; // centimeters per second
+		float GravityZ; // centimeters per second squared
+	};
+
+	//////
+	// ARC
+
+	FVec3 GetArcLocation(const FArcParams &Params, float Time);
+
+	FVec3 GetArcVelocity(const FArcParams &Params, float Time);
+
+	// when the arc comes down through height Z, no later than MaxTime
+	// returns false if it never gets that low or only on the way up
+	bool bGetArcTimeAtHeight(const FArcParams &Params, float Z, float MaxTime, float &OutTime);
+
+	// the part of gravity that bends the arc away from the direction of Velocity
+	float GetGravityAcross(float GravityZ, const FVec3 &Velocity);
+
+	// longest time step whose chord stays within MaxDeviation of the arc, clamped to MinTime..MaxTime
+	// a piece of duration dt strays at most GravityAcross * dt^2 / 8 from its chord
+	float GetSegmentTime(float GravityAcross, float MaxDeviation, float MinTime, float MaxTime);
+
+	// GetArcLocation for Count times, into separate X, Y and Z arrays
+	void GetArcLocations(const FArcParams &Params, const float *Times, int32_t Count, float *OutX, float *OutY, float *OutZ);
+
+	/////////////
+	// PROJECTION
+
+	// like FSceneView::ProjectWorldToScreen without the view rect
+	// returns false if Location is behind the view
+	bool bProject(const FMat4 &ViewProjection, const FVec3 &Location, FVec2 &OutScreen);
+
+	// bProject for Count locations, returns how many are in front of the view
+	// the ones behind get (0.5, 0.5) and 0 in OutInFront (if given)
+	int32_t Project(const FMat4 &ViewProjection, const FVec3 *Locations, int32_t Count, FVec2 *OutScreen, uint8_t *OutInFront = nullptr);
+
+	// where on screen the blinker opening goes: a point ahead along Velocity, or behind
+	// if we move backwards, so it stays in front of the camera
+	// returns false if we barely move or the point is behind the view, the caller centers it then
+	bool bGetBlinkerCenter(const FMat4 &ViewProjection, const FVec3 &CameraLocation, const FVec3 &CameraForward, const FVec3 &Velocity, FVec2 &OutCenter);
+
+	/////////////
+	// PLAY SPACE
+
+	// how far the camera walked away from the actor, horizontally
+	FVec3 GetPlaySpaceDelta(const FVec3 &CameraLocation, const FVec3 &ActorLocation);
+
+	bool bIsInDeadZone(const FVec3 &Delta, float DeadZone);
+}
@@ -0,0 +1,45 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VRMathCore.h"
+
+// engine types to VRMathCore and back
+// the layouts match, so arrays can be handed over without copying
+static_assert(sizeof(VRMathCore::FVec3) == sizeof(FVector), "VRMathCore::FVec3 has to match FVector");
+static_assert(sizeof(VRMathCore::FVec2) == sizeof(FVector2D), "VRMathCore::FVec2 has to match FVector2D");
+static_assert(sizeof(VRMathCore::FMat4) == sizeof(FMatrix), "VRMathCore::FMat4 has to match FMatrix");
+
+namespace VRMathCore
+{
+	inline FVec3 ToCore(const FVector &Vector)
+	{
+		return FVec3{ Vector.X, Vector.Y, Vector.Z };
+	}
+
+	inline FVector FromCore(const FVec3 &Vector)
+	{
+		return FVector(Vector.X, Vector.Y, Vector.Z);
+	}
+
+	inline FVector2D FromCore(const FVec2 &Vector)
+	{
+		return FVector2D(Vector.X, Vector.Y);
+	}
+
+	inline const FMat4 &ToCore(const FMatrix &Matrix)
+	{
+		return reinterpret_cast<const FMat4 &>(Matrix);
+	}
+
+	inline const FVec3 *ToCore(const FVector *Vectors)
+	{
+		return reinterpret_cast<const FVec3 *>(Vectors);
+	}
+
+	inline FVec2 *ToCore(FVector2D *Vectors)
+	{
+		return reinterpret_cast<FVec2 *>(Vectors);
+	}
+}
@@ -0,0 +1,83 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/GameModeBase.h"
+#include "VRCharacterStats.h"
+#include "VRNetBenchmarkGameMode.generated.h"
+
+class AVRCharacter;
+class FJsonObject;
+
+// Network bandwidth per client of the VR pose and teleport replication
+//
+// Start a dedicated server with this game mode and connect NumClients headless clients
+// that replay a pose recording (see vr.RecordPoses), all on one Linux machine:
+//
+//   UE4Editor ArchitectureExplorer.uproject /Game/MainMap?game=/Script/ArchitectureExplorer.VRNetBenchmarkGameMode
+//       -server -log -unattended -nosound [-VRNetBenchmarkClients=32] [-VRBenchmarkOutput=<file>]
+//
+//   for i in $(seq 32); do
+//     UE4Editor ArchitectureExplorer.uproject 127.0.0.1 -game -nullrhi -unattended -nosound
+//         -VRReplayPoses=<recording> -VRReplayPosesLoop -ExecCmds="t.MaxFPS 90" &
+//   done
+//
+// For a listen server, open the map with ?listen and -game instead of -server; its host
+// counts as a participant but not as a client. Once all clients are connected it waits
+// WarmupSeconds, then samples the bytes per second the server sends to and receives from
+// every client for MeasureSeconds, writes them to a JSON file and exits. The clients lose
+// their connection then and can be stopped.
+UCLASS(config = Game)
+class ARCHITECTUREEXPLORER_API AVRNetBenchmarkGameMode : public AGameModeBase
+{
+	GENERATED_BODY()
+
+public:
+	AVRNetBenchmarkGameMode();
+
+	virtual void InitGame(const FString &MapName, const FString &Options, FString &ErrorMessage) override;
+
+	virtual APawn *SpawnDefaultPawnAtTransform_Implementation(AController *NewPlayer, const FTransform &SpawnTransform) override;
+
+	virtual void Tick(float DeltaSeconds) override;
+
+private:
+	UPROPERTY(config, EditDefaultsOnly, Category = "Benchmark")
+	TSoftClassPtr<AVRCharacter> BenchmarkPawnClass;
+
+	// clients to wait for, -VRNetBenchmarkClients= overrides it
+	UPROPERTY(config, EditDefaultsOnly, Category = "Benchmark")
+	int32 NumClients = 32;
+
+	UPROPERTY(config, EditDefaultsOnly, Category = "Benchmark")
+	float WarmupSeconds = 10.0f;
+
+	UPROPERTY(config, EditDefaultsOnly, Category = "Benchmark")
+	float MeasureSeconds = 60.0f;
+
+	// participants stand in a square grid around the player start, this far apart
+	UPROPERTY(config, EditDefaultsOnly, Category = "Benchmark")
+	float PawnSpacing = 120.0f; // centimeters
+
+	FString OutputFilename;
+
+	int32 NumSpawnedPawns = 0;
+
+	// world time all clients were connected, negative until then
+	float StartTime = -1.0f;
+	float LastSampleTime = 0.0f;
+	bool bFinished = false;
+
+	// fewest clients connected while measuring
+	int32 MinConnectedClients = 0;
+
+	// one sample per second: bytes per second of the average and of the busiest client
+	FVRStatHistory AverageOutBytes;
+	FVRStatHistory MaxOutBytes;
+	FVRStatHistory AverageInBytes;
+
+	void SampleConnections();
+
+	void FinishBenchmark();
+};
@@ -0,0 +1,135 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/NetSerialization.h"
+#include "VRNetPose.generated.h"
+
+// one tracked transform, quantized for the network
+//
+// positions to 1/32 cm in 18 bits (+-40 m), rotations as the three smallest quaternion
+// components in 12 bits each plus the index of the largest (38 bits, about 0.05 degrees)
+struct FVRNetTransform
+{
+	int32 Position[3] = { 0, 0, 0 };
+	int32 Rotation[3] = { 0, 0, 0 };
+	uint8 LargestComponent = 3;
+
+	void Quantize(const FTransform &Transform);
+	FTransform Dequantize() const;
+
+	void Serialize(FArchive &Ar);
+
+	bool operator==(const FVRNetTransform &Other) const;
+	bool operator!=(const FVRNetTransform &Other) const { return !(*this == Other); }
+};
+
+// parts of FVRNetPose that are sent separately, as bits of a mask
+enum EVRNetPosePart : uint8
+{
+	VRNetPosePart_Camera = 1 << 0,
+	VRNetPosePart_LeftController = 1 << 1,
+	VRNetPosePart_RightController = 1 << 2,
+	VRNetPosePart_VRRoot = 1 << 3,
+	VRNetPosePart_TeleportAim = 1 << 4,
+
+	VRNetPosePart_All = (1 << 5) - 1,
+};
+
+// tracked poses of a VR character and where it aims its teleport, quantized for the network
+//
+// the tracked poses are relative to VRRoot and VRRoot is relative to the capsule, so the
+// pose stays small whatever the character's world location is; the capsule itself comes
+// with the usual movement replication
+USTRUCT()
+struct ARCHITECTUREEXPLORER_API FVRNetPose
+{
+	GENERATED_BODY()
+
+	FVRNetTransform Camera;
+	FVRNetTransform LeftController;
+	FVRNetTransform RightController;
+
+	// relative location of VRRoot, quantized like the tracked positions
+	int32 VRRootLocation[3] = { 0, 0, 0 };
+
+	// the teleport marker, if it is shown, in world space to 1/2 cm
+	bool bTeleportAiming = false;
+	int32 TeleportDestination[3] = { 0, 0, 0 };
+
+	// how long the arc flies until it reaches the marker, in 1/200 s
+	uint16 TeleportArcTime = 0;
+
+	void SetTrackedPoses(const FTransform &InCamera, const FTransform &InLeftController, const FTransform &InRightController, const FVector &InVRRootLocation);
+	void SetTeleportAim(bool bAiming, const FVector &Destination, float ArcTime);
+
+	FVector GetVRRootLocation() const;
+	FVector GetTeleportDestination() const;
+	float GetTeleportArcTime() const; // seconds
+
+	// parts that differ from Other, as EVRNetPoseParts
+	uint8 GetChangedParts(const FVRNetPose &Other) const;
+
+	// the mask of parts, then every part in it
+	// when loading, Parts is read from the archive and only those parts change
+	void Serialize(FArchive &Ar, uint8 &Parts);
+
+	// all parts, for the pose the owning client sends to the server
+	bool NetSerialize(FArchive &Ar, UPackageMap *Map, bool &bOutSuccess);
+
+	bool operator==(const FVRNetPose &Other) const { return GetChangedParts(Other) == 0; }
+};
+
+template<>
+struct TStructOpsTypeTraits<FVRNetPose> : public TStructOpsTypeTraitsBase2<FVRNetPose>
+{
+	enum
+	{
+		WithNetSerializer = true,
+		WithIdenticalViaEquality = true,
+	};
+};
+
+// FVRNetPose as the server replicates it to the other clients
+//
+// the engine keeps the last pose sent on every connection as its baseline; only the parts
+// that changed against it are sent, and nothing at all if the quantized pose did not change.
+// changed parts are sent whole, so a lost packet never leaves a client with a broken pose,
+// the engine just sends the parts again against the last acknowledged baseline
+USTRUCT()
+struct ARCHITECTUREEXPLORER_API FVRReplicatedPose
+{
+	GENERATED_BODY()
+
+	FVRNetPose Pose;
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo &DeltaParms);
+};
+
+template<>
+struct TStructOpsTypeTraits<FVRReplicatedPose> : public TStructOpsTypeTraitsBase2<FVRReplicatedPose>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true,
+	};
+};
+
+// the last teleport of a character, for the other clients
+USTRUCT()
+struct ARCHITECTUREEXPLORER_API FVRTeleportEvent
+{
+	GENERATED_BODY()
+
+	// counts up with every event, so two teleports to the same place still replicate
+	UPROPERTY()
+	uint8 Sequence = 0;
+
+	// false while fading out towards Location, true once arrived there
+	UPROPERTY()
+	bool bArrived = false;
+
+	UPROPERTY()
+	FVector_NetQuantize Location = FVector::ZeroVector;
+};
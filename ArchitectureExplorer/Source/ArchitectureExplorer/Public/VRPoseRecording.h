@@ -0,0 +1,101 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/UniquePtr.h"
+
+class IFileHandle;
+class IMappedFileHandle;
+class IMappedFileRegion;
+
+// tracked poses and input of one character frame
+//
+// poses are relative to the VR root, i.e. in tracking space, so a recording
+// replays the same way wherever the character stands
+struct FVRPoseFrame
+{
+	float DeltaTime = 0.0f; // seconds
+
+	FTransform Camera = FTransform::Identity;
+	FTransform LeftController = FTransform::Identity;
+	FTransform RightController = FTransform::Identity;
+
+	float ForwardAxis = 0.0f;
+	float RightAxis = 0.0f;
+	bool bTeleportPressed = false;
+};
+
+// Writes FVRPoseFrames to a compact binary file
+//
+// every frame is quantized into a fixed-size record (positions to 0.2 mm, rotations and
+// axes to 16 bits), about 50 bytes per frame or 16 MB per hour at 90 Hz
+class ARCHITECTUREEXPLORER_API FVRPoseRecorder
+{
+public:
+	FVRPoseRecorder();
+	~FVRPoseRecorder();
+
+	// start a new recording, replacing the file if it exists
+	bool bStart(const FString &Filename);
+
+	// flush and close the file
+	void Stop();
+
+	bool IsRecording() const { return File.IsValid(); }
+
+	int32 GetNumFrames() const { return NumFrames; }
+
+	void AddFrame(const FVRPoseFrame &Frame);
+
+private:
+	TUniquePtr<IFileHandle> File;
+
+	// records are collected here and written in blocks, not one file write per frame
+	TArray<uint8> Buffer;
+
+	int32 NumFrames = 0;
+
+	void Flush();
+};
+
+// Plays back a file written by FVRPoseRecorder
+//
+// the file is memory-mapped (or loaded in one go where mapping is not supported),
+// frames are decoded straight from the mapping one at a time
+class ARCHITECTUREEXPLORER_API FVRPoseReplay
+{
+public:
+	FVRPoseReplay();
+	~FVRPoseReplay();
+
+	bool bOpen(const FString &Filename);
+
+	void Close();
+
+	bool IsPlaying() const { return Records != nullptr; }
+
+	int32 GetNumFrames() const { return NumFrames; }
+	int32 GetCurrentFrame() const { return CurrentFrame; }
+
+	// decode the next frame
+	// at the end it starts over if bLoop is set, otherwise it returns false
+	bool bNextFrame(FVRPoseFrame &OutFrame, bool bLoop);
+
+private:
+	TUniquePtr<IMappedFileHandle> MappedFile;
+	TUniquePtr<IMappedFileRegion> MappedRegion;
+
+	// only used if the platform cannot map files
+	TArray<uint8> LoadedFile;
+
+	// first record and record count inside the mapping or LoadedFile
+	const uint8 *Records = nullptr;
+	int32 NumFrames = 0;
+	float PositionScale = 1.0f;
+
+	int32 CurrentFrame = 0;
+
+	// check the header and point Records at the frames
+	bool bSetData(const uint8 *Data, int64 Size);
+};
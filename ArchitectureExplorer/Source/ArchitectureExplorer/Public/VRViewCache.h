@@ -0,0 +1,62 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class APlayerController;
+
+enum class EVRView : uint8
+{
+	// the whole viewport, what APlayerController::ProjectWorldLocationToScreen uses
+	Mono,
+	LeftEye,
+	RightEye,
+
+	Count
+};
+
+// view projections of one player, computed once per frame
+//
+// screen-space effects like the blinker need to know where a world location ends up on
+// screen, for each eye when a headset is on. Asking the player controller rebuilds the
+// view projection every time and only knows the mono view; this keeps the matrices of
+// the frame around so a projection is one matrix multiply.
+// Without a headset the eye views are the mono view.
+class ARCHITECTUREEXPLORER_API FVRViewCache
+{
+public:
+	// recompute the view projections of PlayerController's local player
+	// does nothing if they were already computed this frame
+	void Update(const APlayerController *PlayerController);
+
+	// false if there is no local player or viewport (yet), projections fail then
+	bool IsValid(EVRView View) const { return Views[(int32)View].bValid; }
+
+	bool IsStereo() const { return bStereo; }
+
+	const FMatrix &GetViewProjectionMatrix(EVRView View) const { return Views[(int32)View].ViewProjection; }
+
+	// OutScreen is 0..1 across the view (0,0 is top left), like a post process material's
+	// viewport UV; outside that range if off screen
+	// returns false if WorldLocation is behind the view
+	bool bProject(EVRView View, const FVector &WorldLocation, FVector2D &OutScreen) const;
+
+	// project many locations at once, returns how many of them are in front of the view
+	// locations behind the view are marked in OutInFront (if given) and get OutScreen (0.5, 0.5)
+	int32 Project(EVRView View, const TArray<FVector> &WorldLocations, TArray<FVector2D> &OutScreen, TArray<bool> *OutInFront = nullptr) const;
+
+private:
+	struct FView
+	{
+		FMatrix ViewProjection = FMatrix::Identity;
+		bool bValid = false;
+	};
+
+	FView Views[(int32)EVRView::Count];
+
+	bool bStereo = false;
+
+	// GFrameCounter of the last Update
+	uint64 UpdateFrame = MAX_uint64;
+};
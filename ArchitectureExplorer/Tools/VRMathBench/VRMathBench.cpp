@@ -0,0 +1,309 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+// Checks VRMathCore against straightforward double precision versions of the same math,
+// then times the single and batch versions. Builds without the engine, see CMakeLists.txt.
+
+#include "VRMathCore.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace VRMathCore;
+
+namespace
+{
+	int NumFailed = 0;
+
+	void Check(bool bPassed, const char *What)
+	{
+		if (!bPassed)
+		{
+			std::printf("FAILED  %s\n", What);
+			NumFailed++;
+		}
+	}
+
+	bool Near(double A, double B, double Tolerance)
+	{
+		return std::fabs(A - B) <= Tolerance;
+	}
+
+	// a perspective view from Eye looking along +X with Z up, like the engine's view matrices
+	// (world to view swaps axes so that X is forward), times an infinite reversed Z projection
+	FMat4 MakeViewProjection(const FVec3 &Eye, float HalfFOVDegrees)
+	{
+		const float Scale = 1.0f / std::tan(HalfFOVDegrees * 3.14159265f / 180.0f);
+		const float NearPlane = 10.0f;
+
+		// view: screen X = world Y, screen Y = world Z, depth = world X
+		float View[4][4] = {
+			{ 0, 0, 1, 0 },
+			{ 1, 0, 0, 0 },
+			{ 0, 1, 0, 0 },
+			{ -Eye.Y, -Eye.Z, -Eye.X, 1 } };
+		float Projection[4][4] = {
+			{ Scale, 0, 0, 0 },
+			{ 0, Scale, 0, 0 },
+			{ 0, 0, 0, 1 },
+			{ 0, 0, NearPlane, 0 } };
+
+		FMat4 Result;
+		for (int Row = 0; Row < 4; Row++)
+		{
+			for (int Column = 0; Column < 4; Column++)
+			{
+				float Sum = 0.0f;
+				for (int Index = 0; Index < 4; Index++)
+				{
+					Sum += View[Row][Index] * Projection[Index][Column];
+				}
+				Result.M[Row][Column] = Sum;
+			}
+		}
+		return Result;
+	}
+
+	void CheckArc()
+	{
+		const FArcParams Params{ { 10.0f, -20.0f, 150.0f }, { 600.0f, 200.0f, 300.0f }, -980.0f };
+
+		for (int Step = 0; Step <= 40; Step++)
+		{
+			const double Time = Step * 0.05;
+			const FVec3 Location = GetArcLocation(Params, (float)Time);
+			Check(Near(Location.X, 10.0 + 600.0 * Time, 1e-2), "GetArcLocation X");
+			Check(Near(Location.Y, -20.0 + 200.0 * Time, 1e-2), "GetArcLocation Y");
+			Check(Near(Location.Z, 150.0 + 300.0 * Time - 490.0 * Time * Time, 1e-2), "GetArcLocation Z");
+
+			const FVec3 Velocity = GetArcVelocity(Params, (float)Time);
+			Check(Near(Velocity.Z, 300.0 - 980.0 * Time, 1e-3), "GetArcVelocity Z");
+		}
+
+		// the arc comes down through the floor after about 0.8 s, and passes its start height on the way up and down
+		float Time = 0.0f;
+		Check(bGetArcTimeAtHeight(Params, 0.0f, 2.0f, Time), "bGetArcTimeAtHeight finds the floor");
+		Check(Near(GetArcLocation(Params, Time).Z, 0.0, 1e-2), "bGetArcTimeAtHeight lands on the floor");
+		Check(bGetArcTimeAtHeight(Params, 150.0f, 2.0f, Time) && Near(Time, 300.0 / 490.0, 1e-5), "bGetArcTimeAtHeight takes the later root");
+		Check(!bGetArcTimeAtHeight(Params, 1000.0f, 2.0f, Time), "bGetArcTimeAtHeight above the apex");
+		Check(!bGetArcTimeAtHeight(Params, -10000.0f, 2.0f, Time), "bGetArcTimeAtHeight after MaxTime");
+
+		// straight down bends nothing, horizontal bends by all of gravity
+		Check(Near(GetGravityAcross(-980.0f, { 0.0f, 0.0f, -100.0f }), 0.0, 1e-3), "GetGravityAcross falling");
+		Check(Near(GetGravityAcross(-980.0f, { 100.0f, 0.0f, 0.0f }), 980.0, 1e-3), "GetGravityAcross horizontal");
+		Check(Near(GetGravityAcross(-980.0f, { 0.0f, 0.0f, 0.0f }), 980.0, 1e-3), "GetGravityAcross standing still");
+
+		Check(Near(GetSegmentTime(980.0f, 2.0f, 1.0f / 60.0f, 0.5f), std::sqrt(16.0 / 980.0), 1e-6), "GetSegmentTime");
+		Check(GetSegmentTime(0.0f, 2.0f, 1.0f / 60.0f, 0.5f) == 0.5f, "GetSegmentTime straight");
+		Check(GetSegmentTime(980.0f, 0.0f, 1.0f / 60.0f, 0.5f) == 1.0f / 60.0f, "GetSegmentTime no deviation");
+
+		// the batch version is the same math
+		std::vector<float> Times(1000), X(1000), Y(1000), Z(1000);
+		for (size_t Index = 0; Index < Times.size(); Index++)
+		{
+			Times[Index] = Index * 0.002f;
+		}
+		GetArcLocations(Params, Times.data(), (int32_t)Times.size(), X.data(), Y.data(), Z.data());
+
+		bool bSame = true;
+		for (size_t Index = 0; Index < Times.size(); Index++)
+		{
+			const FVec3 Location = GetArcLocation(Params, Times[Index]);
+			bSame = bSame && Near(Location.X, X[Index], 1e-3) && Near(Location.Y, Y[Index], 1e-3) && Near(Location.Z, Z[Index], 1e-3);
+		}
+		Check(bSame, "GetArcLocations matches GetArcLocation");
+	}
+
+	void CheckProjection()
+	{
+		const FVec3 Eye{ 100.0f, 50.0f, 170.0f };
+		const FMat4 ViewProjection = MakeViewProjection(Eye, 45.0f);
+
+		FVec2 Screen;
+		Check(bProject(ViewProjection, { 1100.0f, 50.0f, 170.0f }, Screen) && Near(Screen.X, 0.5, 1e-6) && Near(Screen.Y, 0.5, 1e-6), "bProject straight ahead");
+
+		// 45 degrees to the right and up is the edge of the screen
+		Check(bProject(ViewProjection, { 1100.0f, 1050.0f, 170.0f }, Screen) && Near(Screen.X, 1.0, 1e-5), "bProject right edge");
+		Check(bProject(ViewProjection, { 1100.0f, 50.0f, 1170.0f }, Screen) && Near(Screen.Y, 0.0, 1e-5), "bProject top edge");
+		Check(!bProject(ViewProjection, { -900.0f, 50.0f, 170.0f }, Screen), "bProject behind");
+
+		// batch, with some points behind
+		std::vector<FVec3> Locations;
+		for (int Index = 0; Index < 1000; Index++)
+		{
+			Locations.push_back({ 100.0f + (Index - 300) * 3.0f, 50.0f + Index * 0.7f, 170.0f - Index * 0.4f });
+		}
+		std::vector<FVec2> Batch(Locations.size());
+		std::vector<uint8_t> InFront(Locations.size());
+		const int32_t NumInFront = Project(ViewProjection, Locations.data(), (int32_t)Locations.size(), Batch.data(), InFront.data());
+
+		int32_t Expected = 0;
+		bool bSame = true;
+		for (size_t Index = 0; Index < Locations.size(); Index++)
+		{
+			FVec2 Single{ 0.5f, 0.5f };
+			const bool bSingle = bProject(ViewProjection, Locations[Index], Single);
+			Expected += bSingle ? 1 : 0;
+			bSame = bSame && ((InFront[Index] != 0) == bSingle) && Near(Single.X, Batch[Index].X, 1e-5) && Near(Single.Y, Batch[Index].Y, 1e-5);
+		}
+		Check(bSame && (NumInFront == Expected) && (NumInFront > 0) && (NumInFront < 1000), "Project matches bProject");
+
+		// moving forward aims at the center, moving back too (we look behind), standing still doesn't aim
+		FVec2 Center;
+		Check(bGetBlinkerCenter(ViewProjection, Eye, { 1.0f, 0.0f, 0.0f }, { 300.0f, 0.0f, 0.0f }, Center) && Near(Center.X, 0.5, 1e-6), "bGetBlinkerCenter forward");
+		Check(bGetBlinkerCenter(ViewProjection, Eye, { 1.0f, 0.0f, 0.0f }, { -300.0f, 0.0f, 0.0f }, Center) && Near(Center.X, 0.5, 1e-6), "bGetBlinkerCenter backward");
+		Check(bGetBlinkerCenter(ViewProjection, Eye, { 1.0f, 0.0f, 0.0f }, { 300.0f, 300.0f, 0.0f }, Center) && (Center.X > 0.5f), "bGetBlinkerCenter to the right");
+		Check(!bGetBlinkerCenter(ViewProjection, Eye, { 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f }, Center), "bGetBlinkerCenter standing still");
+	}
+
+	void CheckPlaySpace()
+	{
+		const FVec3 Delta = GetPlaySpaceDelta({ 130.0f, -40.0f, 170.0f }, { 100.0f, 0.0f, 90.0f });
+		Check((Delta.X == 30.0f) && (Delta.Y == -40.0f) && (Delta.Z == 0.0f), "GetPlaySpaceDelta");
+		Check(!bIsInDeadZone(Delta, 49.0f) && bIsInDeadZone(Delta, 51.0f), "bIsInDeadZone");
+	}
+
+	// keeps the optimizer from dropping the work we time
+	volatile float Sink = 0.0f;
+
+	template<typename FunctionType>
+	void Measure(const char *Name, int Count, FunctionType Function)
+	{
+		// warm up, then the best of a few runs
+		Function();
+
+		double Best = 1e30;
+		for (int Run = 0; Run < 7; Run++)
+		{
+			const auto Start = std::chrono::steady_clock::now();
+			Function();
+			const auto End = std::chrono::steady_clock::now();
+			Best = std::min(Best, std::chrono::duration<double, std::nano>(End - Start).count());
+		}
+
+		std::printf("%-40s %10.2f ns/item %12.0f items/ms\n", Name, Best / Count, 1e6 * Count / Best);
+	}
+
+	void Benchmark()
+	{
+		const int Count = 1 << 16;
+
+		std::mt19937 Random(42);
+		std::uniform_real_distribution<float> Uniform(-1.0f, 1.0f);
+
+		const FArcParams Arc{ { 0.0f, 0.0f, 150.0f }, { 600.0f, 100.0f, 300.0f }, -980.0f };
+		std::vector<float> Times(Count), X(Count), Y(Count), Z(Count);
+		for (int Index = 0; Index < Count; Index++)
+		{
+			Times[Index] = 2.0f * Index / Count;
+		}
+
+		Measure("GetArcLocation", Count, [&]()
+		{
+			for (int Index = 0; Index < Count; Index++)
+			{
+				const FVec3 Location = GetArcLocation(Arc, Times[Index]);
+				X[Index] = Location.X;
+				Y[Index] = Location.Y;
+				Z[Index] = Location.Z;
+			}
+			Sink = Sink + Z[Count / 2];
+		});
+
+		Measure("GetArcLocations (batch)", Count, [&]()
+		{
+			GetArcLocations(Arc, Times.data(), Count, X.data(), Y.data(), Z.data());
+			Sink = Sink + Z[Count / 2];
+		});
+
+		Measure("GetSegmentTime(GetGravityAcross)", Count, [&]()
+		{
+			float Sum = 0.0f;
+			for (int Index = 0; Index < Count; Index++)
+			{
+				Sum += GetSegmentTime(GetGravityAcross(Arc.GravityZ, GetArcVelocity(Arc, Times[Index])), 2.0f, 1.0f / 60.0f, 0.5f);
+			}
+			Sink = Sink + Sum;
+		});
+
+		const FVec3 Eye{ 0.0f, 0.0f, 170.0f };
+		const FMat4 ViewProjection = MakeViewProjection(Eye, 55.0f);
+		std::vector<FVec3> Locations(Count);
+		for (auto &Location : Locations)
+		{
+			Location = { 1000.0f * Uniform(Random), 1000.0f * Uniform(Random), 170.0f + 300.0f * Uniform(Random) };
+		}
+		std::vector<FVec2> Screen(Count);
+		std::vector<uint8_t> InFront(Count);
+
+		Measure("bProject", Count, [&]()
+		{
+			int32_t NumInFront = 0;
+			for (int Index = 0; Index < Count; Index++)
+			{
+				NumInFront += bProject(ViewProjection, Locations[Index], Screen[Index]) ? 1 : 0;
+			}
+			Sink = Sink + (float)NumInFront;
+		});
+
+		Measure("Project (batch)", Count, [&]()
+		{
+			Sink = Sink + (float)Project(ViewProjection, Locations.data(), Count, Screen.data(), InFront.data());
+		});
+
+		std::vector<FVec3> Velocities(Count);
+		for (auto &Velocity : Velocities)
+		{
+			Velocity = { 300.0f * Uniform(Random), 300.0f * Uniform(Random), 10.0f * Uniform(Random) };
+		}
+
+		Measure("bGetBlinkerCenter", Count, [&]()
+		{
+			float Sum = 0.0f;
+			for (int Index = 0; Index < Count; Index++)
+			{
+				FVec2 Center{ 0.5f, 0.5f };
+				bGetBlinkerCenter(ViewProjection, Eye, { 1.0f, 0.0f, 0.0f }, Velocities[Index], Center);
+				Sum += Center.X;
+			}
+			Sink = Sink + Sum;
+		});
+
+		Measure("GetPlaySpaceDelta + bIsInDeadZone", Count, [&]()
+		{
+			int32_t NumMoved = 0;
+			for (int Index = 0; Index < Count; Index++)
+			{
+				NumMoved += bIsInDeadZone(GetPlaySpaceDelta(Locations[Index], Eye), 500.0f) ? 0 : 1;
+			}
+			Sink = Sink + (float)NumMoved;
+		});
+	}
+}
+
+int main(int ArgC, char **ArgV)
+{
+	const bool bCheckOnly = (ArgC > 1) && (std::strcmp(ArgV[1], "--check") == 0);
+
+	CheckArc();
+	CheckProjection();
+	CheckPlaySpace();
+
+	if (NumFailed > 0)
+	{
+		std::printf("%d checks failed\n", NumFailed);
+		return 1;
+	}
+	std::printf("all checks passed\n");
+
+	if (!bCheckOnly)
+	{
+		Benchmark();
+	}
+
+	return 0;
+}